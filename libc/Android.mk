@@ -206,16 +206,23 @@ libc_bionic_src_files := \
     bionic/brk.cpp \
     bionic/dirent.cpp \
     bionic/__errno.c \
+    bionic/epoll_pwait.cpp \
     bionic/eventfd_read.cpp \
     bionic/eventfd_write.cpp \
+    bionic/fallocate.cpp \
     bionic/futimens.cpp \
     bionic/getauxval.cpp \
     bionic/getcwd.cpp \
+    bionic/getpid.cpp \
+    bionic/gettid.cpp \
     bionic/libc_init_common.cpp \
     bionic/libc_logging.cpp \
     bionic/libgen.cpp \
     bionic/mmap.cpp \
+    bionic/posix_fadvise.cpp \
+    bionic/preadv_pwritev.cpp \
     bionic/pthread_attr.cpp \
+    bionic/pthread_barrier.cpp \
     bionic/pthread_detach.cpp \
     bionic/pthread_equal.cpp \
     bionic/pthread_getcpuclockid.cpp \
@@ -227,6 +234,7 @@ libc_bionic_src_files := \
     bionic/pthread_setname_np.cpp \
     bionic/pthread_setschedparam.cpp \
     bionic/pthread_sigmask.cpp \
+    bionic/pthread_spinlock.cpp \
     bionic/raise.cpp \
     bionic/sbrk.cpp \
     bionic/scandir.cpp \
@@ -240,9 +248,11 @@ libc_bionic_src_files := \
     bionic/strerror_r.cpp \
     bionic/strsignal.cpp \
     bionic/stubs.cpp \
+    bionic/sync_file_range.cpp \
     bionic/sysconf.cpp \
     bionic/tdestroy.cpp \
     bionic/tmpfile.cpp \
+    bionic/vdso.cpp \
     bionic/wait.cpp \
     bionic/wchar.cpp \
 
@@ -945,6 +955,7 @@ LOCAL_SRC_FILES := \
 	bionic/debug_stacktrace.cpp \
 	bionic/malloc_debug_leak.cpp \
 	bionic/malloc_debug_check.cpp \
+	bionic/malloc_debug_guard.cpp \
 
 LOCAL_MODULE:= libc_malloc_debug_leak
 LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
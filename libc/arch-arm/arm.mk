@@ -17,6 +17,7 @@ _LIBC_ARCH_COMMON_SRC_FILES := \
     arch-arm/bionic/syscall.S \
     arch-arm/bionic/tgkill.S \
     arch-arm/bionic/tkill.S \
+    arch-arm/bionic/vfork.S \
 
 # These are used by the static and dynamic versions of the libc
 # respectively.
@@ -6,6 +6,7 @@ syscall_src += arch-arm/syscalls/__fork.S
 syscall_src += arch-arm/syscalls/__waitid.S
 syscall_src += arch-arm/syscalls/wait4.S
 syscall_src += arch-arm/syscalls/__sys_clone.S
+syscall_src += arch-arm/syscalls/__set_tid_address.S
 syscall_src += arch-arm/syscalls/execve.S
 syscall_src += arch-arm/syscalls/__setuid.S
 syscall_src += arch-arm/syscalls/getuid.S
@@ -14,7 +15,7 @@ syscall_src += arch-arm/syscalls/geteuid.S
 syscall_src += arch-arm/syscalls/getegid.S
 syscall_src += arch-arm/syscalls/getresuid.S
 syscall_src += arch-arm/syscalls/getresgid.S
-syscall_src += arch-arm/syscalls/gettid.S
+syscall_src += arch-arm/syscalls/__gettid.S
 syscall_src += arch-arm/syscalls/readahead.S
 syscall_src += arch-arm/syscalls/getgroups.S
 syscall_src += arch-arm/syscalls/getpgid.S
@@ -34,7 +35,6 @@ syscall_src += arch-arm/syscalls/getrlimit.S
 syscall_src += arch-arm/syscalls/getrusage.S
 syscall_src += arch-arm/syscalls/setgroups.S
 syscall_src += arch-arm/syscalls/setpgid.S
-syscall_src += arch-arm/syscalls/vfork.S
 syscall_src += arch-arm/syscalls/setregid.S
 syscall_src += arch-arm/syscalls/chroot.S
 syscall_src += arch-arm/syscalls/prctl.S
@@ -46,12 +46,14 @@ syscall_src += arch-arm/syscalls/read.S
 syscall_src += arch-arm/syscalls/write.S
 syscall_src += arch-arm/syscalls/pread64.S
 syscall_src += arch-arm/syscalls/pwrite64.S
+syscall_src += arch-arm/syscalls/__preadv64.S
+syscall_src += arch-arm/syscalls/__pwritev64.S
 syscall_src += arch-arm/syscalls/__open.S
 syscall_src += arch-arm/syscalls/__openat.S
 syscall_src += arch-arm/syscalls/close.S
 syscall_src += arch-arm/syscalls/lseek.S
 syscall_src += arch-arm/syscalls/__llseek.S
-syscall_src += arch-arm/syscalls/getpid.S
+syscall_src += arch-arm/syscalls/__getpid.S
 syscall_src += arch-arm/syscalls/__mmap2.S
 syscall_src += arch-arm/syscalls/munmap.S
 syscall_src += arch-arm/syscalls/mremap.S
@@ -79,11 +81,18 @@ syscall_src += arch-arm/syscalls/ftruncate64.S
 syscall_src += arch-arm/syscalls/getdents.S
 syscall_src += arch-arm/syscalls/fsync.S
 syscall_src += arch-arm/syscalls/fdatasync.S
+syscall_src += arch-arm/syscalls/fallocate64.S
+syscall_src += arch-arm/syscalls/__arm_fadvise64_64.S
+syscall_src += arch-arm/syscalls/__sync_file_range2.S
 syscall_src += arch-arm/syscalls/fchown.S
 syscall_src += arch-arm/syscalls/sync.S
 syscall_src += arch-arm/syscalls/__fcntl64.S
 syscall_src += arch-arm/syscalls/__fstatfs64.S
 syscall_src += arch-arm/syscalls/sendfile.S
+syscall_src += arch-arm/syscalls/sendfile64.S
+syscall_src += arch-arm/syscalls/splice.S
+syscall_src += arch-arm/syscalls/tee.S
+syscall_src += arch-arm/syscalls/vmsplice.S
 syscall_src += arch-arm/syscalls/fstatat.S
 syscall_src += arch-arm/syscalls/mkdirat.S
 syscall_src += arch-arm/syscalls/fchownat.S
@@ -129,11 +138,11 @@ syscall_src += arch-arm/syscalls/unshare.S
 syscall_src += arch-arm/syscalls/swapon.S
 syscall_src += arch-arm/syscalls/swapoff.S
 syscall_src += arch-arm/syscalls/pause.S
-syscall_src += arch-arm/syscalls/gettimeofday.S
+syscall_src += arch-arm/syscalls/__gettimeofday.S
 syscall_src += arch-arm/syscalls/settimeofday.S
 syscall_src += arch-arm/syscalls/times.S
 syscall_src += arch-arm/syscalls/nanosleep.S
-syscall_src += arch-arm/syscalls/clock_gettime.S
+syscall_src += arch-arm/syscalls/__clock_gettime.S
 syscall_src += arch-arm/syscalls/clock_settime.S
 syscall_src += arch-arm/syscalls/clock_getres.S
 syscall_src += arch-arm/syscalls/clock_nanosleep.S
@@ -163,6 +172,7 @@ syscall_src += arch-arm/syscalls/bind.S
 syscall_src += arch-arm/syscalls/connect.S
 syscall_src += arch-arm/syscalls/listen.S
 syscall_src += arch-arm/syscalls/accept.S
+syscall_src += arch-arm/syscalls/accept4.S
 syscall_src += arch-arm/syscalls/getsockname.S
 syscall_src += arch-arm/syscalls/getpeername.S
 syscall_src += arch-arm/syscalls/sendto.S
@@ -172,6 +182,8 @@ syscall_src += arch-arm/syscalls/setsockopt.S
 syscall_src += arch-arm/syscalls/getsockopt.S
 syscall_src += arch-arm/syscalls/sendmsg.S
 syscall_src += arch-arm/syscalls/recvmsg.S
+syscall_src += arch-arm/syscalls/recvmmsg.S
+syscall_src += arch-arm/syscalls/sendmmsg.S
 syscall_src += arch-arm/syscalls/sched_setscheduler.S
 syscall_src += arch-arm/syscalls/sched_getscheduler.S
 syscall_src += arch-arm/syscalls/sched_yield.S
@@ -197,8 +209,10 @@ syscall_src += arch-arm/syscalls/personality.S
 syscall_src += arch-arm/syscalls/perf_event_open.S
 syscall_src += arch-arm/syscalls/futex.S
 syscall_src += arch-arm/syscalls/epoll_create.S
+syscall_src += arch-arm/syscalls/epoll_create1.S
 syscall_src += arch-arm/syscalls/epoll_ctl.S
 syscall_src += arch-arm/syscalls/epoll_wait.S
+syscall_src += arch-arm/syscalls/__epoll_pwait.S
 syscall_src += arch-arm/syscalls/inotify_init.S
 syscall_src += arch-arm/syscalls/inotify_add_watch.S
 syscall_src += arch-arm/syscalls/inotify_rm_watch.S
@@ -7,6 +7,7 @@ syscall_src += arch-mips/syscalls/_waitpid.S
 syscall_src += arch-mips/syscalls/__waitid.S
 syscall_src += arch-mips/syscalls/wait4.S
 syscall_src += arch-mips/syscalls/__sys_clone.S
+syscall_src += arch-mips/syscalls/__set_tid_address.S
 syscall_src += arch-mips/syscalls/execve.S
 syscall_src += arch-mips/syscalls/__setuid.S
 syscall_src += arch-mips/syscalls/getuid.S
@@ -15,7 +16,7 @@ syscall_src += arch-mips/syscalls/geteuid.S
 syscall_src += arch-mips/syscalls/getegid.S
 syscall_src += arch-mips/syscalls/getresuid.S
 syscall_src += arch-mips/syscalls/getresgid.S
-syscall_src += arch-mips/syscalls/gettid.S
+syscall_src += arch-mips/syscalls/__gettid.S
 syscall_src += arch-mips/syscalls/readahead.S
 syscall_src += arch-mips/syscalls/getgroups.S
 syscall_src += arch-mips/syscalls/getpgid.S
@@ -50,12 +51,14 @@ syscall_src += arch-mips/syscalls/read.S
 syscall_src += arch-mips/syscalls/write.S
 syscall_src += arch-mips/syscalls/pread64.S
 syscall_src += arch-mips/syscalls/pwrite64.S
+syscall_src += arch-mips/syscalls/__preadv64.S
+syscall_src += arch-mips/syscalls/__pwritev64.S
 syscall_src += arch-mips/syscalls/__open.S
 syscall_src += arch-mips/syscalls/__openat.S
 syscall_src += arch-mips/syscalls/close.S
 syscall_src += arch-mips/syscalls/lseek.S
 syscall_src += arch-mips/syscalls/__llseek.S
-syscall_src += arch-mips/syscalls/getpid.S
+syscall_src += arch-mips/syscalls/__getpid.S
 syscall_src += arch-mips/syscalls/__mmap2.S
 syscall_src += arch-mips/syscalls/munmap.S
 syscall_src += arch-mips/syscalls/mremap.S
@@ -82,11 +85,18 @@ syscall_src += arch-mips/syscalls/ftruncate64.S
 syscall_src += arch-mips/syscalls/getdents.S
 syscall_src += arch-mips/syscalls/fsync.S
 syscall_src += arch-mips/syscalls/fdatasync.S
+syscall_src += arch-mips/syscalls/fallocate64.S
+syscall_src += arch-mips/syscalls/__fadvise64.S
+syscall_src += arch-mips/syscalls/__sync_file_range.S
 syscall_src += arch-mips/syscalls/fchown.S
 syscall_src += arch-mips/syscalls/sync.S
 syscall_src += arch-mips/syscalls/__fcntl64.S
 syscall_src += arch-mips/syscalls/__fstatfs64.S
 syscall_src += arch-mips/syscalls/sendfile.S
+syscall_src += arch-mips/syscalls/sendfile64.S
+syscall_src += arch-mips/syscalls/splice.S
+syscall_src += arch-mips/syscalls/tee.S
+syscall_src += arch-mips/syscalls/vmsplice.S
 syscall_src += arch-mips/syscalls/fstatat.S
 syscall_src += arch-mips/syscalls/mkdirat.S
 syscall_src += arch-mips/syscalls/fchownat.S
@@ -132,11 +142,11 @@ syscall_src += arch-mips/syscalls/unshare.S
 syscall_src += arch-mips/syscalls/swapon.S
 syscall_src += arch-mips/syscalls/swapoff.S
 syscall_src += arch-mips/syscalls/pause.S
-syscall_src += arch-mips/syscalls/gettimeofday.S
+syscall_src += arch-mips/syscalls/__gettimeofday.S
 syscall_src += arch-mips/syscalls/settimeofday.S
 syscall_src += arch-mips/syscalls/times.S
 syscall_src += arch-mips/syscalls/nanosleep.S
-syscall_src += arch-mips/syscalls/clock_gettime.S
+syscall_src += arch-mips/syscalls/__clock_gettime.S
 syscall_src += arch-mips/syscalls/clock_settime.S
 syscall_src += arch-mips/syscalls/clock_getres.S
 syscall_src += arch-mips/syscalls/clock_nanosleep.S
@@ -166,6 +176,7 @@ syscall_src += arch-mips/syscalls/bind.S
 syscall_src += arch-mips/syscalls/connect.S
 syscall_src += arch-mips/syscalls/listen.S
 syscall_src += arch-mips/syscalls/accept.S
+syscall_src += arch-mips/syscalls/accept4.S
 syscall_src += arch-mips/syscalls/getsockname.S
 syscall_src += arch-mips/syscalls/getpeername.S
 syscall_src += arch-mips/syscalls/sendto.S
@@ -175,6 +186,8 @@ syscall_src += arch-mips/syscalls/setsockopt.S
 syscall_src += arch-mips/syscalls/getsockopt.S
 syscall_src += arch-mips/syscalls/sendmsg.S
 syscall_src += arch-mips/syscalls/recvmsg.S
+syscall_src += arch-mips/syscalls/recvmmsg.S
+syscall_src += arch-mips/syscalls/sendmmsg.S
 syscall_src += arch-mips/syscalls/sched_setscheduler.S
 syscall_src += arch-mips/syscalls/sched_getscheduler.S
 syscall_src += arch-mips/syscalls/sched_yield.S
@@ -200,8 +213,10 @@ syscall_src += arch-mips/syscalls/personality.S
 syscall_src += arch-mips/syscalls/perf_event_open.S
 syscall_src += arch-mips/syscalls/futex.S
 syscall_src += arch-mips/syscalls/epoll_create.S
+syscall_src += arch-mips/syscalls/epoll_create1.S
 syscall_src += arch-mips/syscalls/epoll_ctl.S
 syscall_src += arch-mips/syscalls/epoll_wait.S
+syscall_src += arch-mips/syscalls/__epoll_pwait.S
 syscall_src += arch-mips/syscalls/inotify_init.S
 syscall_src += arch-mips/syscalls/inotify_add_watch.S
 syscall_src += arch-mips/syscalls/inotify_rm_watch.S
@@ -7,6 +7,7 @@ syscall_src += arch-x86/syscalls/_waitpid.S
 syscall_src += arch-x86/syscalls/__waitid.S
 syscall_src += arch-x86/syscalls/wait4.S
 syscall_src += arch-x86/syscalls/__sys_clone.S
+syscall_src += arch-x86/syscalls/__set_tid_address.S
 syscall_src += arch-x86/syscalls/execve.S
 syscall_src += arch-x86/syscalls/__setuid.S
 syscall_src += arch-x86/syscalls/getuid.S
@@ -15,7 +16,7 @@ syscall_src += arch-x86/syscalls/geteuid.S
 syscall_src += arch-x86/syscalls/getegid.S
 syscall_src += arch-x86/syscalls/getresuid.S
 syscall_src += arch-x86/syscalls/getresgid.S
-syscall_src += arch-x86/syscalls/gettid.S
+syscall_src += arch-x86/syscalls/__gettid.S
 syscall_src += arch-x86/syscalls/readahead.S
 syscall_src += arch-x86/syscalls/getgroups.S
 syscall_src += arch-x86/syscalls/getpgid.S
@@ -50,12 +51,14 @@ syscall_src += arch-x86/syscalls/read.S
 syscall_src += arch-x86/syscalls/write.S
 syscall_src += arch-x86/syscalls/pread64.S
 syscall_src += arch-x86/syscalls/pwrite64.S
+syscall_src += arch-x86/syscalls/__preadv64.S
+syscall_src += arch-x86/syscalls/__pwritev64.S
 syscall_src += arch-x86/syscalls/__open.S
 syscall_src += arch-x86/syscalls/__openat.S
 syscall_src += arch-x86/syscalls/close.S
 syscall_src += arch-x86/syscalls/lseek.S
 syscall_src += arch-x86/syscalls/__llseek.S
-syscall_src += arch-x86/syscalls/getpid.S
+syscall_src += arch-x86/syscalls/__getpid.S
 syscall_src += arch-x86/syscalls/__mmap2.S
 syscall_src += arch-x86/syscalls/munmap.S
 syscall_src += arch-x86/syscalls/mremap.S
@@ -83,11 +86,18 @@ syscall_src += arch-x86/syscalls/ftruncate64.S
 syscall_src += arch-x86/syscalls/getdents.S
 syscall_src += arch-x86/syscalls/fsync.S
 syscall_src += arch-x86/syscalls/fdatasync.S
+syscall_src += arch-x86/syscalls/fallocate64.S
+syscall_src += arch-x86/syscalls/__fadvise64.S
+syscall_src += arch-x86/syscalls/__sync_file_range.S
 syscall_src += arch-x86/syscalls/fchown.S
 syscall_src += arch-x86/syscalls/sync.S
 syscall_src += arch-x86/syscalls/__fcntl64.S
 syscall_src += arch-x86/syscalls/__fstatfs64.S
 syscall_src += arch-x86/syscalls/sendfile.S
+syscall_src += arch-x86/syscalls/sendfile64.S
+syscall_src += arch-x86/syscalls/splice.S
+syscall_src += arch-x86/syscalls/tee.S
+syscall_src += arch-x86/syscalls/vmsplice.S
 syscall_src += arch-x86/syscalls/fstatat.S
 syscall_src += arch-x86/syscalls/mkdirat.S
 syscall_src += arch-x86/syscalls/fchownat.S
@@ -133,11 +143,11 @@ syscall_src += arch-x86/syscalls/unshare.S
 syscall_src += arch-x86/syscalls/swapon.S
 syscall_src += arch-x86/syscalls/swapoff.S
 syscall_src += arch-x86/syscalls/pause.S
-syscall_src += arch-x86/syscalls/gettimeofday.S
+syscall_src += arch-x86/syscalls/__gettimeofday.S
 syscall_src += arch-x86/syscalls/settimeofday.S
 syscall_src += arch-x86/syscalls/times.S
 syscall_src += arch-x86/syscalls/nanosleep.S
-syscall_src += arch-x86/syscalls/clock_gettime.S
+syscall_src += arch-x86/syscalls/__clock_gettime.S
 syscall_src += arch-x86/syscalls/clock_settime.S
 syscall_src += arch-x86/syscalls/clock_getres.S
 syscall_src += arch-x86/syscalls/clock_nanosleep.S
@@ -166,6 +176,7 @@ syscall_src += arch-x86/syscalls/bind.S
 syscall_src += arch-x86/syscalls/connect.S
 syscall_src += arch-x86/syscalls/listen.S
 syscall_src += arch-x86/syscalls/accept.S
+syscall_src += arch-x86/syscalls/accept4.S
 syscall_src += arch-x86/syscalls/getsockname.S
 syscall_src += arch-x86/syscalls/getpeername.S
 syscall_src += arch-x86/syscalls/socketpair.S
@@ -176,6 +187,8 @@ syscall_src += arch-x86/syscalls/setsockopt.S
 syscall_src += arch-x86/syscalls/getsockopt.S
 syscall_src += arch-x86/syscalls/sendmsg.S
 syscall_src += arch-x86/syscalls/recvmsg.S
+syscall_src += arch-x86/syscalls/recvmmsg.S
+syscall_src += arch-x86/syscalls/sendmmsg.S
 syscall_src += arch-x86/syscalls/sched_setscheduler.S
 syscall_src += arch-x86/syscalls/sched_getscheduler.S
 syscall_src += arch-x86/syscalls/sched_yield.S
@@ -201,8 +214,10 @@ syscall_src += arch-x86/syscalls/personality.S
 syscall_src += arch-x86/syscalls/perf_event_open.S
 syscall_src += arch-x86/syscalls/futex.S
 syscall_src += arch-x86/syscalls/epoll_create.S
+syscall_src += arch-x86/syscalls/epoll_create1.S
 syscall_src += arch-x86/syscalls/epoll_ctl.S
 syscall_src += arch-x86/syscalls/epoll_wait.S
+syscall_src += arch-x86/syscalls/__epoll_pwait.S
 syscall_src += arch-x86/syscalls/inotify_init.S
 syscall_src += arch-x86/syscalls/inotify_add_watch.S
 syscall_src += arch-x86/syscalls/inotify_rm_watch.S
@@ -31,6 +31,8 @@
 #include <stdarg.h>
 #include <stdio.h>
 
+#include "pthread_internal.h"
+
 extern int  __bionic_clone(unsigned long   clone_flags,
                            void*           newsp,
                            int            *parent_tidptr,
@@ -72,5 +74,18 @@ clone(int (*fn)(void *), void *child_stack, int flags, void*  arg, ...)
     }
     va_end(args);
 
-    return __bionic_clone(flags, child_stack, parent_tidptr, new_tls, child_tidptr, fn, arg);
+    /* The child gets a copy of our pthread_internal_t, or shares it if it
+     * shares our memory but not our TLS. Either way, getpid and gettid mustn't
+     * trust it (see pthread_internal.h). A sharing child keeps seeing it after
+     * we return, so then we stop trusting it for good.
+     */
+    pthread_internal_t* self = __get_thread();
+    pid_t cached_pid = self->cached_pid;
+    self->cached_pid = -1;
+
+    int rc = __bionic_clone(flags, child_stack, parent_tidptr, new_tls, child_tidptr, fn, arg);
+    if ((flags & CLONE_VM) == 0 || (flags & CLONE_SETTLS) != 0) {
+        self->cached_pid = cached_pid;
+    }
+    return rc;
 }
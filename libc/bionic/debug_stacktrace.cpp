@@ -29,12 +29,17 @@
 #include "debug_stacktrace.h"
 
 #include <dlfcn.h>
+#include <pthread.h>
+#include <string.h>
 #include <unistd.h>
 #include <unwind.h>
+#include <sys/system_properties.h>
 #include <sys/types.h>
 
 #include "debug_mapinfo.h"
 #include "libc_logging.h"
+#include "pthread_internal.h"
+#include "ScopedPthreadMutexLocker.h"
 
 /* depends how the system includes define this */
 #ifdef HAVE_UNWIND_CONTEXT_STRUCT
@@ -48,6 +53,12 @@ static void* gDemangler;
 typedef char* (*DemanglerFn)(const char*, char*, size_t*, int*);
 static DemanglerFn gDemanglerFn = NULL;
 
+/* The value of libc.debug.malloc.unwinder. Setting it to "fast" selects the
+ * frame pointer walk on x86 and the cached EXIDX unwinder on ARM; any other
+ * value keeps libgcc's _Unwind_Backtrace.
+ */
+static int gUnwinder = BACKTRACE_UNWINDER_LIBGCC;
+
 __LIBC_HIDDEN__ void backtrace_startup() {
   gMapInfo = mapinfo_create(getpid());
   gDemangler = dlopen("libgccdemangle.so", RTLD_NOW);
@@ -55,6 +66,12 @@ __LIBC_HIDDEN__ void backtrace_startup() {
     void* sym = dlsym(gDemangler, "__cxa_demangle");
     gDemanglerFn = reinterpret_cast<DemanglerFn>(sym);
   }
+
+  char unwinder[PROP_VALUE_MAX];
+  if (__system_property_get("libc.debug.malloc.unwinder", unwinder) != 0 &&
+      strcmp(unwinder, "fast") == 0) {
+    gUnwinder = BACKTRACE_UNWINDER_FAST;
+  }
 }
 
 __LIBC_HIDDEN__ void backtrace_shutdown() {
@@ -73,31 +90,32 @@ struct stack_crawl_state_t {
   uintptr_t* frames;
   size_t frame_count;
   size_t max_depth;
-  bool have_skipped_self;
+  // The unwinder's own frame and that of its caller are never reported.
+  size_t frames_to_skip;
 
   stack_crawl_state_t(uintptr_t* frames, size_t max_depth)
-      : frames(frames), frame_count(0), max_depth(max_depth), have_skipped_self(false) {
+      : frames(frames), frame_count(0), max_depth(max_depth), frames_to_skip(2) {
   }
-};
 
-static _Unwind_Reason_Code trace_function(__unwind_context* context, void* arg) {
-  stack_crawl_state_t* state = static_cast<stack_crawl_state_t*>(arg);
-
-  uintptr_t ip = _Unwind_GetIP(context);
-
-  // The first stack frame is get_backtrace itself. Skip it.
-  if (ip != 0 && !state->have_skipped_self) {
-    state->have_skipped_self = true;
-    return _URC_NO_REASON;
+  // Returns false once the caller should stop unwinding.
+  bool add_frame(uintptr_t ip) {
+    if (frames_to_skip > 0) {
+      --frames_to_skip;
+      return true;
+    }
+    frames[frame_count++] = ip;
+    return frame_count < max_depth;
   }
+};
 
 #ifdef __arm__
-  /*
-   * The instruction pointer is pointing at the instruction after the bl(x), and
-   * the _Unwind_Backtrace routine already masks the Thumb mode indicator (LSB
-   * in PC). So we need to do a quick check here to find out if the previous
-   * instruction is a Thumb-mode BLX(2). If so subtract 2 otherwise 4 from PC.
-   */
+/*
+ * The instruction pointer is pointing at the instruction after the bl(x), and
+ * the _Unwind_Backtrace routine already masks the Thumb mode indicator (LSB
+ * in PC). So we need to do a quick check here to find out if the previous
+ * instruction is a Thumb-mode BLX(2). If so subtract 2 otherwise 4 from PC.
+ */
+static uintptr_t adjust_arm_ip(uintptr_t ip) {
   if (ip != 0) {
     short* ptr = reinterpret_cast<short*>(ip);
     // Thumb BLX(2)
@@ -107,15 +125,415 @@ static _Unwind_Reason_Code trace_function(__unwind_context* context, void* arg)
       ip -= 4;
     }
   }
+  return ip;
+}
+#endif
+
+static _Unwind_Reason_Code trace_function(__unwind_context* context, void* arg) {
+  stack_crawl_state_t* state = static_cast<stack_crawl_state_t*>(arg);
+
+  uintptr_t ip = _Unwind_GetIP(context);
+  if (ip == 0) {
+    return _URC_NO_REASON;
+  }
+#ifdef __arm__
+  ip = adjust_arm_ip(ip);
+#endif
+
+  return state->add_frame(ip) ? _URC_NO_REASON : _URC_END_OF_STACK;
+}
+
+// Not inlined, so that frames_to_skip always covers this function and its caller.
+static __attribute__((noinline)) void libgcc_backtrace(stack_crawl_state_t* state) {
+  _Unwind_Backtrace(trace_function, state);
+}
+
+#if defined(__arm__) || defined(__i386__)
+
+/* Both fast unwinders trust nothing they read from the stack: every frame
+ * must lie inside the current thread's stack, above the previous one, and
+ * the walk never goes deeper than max_depth. Anything else stops the walk.
+ * If we're on the alternate signal stack, or the thread's stack bounds are
+ * unknown, we return no frames and let the caller fall back to libgcc.
+ */
+struct stack_range_t {
+  uintptr_t lo;
+  uintptr_t hi;
+
+  bool contains(uintptr_t addr, size_t size) const {
+    return addr >= lo && addr <= hi - size;
+  }
+};
+
+static bool get_stack_range(stack_range_t* range, uintptr_t sp) {
+  pthread_internal_t* thread = __get_thread();
+  if (thread == NULL || thread->attr.stack_base == NULL) {
+    return false;
+  }
+  range->lo = reinterpret_cast<uintptr_t>(thread->attr.stack_base);
+  range->hi = range->lo + thread->attr.stack_size;
+  return range->contains(sp, sizeof(uintptr_t));
+}
+
 #endif
 
-  state->frames[state->frame_count++] = ip;
-  return (state->frame_count >= state->max_depth) ? _URC_END_OF_STACK : _URC_NO_REASON;
+#if defined(__i386__)
+
+/* Walks the %ebp chain. Each frame record is the caller's %ebp followed by
+ * the return address. Code built with -fomit-frame-pointer simply doesn't
+ * appear in the trace.
+ */
+static __attribute__((noinline)) void fast_backtrace(stack_crawl_state_t* state) {
+  uintptr_t fp = reinterpret_cast<uintptr_t>(__builtin_frame_address(0));
+  stack_range_t stack;
+  if (!get_stack_range(&stack, fp)) {
+    return;
+  }
+
+  // Our own frame doesn't have a return address in the chain; account for it here.
+  state->add_frame(0);
+
+  while (stack.contains(fp, 2 * sizeof(uintptr_t)) && (fp & (sizeof(uintptr_t) - 1)) == 0) {
+    const uintptr_t* record = reinterpret_cast<const uintptr_t*>(fp);
+    uintptr_t next_fp = record[0];
+    uintptr_t ip = record[1];
+    if (ip == 0 || !state->add_frame(ip) || next_fp <= fp) {
+      break;
+    }
+    fp = next_fp;
+  }
+}
+
+#elif defined(__arm__)
+
+extern "C" _Unwind_Ptr __gnu_Unwind_Find_exidx(_Unwind_Ptr pc, int* pcount);
+
+/* ARM EHABI unwinding: find the .ARM.exidx entry covering a pc, extract its
+ * unwind opcodes, and interpret them against a virtual register set. Finding
+ * and decoding the entry is the expensive part (a walk over the loaded
+ * libraries plus a binary search), so the decoded opcodes are cached by pc.
+ * Allocation backtraces come from a fairly small set of call sites, so the
+ * cache hit rate is high.
+ */
+#define EXIDX_CANTUNWIND 1
+#define EXIDX_MAX_OPS 28
+#define EXIDX_CACHE_SIZE 1024
+
+struct exidx_entry_t {
+  uint32_t fn;
+  uint32_t data;
+};
+
+struct exidx_cache_entry_t {
+  uintptr_t pc;
+  uint8_t op_count;
+  uint8_t ops[EXIDX_MAX_OPS];
+};
+
+static exidx_cache_entry_t gExidxCache[EXIDX_CACHE_SIZE];
+static pthread_mutex_t gExidxCacheLock = PTHREAD_MUTEX_INITIALIZER;
+
+static uintptr_t prel31_to_addr(const uint32_t* ptr) {
+  int32_t offset = static_cast<int32_t>(*ptr << 1) >> 1;
+  return reinterpret_cast<uintptr_t>(ptr) + offset;
+}
+
+static const exidx_entry_t* find_exidx_entry(uintptr_t pc) {
+  int count;
+  const exidx_entry_t* table =
+      reinterpret_cast<const exidx_entry_t*>(__gnu_Unwind_Find_exidx(pc, &count));
+  if (table == NULL || count <= 0) {
+    return NULL;
+  }
+
+  // The table is sorted by function start; find the last entry that starts at or before pc.
+  int lo = 0;
+  int hi = count - 1;
+  if (pc < prel31_to_addr(&table[0].fn)) {
+    return NULL;
+  }
+  while (lo < hi) {
+    int mid = (lo + hi + 1) / 2;
+    if (prel31_to_addr(&table[mid].fn) <= pc) {
+      lo = mid;
+    } else {
+      hi = mid - 1;
+    }
+  }
+  return &table[lo];
 }
 
+// Appends the opcode bytes of 'word', most significant first, skipping the first 'skip' bytes.
+static bool append_ops(exidx_cache_entry_t* entry, uint32_t word, int skip) {
+  for (int shift = 24 - 8 * skip; shift >= 0; shift -= 8) {
+    if (entry->op_count == EXIDX_MAX_OPS) {
+      return false;
+    }
+    entry->ops[entry->op_count++] = (word >> shift) & 0xff;
+  }
+  return true;
+}
+
+// Extracts the unwind opcodes for pc into 'entry'. Returns false if pc can't be unwound.
+static bool decode_exidx(uintptr_t pc, exidx_cache_entry_t* entry) {
+  entry->op_count = 0;
+
+  const exidx_entry_t* exidx = find_exidx_entry(pc);
+  if (exidx == NULL || exidx->data == EXIDX_CANTUNWIND) {
+    return false;
+  }
+
+  if ((exidx->data & 0x80000000) != 0) {
+    // Compact model inlined in the index table. Only personality routine 0 fits there.
+    if ((exidx->data & 0x0f000000) != 0) {
+      return false;
+    }
+    return append_ops(entry, exidx->data, 1);
+  }
+
+  const uint32_t* extab = reinterpret_cast<const uint32_t*>(prel31_to_addr(&exidx->data));
+  size_t extra_words;
+  if ((*extab & 0x80000000) != 0) {
+    // Compact model in .ARM.extab.
+    uint32_t personality = (*extab >> 24) & 0x0f;
+    if (personality == 0) {
+      return append_ops(entry, *extab, 1);
+    } else if (personality == 1 || personality == 2) {
+      extra_words = (*extab >> 16) & 0xff;
+      if (!append_ops(entry, *extab, 2)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  } else {
+    // Generic model (such as __gxx_personality_v0): the opcodes follow the personality pointer.
+    ++extab;
+    extra_words = (*extab >> 24) & 0xff;
+    if (!append_ops(entry, *extab, 1)) {
+      return false;
+    }
+  }
+  for (size_t i = 1; i <= extra_words; ++i) {
+    if (!append_ops(entry, extab[i], 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool lookup_exidx(uintptr_t pc, exidx_cache_entry_t* result) {
+  exidx_cache_entry_t* slot = &gExidxCache[(pc >> 1) % EXIDX_CACHE_SIZE];
+
+  ScopedPthreadMutexLocker locker(&gExidxCacheLock);
+  if (slot->pc != pc) {
+    if (!decode_exidx(pc, slot)) {
+      slot->pc = 0;
+      return false;
+    }
+    slot->pc = pc;
+  }
+  *result = *slot;
+  return true;
+}
+
+struct arm_regs_t {
+  uint32_t r[16];
+};
+
+#define ARM_SP 13
+#define ARM_LR 14
+#define ARM_PC 15
+
+static bool pop_reg(arm_regs_t* regs, uint32_t* vsp, const stack_range_t& stack, int reg) {
+  if (!stack.contains(*vsp, sizeof(uint32_t))) {
+    return false;
+  }
+  regs->r[reg] = *reinterpret_cast<const uint32_t*>(*vsp);
+  *vsp += sizeof(uint32_t);
+  return true;
+}
+
+// Pops the registers in 'mask' (bit 0 is 'first_reg') in ascending order.
+static bool pop_regs(arm_regs_t* regs, uint32_t* vsp, const stack_range_t& stack,
+                     uint32_t mask, int first_reg) {
+  bool popped_sp = false;
+  uint32_t new_sp = 0;
+  for (int i = 0; mask != 0; ++i, mask >>= 1) {
+    if ((mask & 1) == 0) {
+      continue;
+    }
+    int reg = first_reg + i;
+    if (!pop_reg(regs, vsp, stack, reg)) {
+      return false;
+    }
+    if (reg == ARM_SP) {
+      popped_sp = true;
+      new_sp = regs->r[ARM_SP];
+    }
+  }
+  if (popped_sp) {
+    *vsp = new_sp;
+  }
+  return true;
+}
+
+// Executes the unwind opcodes for one frame, updating regs to the caller's state.
+static bool execute_ops(const exidx_cache_entry_t& entry, arm_regs_t* regs,
+                        const stack_range_t& stack) {
+  uint32_t vsp = regs->r[ARM_SP];
+  bool pc_set = false;
+
+  for (size_t i = 0; i < entry.op_count; ++i) {
+    uint8_t op = entry.ops[i];
+    if ((op & 0xc0) == 0x00) {
+      vsp += ((op & 0x3f) << 2) + 4;
+    } else if ((op & 0xc0) == 0x40) {
+      vsp -= ((op & 0x3f) << 2) + 4;
+    } else if ((op & 0xf0) == 0x80) {
+      if (++i == entry.op_count) {
+        return false;
+      }
+      uint32_t mask = ((op & 0x0f) << 8) | entry.ops[i];
+      if (mask == 0 || !pop_regs(regs, &vsp, stack, mask, 4)) {
+        return false;  // 0x8000 means "refuse to unwind".
+      }
+      pc_set = pc_set || (mask & (1 << (ARM_PC - 4))) != 0;
+    } else if ((op & 0xf0) == 0x90) {
+      int reg = op & 0x0f;
+      if (reg == ARM_SP || reg == ARM_PC) {
+        return false;
+      }
+      vsp = regs->r[reg];
+    } else if ((op & 0xf0) == 0xa0) {
+      uint32_t mask = (1 << ((op & 0x07) + 1)) - 1;
+      if ((op & 0x08) != 0) {
+        mask |= 1 << (ARM_LR - 4);
+      }
+      if (!pop_regs(regs, &vsp, stack, mask, 4)) {
+        return false;
+      }
+    } else if (op == 0xb0) {
+      break;
+    } else if (op == 0xb1) {
+      if (++i == entry.op_count) {
+        return false;
+      }
+      uint8_t mask = entry.ops[i];
+      if (mask == 0 || (mask & 0xf0) != 0 || !pop_regs(regs, &vsp, stack, mask, 0)) {
+        return false;
+      }
+    } else if (op == 0xb2) {
+      uint32_t value = 0;
+      int shift = 0;
+      do {
+        if (++i == entry.op_count || shift > 21) {
+          return false;
+        }
+        value |= (entry.ops[i] & 0x7f) << shift;
+        shift += 7;
+      } while ((entry.ops[i] & 0x80) != 0);
+      vsp += 0x204 + (value << 2);
+    } else if (op == 0xb3 || op == 0xc8 || op == 0xc9 || op == 0xc6) {
+      // VFP/iWMMXt register ranges: we only need to step over them.
+      if (++i == entry.op_count) {
+        return false;
+      }
+      vsp += ((entry.ops[i] & 0x0f) + 1) * 8 + (op == 0xb3 ? 4 : 0);
+    } else if ((op & 0xf8) == 0xb8) {
+      vsp += ((op & 0x07) + 1) * 8 + 4;
+    } else if ((op & 0xf8) == 0xd0) {
+      vsp += ((op & 0x07) + 1) * 8;
+    } else if (op == 0xc7) {
+      if (++i == entry.op_count) {
+        return false;
+      }
+      vsp += __builtin_popcount(entry.ops[i] & 0x0f) * 4;
+    } else if ((op & 0xf8) == 0xc0) {
+      vsp += ((op & 0x07) + 1) * 8;
+    } else {
+      return false;  // Spare/reserved.
+    }
+  }
+
+  if (!pc_set) {
+    regs->r[ARM_PC] = regs->r[ARM_LR];
+  }
+  regs->r[ARM_SP] = vsp;
+  return true;
+}
+
+static __attribute__((noinline)) void fast_backtrace(stack_crawl_state_t* state) {
+  // Capture the callee-saved registers (r7/r11 may be used as vsp bases), sp, lr and a pc
+  // somewhere inside this function, after the prologue.
+  arm_regs_t regs;
+  memset(&regs, 0, sizeof(regs));
+  uint32_t* r4_r11 = &regs.r[4];
+  __asm__ __volatile__("stmia %0, {r4-r11}" : : "r"(r4_r11) : "memory");
+  __asm__ __volatile__("mov %0, sp" : "=r"(regs.r[ARM_SP]));
+  __asm__ __volatile__("mov %0, lr" : "=r"(regs.r[ARM_LR]));
+  __asm__ __volatile__("mov %0, pc" : "=r"(regs.r[ARM_PC]));
+
+  stack_range_t stack;
+  if (!get_stack_range(&stack, regs.r[ARM_SP])) {
+    return;
+  }
+
+  // The captured pc is inside this function; every later pc is a return address, which we
+  // look up two bytes back so that calls to noreturn functions resolve to the caller.
+  uintptr_t lookup_pc = regs.r[ARM_PC] & ~1;
+  for (size_t depth = 0; depth < state->max_depth + 2; ++depth) {
+    exidx_cache_entry_t entry;
+    if (!lookup_exidx(lookup_pc, &entry)) {
+      break;
+    }
+
+    uint32_t old_sp = regs.r[ARM_SP];
+    if (!execute_ops(entry, &regs, stack)) {
+      break;
+    }
+    uintptr_t ip = regs.r[ARM_PC] & ~1;
+    if (ip == 0 || regs.r[ARM_SP] < old_sp || !stack.contains(regs.r[ARM_SP], 0)) {
+      break;
+    }
+    // The first frame unwound is our own, which add_frame skips along with our caller's.
+    if (depth == 0) {
+      state->add_frame(0);
+    }
+    if (!state->add_frame(adjust_arm_ip(ip))) {
+      break;
+    }
+    lookup_pc = ip - 2;
+  }
+}
+
+#endif
+
 __LIBC_HIDDEN__ int get_backtrace(uintptr_t* frames, size_t max_depth) {
   stack_crawl_state_t state(frames, max_depth);
-  _Unwind_Backtrace(trace_function, &state);
+#if defined(__arm__) || defined(__i386__)
+  if (gUnwinder == BACKTRACE_UNWINDER_FAST) {
+    fast_backtrace(&state);
+    if (state.frame_count != 0) {
+      return state.frame_count;
+    }
+    state = stack_crawl_state_t(frames, max_depth);
+  }
+#endif
+  libgcc_backtrace(&state);
+  return state.frame_count;
+}
+
+// Exported for bionic-benchmarks, which compares the cost per frame of the two unwinders.
+extern "C" int malloc_debug_backtrace(int unwinder, uintptr_t* frames, size_t max_depth) {
+  stack_crawl_state_t state(frames, max_depth);
+#if defined(__arm__) || defined(__i386__)
+  if (unwinder == BACKTRACE_UNWINDER_FAST) {
+    fast_backtrace(&state);
+    return state.frame_count;
+  }
+#endif
+  libgcc_backtrace(&state);
   return state.frame_count;
 }
 
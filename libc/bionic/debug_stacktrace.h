@@ -32,6 +32,10 @@
 #include <stdint.h>
 #include <sys/cdefs.h>
 
+/* Unwinders selectable with the libc.debug.malloc.unwinder property. */
+#define BACKTRACE_UNWINDER_LIBGCC 0
+#define BACKTRACE_UNWINDER_FAST   1
+
 __LIBC_HIDDEN__ void backtrace_startup();
 __LIBC_HIDDEN__ void backtrace_shutdown();
 __LIBC_HIDDEN__ int get_backtrace(uintptr_t* stack_frames, size_t max_depth);
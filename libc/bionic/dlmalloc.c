@@ -16,6 +16,9 @@
 
 #include "dlmalloc.h"
 
+#include <malloc.h>
+#include <time.h>
+
 #include "private/bionic_name_mem.h"
 #include "private/libc_logging.h"
 
@@ -31,6 +34,30 @@ static void* named_anonymous_mmap(size_t length);
 #define MMAP(s) named_anonymous_mmap(s)
 #define DIRECT_MMAP(s) named_anonymous_mmap(s)
 
+/* Heap locks that record how often, and for how long, threads had to wait for them. */
+#include <pthread.h>
+typedef struct {
+  pthread_mutex_t mutex;
+  uint64_t contentions;
+  uint64_t wait_ns;
+} bionic_heap_lock_t;
+static int bionic_heap_lock_contended(bionic_heap_lock_t* lock);
+#define MLOCK_T bionic_heap_lock_t
+#define ACQUIRE_LOCK(lk) \
+    ((pthread_mutex_trylock(&(lk)->mutex) == 0) ? 0 : bionic_heap_lock_contended(lk))
+#define RELEASE_LOCK(lk) pthread_mutex_unlock(&(lk)->mutex)
+#define TRY_LOCK(lk) (pthread_mutex_trylock(&(lk)->mutex) == 0)
+#define INITIAL_LOCK(lk) pthread_mutex_init(&(lk)->mutex, NULL)
+#define DESTROY_LOCK(lk) pthread_mutex_destroy(&(lk)->mutex)
+static MLOCK_T malloc_global_mutex = { PTHREAD_MUTEX_INITIALIZER, 0, 0 };
+
+/* Allocation statistics for malloc_get_extended_stats. */
+struct malloc_chunk;
+static void account_chunk(struct malloc_chunk* p, int allocated, int undo);
+#define ACCOUNT_ALLOC(M, P) account_chunk(P, 1, 0)
+#define ACCOUNT_FREE(M, P) account_chunk(P, 0, 0)
+#define ACCOUNT_UNALLOC(M, P) account_chunk(P, 0, 1)
+
 // Ugly inclusion of C file so that bionic specific #defines configure dlmalloc.
 #include "../upstream-dlmalloc/malloc.c"
 
@@ -49,6 +76,130 @@ static void __bionic_heap_usage_error(const char* function, void* address) {
   *((int**) 0xdeadbaad) = (int*) address;
 }
 
+/* Heap walking support for malloc_iterate, malloc_disable and malloc_enable. */
+
+struct iterate_state {
+  uintptr_t base;
+  uintptr_t end;
+  void (*callback)(uintptr_t base, size_t size, void* arg);
+  void* arg;
+};
+
+static void iterate_handler(void* start, void* end __attribute__((unused)), size_t used_bytes, void* arg) {
+  struct iterate_state* state = (struct iterate_state*) arg;
+  uintptr_t block = (uintptr_t) start;
+  /* Free chunks are reported with used_bytes == 0. */
+  if (used_bytes != 0 && block >= state->base && block < state->end) {
+    state->callback(block, used_bytes, state->arg);
+  }
+}
+
+void dlmalloc_iterate(uintptr_t base, size_t size,
+                      void (*callback)(uintptr_t base, size_t size, void* arg), void* arg) {
+  struct iterate_state state;
+  state.base = base;
+  state.end = (base + size < base) ? UINTPTR_MAX : base + size;
+  state.callback = callback;
+  state.arg = arg;
+  /* The caller holds the lock via dlmalloc_disable, so don't use dlmalloc_inspect_all. */
+  internal_inspect_all(gm, iterate_handler, &state);
+}
+
+void dlmalloc_disable(void) {
+  ensure_initialization();
+  ACQUIRE_LOCK(&gm->mutex);
+}
+
+void dlmalloc_enable(void) {
+  RELEASE_LOCK(&gm->mutex);
+}
+
+/* Allocation and lock statistics. */
+
+static int bionic_heap_lock_contended(bionic_heap_lock_t* lock) {
+  struct timespec start;
+  struct timespec end;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  int result = pthread_mutex_lock(&lock->mutex);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  if (result == 0) {
+    /* We hold the lock now, so its counters are ours to update. */
+    lock->contentions++;
+    lock->wait_ns += (uint64_t) (end.tv_sec - start.tv_sec) * 1000000000ULL + end.tv_nsec - start.tv_nsec;
+  }
+  return result;
+}
+
+/* Protected by gm->mutex. */
+static struct {
+  size_t live[MALLOC_SIZE_CLASS_COUNT];
+  uint64_t total[MALLOC_SIZE_CLASS_COUNT];
+  size_t live_bytes;        /* In-heap chunks only. */
+  size_t mmapped_chunks;
+  size_t mmapped_footprint; /* Including each mapping's alignment and footer padding. */
+} g_heap_stats;
+
+/* The size class is floor(log2(size)), with sizes too big for the table in the
+ * last class. __builtin_clzl is undefined for 0, which no chunk should have.
+ */
+static size_t size_class_of(size_t size) {
+  if (size == 0) {
+    return 0;
+  }
+  size_t size_class = (sizeof(unsigned long) * 8 - 1) - __builtin_clzl(size);
+  return (size_class < MALLOC_SIZE_CLASS_COUNT) ? size_class : MALLOC_SIZE_CLASS_COUNT - 1;
+}
+
+/* A free with 'undo' set also takes the chunk's allocation back out of 'total',
+ * for chunks malloc.c carves up and counts again as the pieces it hands out.
+ */
+static void account_chunk(mchunkptr p, int allocated, int undo) {
+  size_t size = chunksize(p);
+  size_t size_class = size_class_of(size);
+  size_t footprint = size + p->prev_foot + MMAP_FOOT_PAD;
+  if (allocated) {
+    g_heap_stats.live[size_class]++;
+    g_heap_stats.total[size_class]++;
+    if (is_mmapped(p)) {
+      g_heap_stats.mmapped_chunks++;
+      g_heap_stats.mmapped_footprint += footprint;
+    } else {
+      g_heap_stats.live_bytes += size;
+    }
+  } else {
+    g_heap_stats.live[size_class]--;
+    if (undo) {
+      g_heap_stats.total[size_class]--;
+    }
+    if (is_mmapped(p)) {
+      g_heap_stats.mmapped_chunks--;
+      g_heap_stats.mmapped_footprint -= footprint;
+    } else {
+      g_heap_stats.live_bytes -= size;
+    }
+  }
+}
+
+void dlmalloc_extended_stats(struct malloc_extended_stats* stats) {
+  memset(stats, 0, sizeof(*stats));
+  ensure_initialization();
+  if (PREACTION(gm)) {
+    return;
+  }
+  size_t i;
+  for (i = 0; i < MALLOC_SIZE_CLASS_COUNT; ++i) {
+    stats->size_classes[i].live = g_heap_stats.live[i];
+    stats->size_classes[i].total = g_heap_stats.total[i];
+  }
+  if (is_initialized(gm)) {
+    stats->free_bytes = gm->footprint - g_heap_stats.mmapped_footprint - g_heap_stats.live_bytes - gm->topsize;
+  }
+  stats->mmapped_chunks = g_heap_stats.mmapped_chunks;
+  stats->lock_contentions = gm->mutex.contentions;
+  stats->lock_wait_ns = gm->mutex.wait_ns;
+  POSTACTION(gm);
+}
+
 static void* named_anonymous_mmap(size_t length)
 {
     void* ret;
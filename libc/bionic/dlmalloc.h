@@ -23,13 +23,31 @@
 #define MSPACES 0
 #define REALLOC_ZERO_BYTES_FREES 1
 #define USE_DL_PREFIX 1
-#define USE_LOCKS 1
+/* Custom pthread-based locks that count contention; see dlmalloc.c. */
+#define USE_LOCKS 2
 #define LOCK_AT_FORK 1
 #define USE_RECURSIVE_LOCK 0
 #define USE_SPIN_LOCKS 0
 #define DEFAULT_MMAP_THRESHOLD (64U * 1024U)
+/* Grow and shrink mmapped chunks with mremap(2) rather than copying. */
+#define HAVE_MREMAP 1
+/* Let freed mmapped chunks raise the mmap threshold up to this size. */
+#define DYNAMIC_MMAP_THRESHOLD_MAX (512U * 1024U)
 
 /* Include the proper definitions. */
 #include "../upstream-dlmalloc/malloc.h"
 
+/* Bionic additions, backing malloc_iterate, malloc_disable, malloc_enable and
+ * malloc_get_extended_stats. */
+#include <stdint.h>
+#include <sys/cdefs.h>
+__BEGIN_DECLS
+void dlmalloc_iterate(uintptr_t base, size_t size,
+                      void (*callback)(uintptr_t base, size_t size, void* arg), void* arg);
+void dlmalloc_disable(void);
+void dlmalloc_enable(void);
+struct malloc_extended_stats;
+void dlmalloc_extended_stats(struct malloc_extended_stats* stats);
+__END_DECLS
+
 #endif  // LIBC_BIONIC_DLMALLOC_H_
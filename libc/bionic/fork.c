@@ -34,23 +34,38 @@ extern int  __fork(void);
 
 int  fork(void)
 {
+    pthread_internal_t*  self = __get_thread();
+    pid_t                cached_pid;
     int  ret;
 
     /* Posix mandates that the timers of a fork child process be
      * disarmed, but not destroyed. To avoid a race condition, we're
      * going to stop all timers now, and only re-start them in case
-     * of error, or in the parent process
+     * of error, or in the parent process. This comes after the
+     * prepare handlers, which may still want to use timers.
      */
-    __timer_table_start_stop(1);
     __bionic_atfork_run_prepare();
+    __timer_table_start_stop(1);
+
+    /* The child's copy of our pthread_internal_t has our pid and tid,
+     * so make sure getpid and gettid don't believe them until it's
+     * fixed them (see pthread_internal.h).
+     */
+    cached_pid = self->cached_pid;
+    self->cached_pid = -1;
 
     ret = __fork();
     if (ret != 0) {  /* not a child process */
+        self->cached_pid = cached_pid;
         __timer_table_start_stop(0);
         __bionic_atfork_run_parent();
     } else {
         // Fix the tid in the pthread_internal_t struct after a fork.
         __pthread_settid(pthread_self(), gettid());
+        self->cached_pid = 0;
+
+        // Disarm our timers, and forget the threads that serviced them.
+        __timer_table_fork_child();
 
         /*
          * Newly created process must update cpu accounting.
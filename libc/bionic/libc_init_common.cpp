@@ -50,6 +50,7 @@
 extern "C" abort_msg_t** __abort_message_ptr;
 extern "C" unsigned __get_sp(void);
 extern "C" int __system_properties_init(void);
+extern "C" pid_t __gettid(void);
 
 // Not public, but well-known in the BSDs.
 const char* __progname;
@@ -84,7 +85,7 @@ static size_t get_stack_size() {
  * apply to linker-private copies and will not be visible from libc later on.
  *
  * Note: this function creates a pthread_internal_t for the initial thread and
- * stores the pointer in TLS, but does not add it to pthread's gThreadList. This
+ * stores the pointer in TLS, but does not add it to pthread's thread list. This
  * has to be done later from libc itself (see __libc_init_common).
  *
  * This function also stores a pointer to the kernel argument block in a TLS slot to be
@@ -99,7 +100,7 @@ void __libc_init_tls(KernelArgumentBlock& args) {
 
   static void* tls[BIONIC_TLS_SLOTS];
   static pthread_internal_t thread;
-  thread.tid = gettid();
+  thread.tid = __gettid(); // Not gettid, which needs the TLS we're setting up.
   thread.tls = tls;
   pthread_attr_init(&thread.attr);
   pthread_attr_setstack(&thread.attr, (void*) stack_bottom, stack_size);
@@ -125,6 +126,8 @@ void __libc_init_common(KernelArgumentBlock& args) {
   _pthread_internal_add(main_thread);
 
   __system_properties_init(); // Requires 'environ'.
+
+  __libc_init_vdso(); // Requires '__libc_auxv'.
 }
 
 /* This function will be called during normal program termination
@@ -56,6 +56,9 @@
 extern unsigned int gMallocDebugBacklog;
 extern int gMallocDebugLevel;
 
+/* libc.debug.malloc = 15, implemented in malloc_debug_guard.cpp */
+__LIBC_HIDDEN__ void guard_initialize();
+
 #define MAX_BACKTRACE_DEPTH 16
 #define ALLOCATION_TAG      0x1ee7d00d
 #define BACKLOG_TAG         0xbabecafe
@@ -546,6 +549,9 @@ static void ReportMemoryLeaks() {
 
 extern "C" int malloc_debug_initialize() {
   backtrace_startup();
+  if (gMallocDebugLevel == 15) {
+    guard_initialize();
+  }
   return 0;
 }
 
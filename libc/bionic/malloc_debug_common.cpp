@@ -190,6 +190,23 @@ extern "C" struct mallinfo mallinfo() {
     return dlmallinfo();
 }
 
+extern "C" void malloc_iterate(uintptr_t base, size_t size,
+                               void (*callback)(uintptr_t base, size_t size, void* arg), void* arg) {
+    dlmalloc_iterate(base, size, callback, arg);
+}
+
+extern "C" void malloc_disable() {
+    dlmalloc_disable();
+}
+
+extern "C" void malloc_enable() {
+    dlmalloc_enable();
+}
+
+extern "C" void malloc_get_extended_stats(struct malloc_extended_stats* stats) {
+    dlmalloc_extended_stats(stats);
+}
+
 extern "C" void* valloc(size_t bytes) {
     return dlvalloc(bytes);
 }
@@ -268,13 +285,16 @@ extern const char* __progname;
  *      CHK_SENTINEL_VALUE, and CHK_FILL_FREE macros.
  * 10 - For adding pre-, and post- allocation stubs in order to detect
  *      buffer overruns.
+ * 15 - For placing allocations just before a PROT_NONE guard page, so that
+ *      buffer overruns and uses after free fault immediately. The
+ *      libc.debug.malloc.guard.* properties select which allocations.
  * Note that emulator's memory allocation instrumentation is not controlled by
  * libc.debug.malloc value, but rather by emulator, started with -memcheck
  * option. Note also, that if emulator has started with -memcheck option,
  * emulator's instrumented memory allocation will take over value saved in
  * libc.debug.malloc. In other words, if emulator has started with -memcheck
  * option, libc.debug.malloc value is ignored.
- * Actual functionality for debug levels 1-10 is implemented in
+ * Actual functionality for debug levels 1-15 is implemented in
  * libc_malloc_debug_leak.so, while functionality for emultor's instrumented
  * allocations is implemented in libc_malloc_debug_qemu.so and can be run inside
  * the emulator only.
@@ -382,6 +402,9 @@ static void malloc_init_impl() {
             so_name = "/system/lib/libc_malloc_debug_leak.so";
             break;
         }
+        case 15:
+            so_name = "/system/lib/libc_malloc_debug_leak.so";
+            break;
         case 20:
             // Quick check: debug level 20 can only be handled in emulator.
             if (!qemu_running) {
@@ -455,6 +478,9 @@ static void malloc_init_impl() {
         case 10:
             InitMalloc(malloc_impl_handle, &gMallocUse, "chk");
             break;
+        case 15:
+            InitMalloc(malloc_impl_handle, &gMallocUse, "guard");
+            break;
         case 20:
             InitMalloc(malloc_impl_handle, &gMallocUse, "qemu_instrumented");
             break;
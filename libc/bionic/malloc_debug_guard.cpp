@@ -0,0 +1,331 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Implements libc.debug.malloc = 15: "electric fence" allocations.
+ *
+ * Selected allocations get their own run of pages, with the user's block
+ * placed right at the end and followed by a PROT_NONE guard page, so that
+ * an overrun faults on the offending instruction instead of being found
+ * by a guard-byte check at free time. Freed runs are made inaccessible and
+ * kept in a quarantine for a while, so that use-after-free faults too.
+ *
+ * Every allocation is a page or more of address space (and at least one
+ * page of memory), so the mode is tunable:
+ *
+ * libc.debug.malloc.guard.min_size    guard only blocks of at least this many bytes (default 0)
+ * libc.debug.malloc.guard.max_size    ...and at most this many bytes (default unlimited)
+ * libc.debug.malloc.guard.sample_rate guard one in every N matching blocks (default 1)
+ * libc.debug.malloc.guard.limit_kb    cap on live guarded memory, in KiB (default 65536)
+ * libc.debug.malloc.guard.quarantine  number of freed runs kept inaccessible (default 256)
+ *
+ * Allocations that aren't selected, or that would go over the limit, come
+ * from dlmalloc as usual.
+ */
+
+#include <asm/page.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/system_properties.h>
+
+#include "debug_stacktrace.h"
+#include "dlmalloc.h"
+#include "malloc_debug_common.h"
+#include "ScopedPthreadMutexLocker.h"
+
+#define GUARDED_TAG         0x5afe9a9e
+#define PASSTHROUGH_TAG     0x5afed1c0
+#define MAX_BACKTRACE_DEPTH 16
+
+#define DEFAULT_LIMIT_KB    (64 * 1024)
+#define DEFAULT_QUARANTINE  256
+
+struct guard_hdr_t {
+  uint32_t tag;
+  void* base;       // The dlmalloc'ed block, or the start of the page run.
+  size_t map_size;  // Size of the page run including the guard page; 0 for dlmalloc'ed blocks.
+  size_t size;      // The size the caller asked for.
+} __attribute__((aligned(MALLOC_ALIGNMENT)));
+
+struct quarantined_run_t {
+  void* base;
+  size_t map_size;
+};
+
+static size_t gMinSize;
+static size_t gMaxSize = MAX_SIZE_T;
+static size_t gSampleRate = 1;
+static size_t gLimitBytes = DEFAULT_LIMIT_KB * 1024;
+
+static pthread_mutex_t gGuardLock = PTHREAD_MUTEX_INITIALIZER;
+static size_t gSampleCounter;
+static size_t gGuardedBytes;
+
+// A ring of freed runs, oldest first.
+static quarantined_run_t* gQuarantine;
+static size_t gQuarantineSize;
+static size_t gQuarantineHead;
+static size_t gQuarantineCount;
+
+static inline guard_hdr_t* meta(void* user) {
+  return reinterpret_cast<guard_hdr_t*>(user) - 1;
+}
+
+static inline const guard_hdr_t* const_meta(const void* user) {
+  return reinterpret_cast<const guard_hdr_t*>(user) - 1;
+}
+
+static size_t get_size_property(const char* name, size_t default_value) {
+  char value[PROP_VALUE_MAX];
+  if (__system_property_get(name, value) == 0) {
+    return default_value;
+  }
+  return strtoul(value, NULL, 0);
+}
+
+__LIBC_HIDDEN__ void guard_initialize() {
+  gMinSize = get_size_property("libc.debug.malloc.guard.min_size", 0);
+  gMaxSize = get_size_property("libc.debug.malloc.guard.max_size", MAX_SIZE_T);
+  gSampleRate = get_size_property("libc.debug.malloc.guard.sample_rate", 1);
+  if (gSampleRate == 0) {
+    gSampleRate = 1;
+  }
+  gLimitBytes = get_size_property("libc.debug.malloc.guard.limit_kb", DEFAULT_LIMIT_KB) * 1024;
+  gQuarantineSize = get_size_property("libc.debug.malloc.guard.quarantine", DEFAULT_QUARANTINE);
+  if (gQuarantineSize != 0) {
+    gQuarantine = static_cast<quarantined_run_t*>(dlcalloc(gQuarantineSize, sizeof(quarantined_run_t)));
+    if (gQuarantine == NULL) {
+      gQuarantineSize = 0;
+    }
+  }
+
+  info_log("guard pages for %zu..%zu byte blocks, 1 in %zu, limit %zu KiB, quarantine %zu\n",
+           gMinSize, gMaxSize, gSampleRate, gLimitBytes / 1024, gQuarantineSize);
+}
+
+// Decides whether this allocation gets guarded, and if so reserves 'map_size' bytes of the limit.
+static bool reserve_guarded(size_t bytes, size_t map_size) {
+  if (bytes < gMinSize || bytes > gMaxSize) {
+    return false;
+  }
+  ScopedPthreadMutexLocker locker(&gGuardLock);
+  if ((gSampleCounter++ % gSampleRate) != 0) {
+    return false;
+  }
+  if (gGuardedBytes + map_size > gLimitBytes) {
+    return false;
+  }
+  gGuardedBytes += map_size;
+  return true;
+}
+
+static void release_guarded(size_t map_size) {
+  ScopedPthreadMutexLocker locker(&gGuardLock);
+  gGuardedBytes -= map_size;
+}
+
+static void* guarded_alloc(size_t alignment, size_t bytes) {
+  // Room for the header, the block and the alignment slack, rounded up to whole pages,
+  // plus the guard page.
+  size_t data_size = sizeof(guard_hdr_t) + (alignment - 1) + bytes;
+  if (data_size < bytes || data_size > MAX_SIZE_T - 2 * PAGE_SIZE) { // Overflow.
+    return NULL;
+  }
+  size_t map_size = ((data_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1)) + PAGE_SIZE;
+  if (!reserve_guarded(bytes, map_size)) {
+    return NULL;
+  }
+
+  void* base = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (base == MAP_FAILED) {
+    release_guarded(map_size);
+    return NULL;
+  }
+  uintptr_t guard_page = reinterpret_cast<uintptr_t>(base) + map_size - PAGE_SIZE;
+  if (mprotect(reinterpret_cast<void*>(guard_page), PAGE_SIZE, PROT_NONE) == -1) {
+    munmap(base, map_size);
+    release_guarded(map_size);
+    return NULL;
+  }
+
+  // Overruns fault on the first byte past the block, give or take the alignment padding.
+  void* user = reinterpret_cast<void*>((guard_page - bytes) & ~(alignment - 1));
+  guard_hdr_t* hdr = meta(user);
+  hdr->tag = GUARDED_TAG;
+  hdr->base = base;
+  hdr->map_size = map_size;
+  hdr->size = bytes;
+  return user;
+}
+
+static void* passthrough_alloc(size_t alignment, size_t bytes) {
+  size_t size = sizeof(guard_hdr_t) + (alignment - MALLOC_ALIGNMENT) + bytes;
+  if (size < bytes) { // Overflow.
+    return NULL;
+  }
+  void* base = dlmalloc(size);
+  if (base == NULL) {
+    return NULL;
+  }
+  uintptr_t ptr = reinterpret_cast<uintptr_t>(base) + sizeof(guard_hdr_t);
+  ptr += ((-ptr) % alignment);
+
+  void* user = reinterpret_cast<void*>(ptr);
+  guard_hdr_t* hdr = meta(user);
+  hdr->tag = PASSTHROUGH_TAG;
+  hdr->base = base;
+  hdr->map_size = 0;
+  hdr->size = bytes;
+  return user;
+}
+
+static void quarantine(void* base, size_t map_size) {
+  // Drop the pages' contents and make the whole run inaccessible, header included,
+  // so any later access (including a second free) faults.
+  madvise(base, map_size, MADV_DONTNEED);
+  mprotect(base, map_size, PROT_NONE);
+
+  quarantined_run_t evicted = { NULL, 0 };
+  {
+    ScopedPthreadMutexLocker locker(&gGuardLock);
+    gGuardedBytes -= map_size;
+    if (gQuarantineSize == 0) {
+      evicted.base = base;
+      evicted.map_size = map_size;
+    } else {
+      if (gQuarantineCount == gQuarantineSize) {
+        evicted = gQuarantine[gQuarantineHead];
+        gQuarantineHead = (gQuarantineHead + 1) % gQuarantineSize;
+        --gQuarantineCount;
+      }
+      quarantined_run_t* slot = &gQuarantine[(gQuarantineHead + gQuarantineCount) % gQuarantineSize];
+      slot->base = base;
+      slot->map_size = map_size;
+      ++gQuarantineCount;
+    }
+  }
+  if (evicted.base != NULL) {
+    munmap(evicted.base, evicted.map_size);
+  }
+}
+
+static void report_bad_pointer(const char* what, const void* mem, uint32_t tag) {
+  error_log("+++ %s %p HAS INVALID TAG %08x\n", what, mem, tag);
+  uintptr_t bt[MAX_BACKTRACE_DEPTH];
+  int depth = get_backtrace(bt, MAX_BACKTRACE_DEPTH);
+  log_backtrace(bt, depth);
+}
+
+extern "C" void* guard_malloc(size_t bytes) {
+  void* result = guarded_alloc(MALLOC_ALIGNMENT, bytes);
+  if (result == NULL) {
+    result = passthrough_alloc(MALLOC_ALIGNMENT, bytes);
+  }
+  return result;
+}
+
+extern "C" void guard_free(void* mem) {
+  if (mem == NULL) {
+    return;
+  }
+
+  guard_hdr_t* hdr = meta(mem);
+  if (hdr->tag == PASSTHROUGH_TAG) {
+    hdr->tag = 0;
+    dlfree(hdr->base);
+  } else if (hdr->tag == GUARDED_TAG) {
+    quarantine(hdr->base, hdr->map_size);
+  } else {
+    report_bad_pointer("FREE OF ALLOCATION", mem, hdr->tag);
+  }
+}
+
+extern "C" void* guard_calloc(size_t n_elements, size_t elem_size) {
+  if (n_elements && MAX_SIZE_T / n_elements < elem_size) {
+    return NULL;
+  }
+  size_t size = n_elements * elem_size;
+  void* ptr = guard_malloc(size);
+  if (ptr != NULL && meta(ptr)->tag == PASSTHROUGH_TAG) {
+    // Fresh mmapped pages are already zeroed.
+    memset(ptr, 0, size);
+  }
+  return ptr;
+}
+
+extern "C" void* guard_realloc(void* mem, size_t bytes) {
+  if (mem == NULL) {
+    return guard_malloc(bytes);
+  }
+
+  guard_hdr_t* hdr = meta(mem);
+  if (hdr->tag != GUARDED_TAG && hdr->tag != PASSTHROUGH_TAG) {
+    report_bad_pointer("REALLOCATION OF ALLOCATION", mem, hdr->tag);
+    return NULL;
+  }
+
+  // Always move, so that stale pointers to the old block fault.
+  void* new_mem = guard_malloc(bytes);
+  if (new_mem != NULL) {
+    memcpy(new_mem, mem, (hdr->size < bytes) ? hdr->size : bytes);
+    guard_free(mem);
+  }
+  return new_mem;
+}
+
+extern "C" void* guard_memalign(size_t alignment, size_t bytes) {
+  if (alignment <= MALLOC_ALIGNMENT) {
+    return guard_malloc(bytes);
+  }
+
+  // Make the alignment a power of two.
+  if (alignment & (alignment-1)) {
+    alignment = 1L << (31 - __builtin_clz(alignment));
+  }
+
+  void* result = guarded_alloc(alignment, bytes);
+  if (result == NULL) {
+    result = passthrough_alloc(alignment, bytes);
+  }
+  return result;
+}
+
+extern "C" size_t guard_malloc_usable_size(const void* mem) {
+  if (mem == NULL) {
+    return 0;
+  }
+  const guard_hdr_t* hdr = const_meta(mem);
+  if (hdr->tag != GUARDED_TAG && hdr->tag != PASSTHROUGH_TAG) {
+    return 0;
+  }
+  // Anything past the requested size is either the guard page or would hide overruns.
+  return hdr->size;
+}
@@ -28,6 +28,10 @@
 
 #include "pthread_internal.h"
 #include <errno.h>
+#include <limits.h>
+
+#include "bionic_atomic_inline.h"
+#include "bionic_futex.h"
 
 /* Technical note:
  *
@@ -45,17 +49,35 @@
  *  - Posix states that behavior is undefined it a thread tries to acquire
  *    the lock in two distinct modes (e.g. write after read, or read after write).
  *
- *  - This implementation tries to avoid writer starvation by making the readers
- *    block as soon as there is a waiting writer on the lock. However, it cannot
- *    completely eliminate it: each time the lock is unlocked, all waiting threads
- *    are woken and battle for it, which one gets it depends on the kernel scheduler
- *    and is semi-random.
+ * All of this lives in a single 'state' word, so that taking or releasing
+ * the lock when nobody has to wait is a single compare-and-swap, and readers
+ * never touch anything but that word.
+ *
+ * Threads that have to wait register themselves under 'pending_lock', and
+ * sleep on one of two futexes: readers on 'pending_reader_wakeup_serial',
+ * writers on 'pending_writer_wakeup_serial'. Releasing the lock wakes a
+ * single writer if there are any, and all the readers otherwise.
  *
+ * Writers are preferred: as long as a writer is waiting, new readers block
+ * instead of joining the current ones, so a steady stream of readers can't
+ * starve writers.
  */
 
 #define  RWLOCKATTR_DEFAULT     0
 #define  RWLOCKATTR_SHARED_MASK 0x0010
 
+/* The layout of the 'state' word. */
+#define  STATE_OWNED_BY_WRITER_FLAG      (1 << 0)
+#define  STATE_HAVE_PENDING_READERS_FLAG (1 << 1)
+#define  STATE_HAVE_PENDING_WRITERS_FLAG (1 << 2)
+#define  STATE_PROCESS_SHARED_FLAG       (1 << 3)
+#define  STATE_READER_COUNT_SHIFT        4
+#define  STATE_READER_COUNT_ONE          (1 << STATE_READER_COUNT_SHIFT)
+#define  STATE_READER_COUNT_MAX          (INT_MAX >> STATE_READER_COUNT_SHIFT)
+
+#define  STATE_READER_COUNT(s)  (((s) >> STATE_READER_COUNT_SHIFT) & STATE_READER_COUNT_MAX)
+#define  STATE_IS_SHARED(s)     (((s) & STATE_PROCESS_SHARED_FLAG) != 0)
+
 extern pthread_internal_t* __get_thread(void);
 
 int pthread_rwlockattr_init(pthread_rwlockattr_t *attr)
@@ -103,38 +125,30 @@ int pthread_rwlockattr_getpshared(pthread_rwlockattr_t *attr, int *pshared)
 int pthread_rwlock_init(pthread_rwlock_t *rwlock, const pthread_rwlockattr_t *attr)
 {
     pthread_mutexattr_t*  lock_attr = NULL;
-    pthread_condattr_t*   cond_attr = NULL;
     pthread_mutexattr_t   lock_attr0;
-    pthread_condattr_t    cond_attr0;
     int                   ret;
 
     if (rwlock == NULL)
         return EINVAL;
 
+    rwlock->state = 0;
     if (attr && *attr == PTHREAD_PROCESS_SHARED) {
         lock_attr = &lock_attr0;
         pthread_mutexattr_init(lock_attr);
         pthread_mutexattr_setpshared(lock_attr, PTHREAD_PROCESS_SHARED);
-
-        cond_attr = &cond_attr0;
-        pthread_condattr_init(cond_attr);
-        pthread_condattr_setpshared(cond_attr, PTHREAD_PROCESS_SHARED);
+        rwlock->state = STATE_PROCESS_SHARED_FLAG;
     }
 
-    ret = pthread_mutex_init(&rwlock->lock, lock_attr);
+    ret = pthread_mutex_init(&rwlock->pending_lock, lock_attr);
     if (ret != 0)
         return ret;
 
-    ret = pthread_cond_init(&rwlock->cond, cond_attr);
-    if (ret != 0) {
-        pthread_mutex_destroy(&rwlock->lock);
-        return ret;
-    }
-
-    rwlock->numLocks = 0;
-    rwlock->pendingReaders = 0;
-    rwlock->pendingWriters = 0;
-    rwlock->writerThreadId = 0;
+    rwlock->writer_thread_id = 0;
+    rwlock->write_lock_count = 0;
+    rwlock->pending_reader_count = 0;
+    rwlock->pending_writer_count = 0;
+    rwlock->pending_reader_wakeup_serial = 0;
+    rwlock->pending_writer_wakeup_serial = 0;
 
     return 0;
 }
@@ -144,57 +158,153 @@ int pthread_rwlock_destroy(pthread_rwlock_t *rwlock)
     if (rwlock == NULL)
         return EINVAL;
 
-    if (rwlock->numLocks > 0)
+    if (rwlock->writer_thread_id != 0 || STATE_READER_COUNT(rwlock->state) != 0)
         return EBUSY;
 
-    pthread_cond_destroy(&rwlock->cond);
-    pthread_mutex_destroy(&rwlock->lock);
+    pthread_mutex_destroy(&rwlock->pending_lock);
     return 0;
 }
 
-/* Returns TRUE iff we can acquire a read lock. */
-static __inline__ int read_precondition(pthread_rwlock_t* rwlock, int tid)
+/* Atomically set or clear 'flag' in the lock's state. */
+static void _rwlock_set_state_flag(pthread_rwlock_t* rwlock, int flag, int set)
 {
-    /* We can't have the lock if any writer is waiting for it (writer bias).
-     * This tries to avoid starvation when there are multiple readers racing.
-     */
-    if (rwlock->pendingWriters > 0)
-        return 0;
-
-    /* We can have the lock if there is no writer, or if we write-own it */
-    /* The second test avoids a self-dead lock in case of buggy code. */
-    if (rwlock->writerThreadId == 0 || rwlock->writerThreadId == tid)
-        return 1;
+    for (;;) {
+        int old_state = rwlock->state;
+        int new_state = set ? (old_state | flag) : (old_state & ~flag);
+        if (old_state == new_state || __bionic_cmpxchg(old_state, new_state, &rwlock->state) == 0)
+            break;
+    }
+}
 
-    /* Otherwise, we can't have it */
-    return 0;
+/* Returns TRUE iff a new reader can take the lock in 'state'. A waiting
+ * writer keeps new readers out (writer bias).
+ */
+static __inline__ int read_precondition(int state)
+{
+    return (state & (STATE_OWNED_BY_WRITER_FLAG|STATE_HAVE_PENDING_WRITERS_FLAG)) == 0;
 }
 
-/* returns TRUE iff we can acquire a write lock. */
-static __inline__ int write_precondition(pthread_rwlock_t* rwlock, int tid)
+/* Returns TRUE iff a writer can take the lock in 'state'. */
+static __inline__ int write_precondition(int state)
 {
-    /* We can get the lock if nobody has it */
-    if (rwlock->numLocks == 0)
-        return 1;
+    return (state & STATE_OWNED_BY_WRITER_FLAG) == 0 && STATE_READER_COUNT(state) == 0;
+}
 
-    /* Or if we already own it */
-    if (rwlock->writerThreadId == tid)
-        return 1;
+static int __pthread_rwlock_tryrdlock(pthread_rwlock_t* rwlock)
+{
+    int old_state = rwlock->state;
+
+    while (__predict_true(read_precondition(old_state))) {
+        if (__predict_false(STATE_READER_COUNT(old_state) == STATE_READER_COUNT_MAX))
+            return EAGAIN;
+        if (__bionic_cmpxchg(old_state, old_state + STATE_READER_COUNT_ONE, &rwlock->state) == 0) {
+            ANDROID_MEMBAR_FULL();
+            return 0;
+        }
+        old_state = rwlock->state;
+    }
+    return EBUSY;
+}
 
-    /* Otherwise, not */
-    return 0;
+static int __pthread_rwlock_trywrlock(pthread_rwlock_t* rwlock, int tid)
+{
+    int old_state = rwlock->state;
+
+    while (__predict_true(write_precondition(old_state))) {
+        if (__bionic_cmpxchg(old_state, old_state | STATE_OWNED_BY_WRITER_FLAG, &rwlock->state) == 0) {
+            rwlock->writer_thread_id = tid;
+            rwlock->write_lock_count = 1;
+            ANDROID_MEMBAR_FULL();
+            return 0;
+        }
+        old_state = rwlock->state;
+    }
+    return EBUSY;
 }
 
-/* This function is used to waken any waiting thread contending
- * for the lock. One of them should be able to grab it after
- * that.
+/* Wake whoever should get the lock next: a single writer if any are
+ * waiting, all the readers otherwise.
  */
-static void _pthread_rwlock_pulse(pthread_rwlock_t *rwlock)
+static void _pthread_rwlock_wake_waiters(pthread_rwlock_t* rwlock)
 {
-    if (rwlock->pendingReaders > 0 || rwlock->pendingWriters > 0)
-        pthread_cond_broadcast(&rwlock->cond);
+    int shared = STATE_IS_SHARED(rwlock->state);
+
+    pthread_mutex_lock(&rwlock->pending_lock);
+    if (rwlock->pending_writer_count > 0) {
+        rwlock->pending_writer_wakeup_serial++;
+        pthread_mutex_unlock(&rwlock->pending_lock);
+        __futex_wake_ex(&rwlock->pending_writer_wakeup_serial, shared, 1);
+    } else if (rwlock->pending_reader_count > 0) {
+        rwlock->pending_reader_wakeup_serial++;
+        pthread_mutex_unlock(&rwlock->pending_lock);
+        __futex_wake_ex(&rwlock->pending_reader_wakeup_serial, shared, INT_MAX);
+    } else {
+        pthread_mutex_unlock(&rwlock->pending_lock);
+    }
 }
 
+/* Sleep until the lock might be available to a reader (for_writer == 0) or
+ * a writer (for_writer == 1), or until 'abs_timeout' passes. Returns 0 or
+ * ETIMEDOUT.
+ */
+static int _pthread_rwlock_wait(pthread_rwlock_t* rwlock, int for_writer,
+                                const struct timespec* abs_timeout)
+{
+    int*           pending_count = for_writer ? &rwlock->pending_writer_count
+                                              : &rwlock->pending_reader_count;
+    int volatile*  serial = for_writer ? &rwlock->pending_writer_wakeup_serial
+                                       : &rwlock->pending_reader_wakeup_serial;
+    int            pending_flag = for_writer ? STATE_HAVE_PENDING_WRITERS_FLAG
+                                             : STATE_HAVE_PENDING_READERS_FLAG;
+    int            shared = STATE_IS_SHARED(rwlock->state);
+    int            old_serial;
+    int            ret = 0;
+    struct timespec  ts;
+    struct timespec* tsp = NULL;
+
+    if (abs_timeout != NULL) {
+        if (__timespec_to_absolute(&ts, abs_timeout, CLOCK_REALTIME) < 0)
+            return ETIMEDOUT;
+        tsp = &ts;
+    }
+
+    pthread_mutex_lock(&rwlock->pending_lock);
+    ++*pending_count;
+    _rwlock_set_state_flag(rwlock, pending_flag, 1);
+    old_serial = *serial;
+    pthread_mutex_unlock(&rwlock->pending_lock);
+
+    /* Pairs with the barrier in pthread_rwlock_unlock(): either it sees our
+     * flag and wakes us, or we see that the lock has been released. */
+    ANDROID_MEMBAR_FULL();
+    int state = rwlock->state;
+    if (for_writer ? !write_precondition(state) : !read_precondition(state)) {
+        if (__futex_wait_ex(serial, shared, old_serial, tsp) == -ETIMEDOUT)
+            ret = ETIMEDOUT;
+    }
+
+    int wake_readers = 0;
+    pthread_mutex_lock(&rwlock->pending_lock);
+    if (--*pending_count == 0) {
+        _rwlock_set_state_flag(rwlock, pending_flag, 0);
+        /* Readers may be blocked only because we were waiting. If we're giving
+         * up, nobody else will unlock on our behalf, so let them retry now. */
+        if (for_writer && ret == ETIMEDOUT && rwlock->pending_reader_count > 0) {
+            rwlock->pending_reader_wakeup_serial++;
+            wake_readers = 1;
+        }
+    }
+    pthread_mutex_unlock(&rwlock->pending_lock);
+
+    if (wake_readers)
+        __futex_wake_ex(&rwlock->pending_reader_wakeup_serial, shared, INT_MAX);
+
+    /* If we timed out after being woken, pass the wakeup on to somebody else. */
+    if (ret == ETIMEDOUT && *serial != old_serial)
+        _pthread_rwlock_wake_waiters(rwlock);
+
+    return ret;
+}
 
 int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock)
 {
@@ -203,43 +313,43 @@ int pthread_rwlock_rdlock(pthread_rwlock_t *rwlock)
 
 int pthread_rwlock_tryrdlock(pthread_rwlock_t *rwlock)
 {
-    int ret = 0;
-
     if (rwlock == NULL)
         return EINVAL;
 
-    pthread_mutex_lock(&rwlock->lock);
-    if (__predict_false(!read_precondition(rwlock, __get_thread()->tid)))
-        ret = EBUSY;
-    else
-        rwlock->numLocks ++;
-    pthread_mutex_unlock(&rwlock->lock);
+    /* Read-locking a lock we write-own would deadlock; treat it as nested. */
+    if (__predict_false(rwlock->writer_thread_id == __get_thread()->tid)) {
+        rwlock->write_lock_count++;
+        return 0;
+    }
 
-    return ret;
+    return __pthread_rwlock_tryrdlock(rwlock);
 }
 
 int pthread_rwlock_timedrdlock(pthread_rwlock_t *rwlock, const struct timespec *abs_timeout)
 {
-    int ret = 0;
+    int ret;
 
     if (rwlock == NULL)
         return EINVAL;
 
-    pthread_mutex_lock(&rwlock->lock);
-    int tid = __get_thread()->tid;
-    if (__predict_false(!read_precondition(rwlock, tid))) {
-        rwlock->pendingReaders += 1;
-        do {
-            ret = pthread_cond_timedwait(&rwlock->cond, &rwlock->lock, abs_timeout);
-        } while (ret == 0 && !read_precondition(rwlock, tid));
-        rwlock->pendingReaders -= 1;
+    ret = __pthread_rwlock_tryrdlock(rwlock);
+    if (__predict_true(ret != EBUSY))
+        return ret;
+
+    /* Read-locking a lock we write-own would deadlock; treat it as nested. */
+    if (rwlock->writer_thread_id == __get_thread()->tid) {
+        rwlock->write_lock_count++;
+        return 0;
+    }
+
+    for (;;) {
+        ret = _pthread_rwlock_wait(rwlock, 0, abs_timeout);
         if (ret != 0)
-            goto EXIT;
+            return ret;
+        ret = __pthread_rwlock_tryrdlock(rwlock);
+        if (ret != EBUSY)
+            return ret;
     }
-    rwlock->numLocks ++;
-EXIT:
-    pthread_mutex_unlock(&rwlock->lock);
-    return ret;
 }
 
 
@@ -250,87 +360,83 @@ int pthread_rwlock_wrlock(pthread_rwlock_t *rwlock)
 
 int pthread_rwlock_trywrlock(pthread_rwlock_t *rwlock)
 {
-    int ret = 0;
-
     if (rwlock == NULL)
         return EINVAL;
 
-    pthread_mutex_lock(&rwlock->lock);
     int tid = __get_thread()->tid;
-    if (__predict_false(!write_precondition(rwlock, tid))) {
-        ret = EBUSY;
-    } else {
-        rwlock->numLocks ++;
-        rwlock->writerThreadId = tid;
+    if (__predict_false(rwlock->writer_thread_id == tid)) {
+        rwlock->write_lock_count++;
+        return 0;
     }
-    pthread_mutex_unlock(&rwlock->lock);
-    return ret;
+
+    return __pthread_rwlock_trywrlock(rwlock, tid);
 }
 
 int pthread_rwlock_timedwrlock(pthread_rwlock_t *rwlock, const struct timespec *abs_timeout)
 {
-    int ret = 0;
+    int ret;
 
     if (rwlock == NULL)
         return EINVAL;
 
-    pthread_mutex_lock(&rwlock->lock);
     int tid = __get_thread()->tid;
-    if (__predict_false(!write_precondition(rwlock, tid))) {
-        /* If we can't read yet, wait until the rwlock is unlocked
-         * and try again. Increment pendingReaders to get the
-         * cond broadcast when that happens.
-         */
-        rwlock->pendingWriters += 1;
-        do {
-            ret = pthread_cond_timedwait(&rwlock->cond, &rwlock->lock, abs_timeout);
-        } while (ret == 0 && !write_precondition(rwlock, tid));
-        rwlock->pendingWriters -= 1;
+    if (__predict_false(rwlock->writer_thread_id == tid)) {
+        rwlock->write_lock_count++;
+        return 0;
+    }
+
+    for (;;) {
+        ret = __pthread_rwlock_trywrlock(rwlock, tid);
+        if (ret == 0)
+            return 0;
+        ret = _pthread_rwlock_wait(rwlock, 1, abs_timeout);
         if (ret != 0)
-            goto EXIT;
+            return ret;
     }
-    rwlock->numLocks ++;
-    rwlock->writerThreadId = tid;
-EXIT:
-    pthread_mutex_unlock(&rwlock->lock);
-    return ret;
 }
 
 
 int pthread_rwlock_unlock(pthread_rwlock_t *rwlock)
 {
-    int  ret = 0;
+    int  old_state;
+    int  new_state;
 
     if (rwlock == NULL)
         return EINVAL;
 
-    pthread_mutex_lock(&rwlock->lock);
-
-    /* The lock must be held */
-    if (rwlock->numLocks == 0) {
-        ret = EPERM;
-        goto EXIT;
-    }
-
-    /* If it has only readers, writerThreadId is 0 */
-    if (rwlock->writerThreadId == 0) {
-        if (--rwlock->numLocks == 0)
-            _pthread_rwlock_pulse(rwlock);
-    }
-    /* Otherwise, it has only a single writer, which
-     * must be ourselves.
-     */
-    else {
-        if (rwlock->writerThreadId != __get_thread()->tid) {
-            ret = EPERM;
-            goto EXIT;
+    old_state = rwlock->state;
+    if (old_state & STATE_OWNED_BY_WRITER_FLAG) {
+        /* It has a single writer, which must be ourselves. */
+        if (rwlock->writer_thread_id != __get_thread()->tid)
+            return EPERM;
+        if (--rwlock->write_lock_count > 0)
+            return 0;
+        rwlock->writer_thread_id = 0;
+        ANDROID_MEMBAR_FULL();
+        for (;;) {
+            new_state = old_state & ~STATE_OWNED_BY_WRITER_FLAG;
+            if (__bionic_cmpxchg(old_state, new_state, &rwlock->state) == 0)
+                break;
+            old_state = rwlock->state;
         }
-        if (--rwlock->numLocks == 0) {
-            rwlock->writerThreadId = 0;
-            _pthread_rwlock_pulse(rwlock);
+    } else {
+        /* Otherwise it has only readers. */
+        ANDROID_MEMBAR_FULL();
+        for (;;) {
+            if (STATE_READER_COUNT(old_state) == 0)
+                return EPERM;
+            new_state = old_state - STATE_READER_COUNT_ONE;
+            if (__bionic_cmpxchg(old_state, new_state, &rwlock->state) == 0)
+                break;
+            old_state = rwlock->state;
         }
+        if (STATE_READER_COUNT(new_state) != 0)
+            return 0;
     }
-EXIT:
-    pthread_mutex_unlock(&rwlock->lock);
-    return ret;
+
+    /* Pairs with the barrier in _pthread_rwlock_wait(). */
+    ANDROID_MEMBAR_FULL();
+    if (rwlock->state & (STATE_HAVE_PENDING_READERS_FLAG|STATE_HAVE_PENDING_WRITERS_FLAG))
+        _pthread_rwlock_wake_waiters(rwlock);
+    return 0;
 }
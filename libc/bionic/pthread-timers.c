@@ -31,14 +31,12 @@
 #include <errno.h>
 #include <linux/time.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 extern int __pthread_cond_timedwait(pthread_cond_t*, pthread_mutex_t*, const struct timespec*,
                                     clockid_t);
 
-extern int __pthread_cond_timedwait_relative(pthread_cond_t*, pthread_mutex_t*,
-                                             const struct timespec*);
-
 // Normal (i.e. non-SIGEV_THREAD) timers are created directly by the kernel
 // and are passed as is to/from the caller.
 //
@@ -50,18 +48,36 @@ extern int __pthread_cond_timedwait_relative(pthread_cond_t*, pthread_mutex_t*,
 // www.opengroup.org/onlinepubs/000095399/functions/xsh_chap02_04.html#tag_02_04_01
 //
 // The Linux kernel doesn't support these, so we need to implement them in the
-// C library. We use a very basic scheme where each timer is associated to a
-// thread that will loop, waiting for timeouts or messages from the program
-// corresponding to calls to timer_settime() and timer_delete().
+// C library. Each clock that has SIGEV_THREAD timers gets one service thread,
+// which keeps that clock's armed timers in a min-heap ordered by expiration
+// time and sleeps on a condition variable until the earliest one is due (or
+// until timer_settime() or timer_delete() changes the head of the heap).
+//
+// The service thread never runs callbacks itself. Expired timers are queued
+// for a small pool of worker threads, created as needed, so that thousands of
+// timers cost a handful of threads rather than one thread each. A timer only
+// ever has one notification waiting in the queue: if it expires again before
+// a worker gets to it, the expiration is counted as an overrun instead, as are
+// periods that went by entirely while the service thread was late. A
+// callback's timer_getoverrun() reports the overruns counted up to the point
+// the callback started.
+//
+// Timers created with their own sigev_notify_attributes can't share pool
+// threads, so each of their notifications gets a new thread with those
+// attributes, and an expiration while one is still running counts as an
+// overrun.
+//
+// All of this state is protected by the table lock.
 //
 // Note also an important thing: Posix mandates that in the case of fork(),
 // the timers of the child process should be disarmed, but not deleted.
-// this is implemented by providing a fork() wrapper (see bionic/fork.c) which
-// stops all timers before the fork, and only re-start them in case of error
-// or in the parent process.
+// This is implemented by the fork() wrapper (see bionic/fork.c), which stops
+// all timers before the fork by holding the table lock across it, and
+// re-starts them in the parent, while the child disarms them all and forgets
+// about the service and worker threads it didn't inherit.
 //
-// This stop/start is implemented by the __timer_table_start_stop() function
-// below.
+// This stop/start is implemented by the __timer_table_start_stop() and
+// __timer_table_fork_child() functions below.
 //
 // A SIGEV_THREAD timer ID will always have its TIMER_ID_WRAP_BIT
 // set to 1. In this implementation, this is always bit 31, which is
@@ -76,8 +92,8 @@ extern int __pthread_cond_timedwait_relative(pthread_cond_t*, pthread_mutex_t*,
 
 /* this value is used internally to indicate a 'free' or 'zombie'
  * thr_timer structure. Here, 'zombie' means that timer_delete()
- * has been called, but that the corresponding thread hasn't
- * exited yet.
+ * has been called, but that a notification for the timer is still
+ * queued or running.
  */
 #define  TIMER_ID_NONE            ((timer_t)0xffffffff)
 
@@ -87,7 +103,19 @@ extern int __pthread_cond_timedwait_relative(pthread_cond_t*, pthread_mutex_t*,
 /* the maximum value of overrun counters */
 #define  DELAYTIMER_MAX    0x7fffffff
 
+/* timers are allocated in chunks, as needed */
+#define  TIMERS_PER_CHUNK     256
+#define  MAX_TIMER_CHUNKS     64
+#define  MAX_THREAD_TIMERS    (TIMERS_PER_CHUNK * MAX_TIMER_CHUNKS)
+
+/* the number of distinct clocks that can have SIGEV_THREAD timers */
+#define  MAX_TIMER_SERVICES   8
+
+/* the number of pool threads running callbacks */
+#define  MAX_TIMER_WORKERS    4
+
 typedef struct thr_timer          thr_timer_t;
+typedef struct thr_timer_service  thr_timer_service_t;
 typedef struct thr_timer_table    thr_timer_table_t;
 
 /* The Posix spec says the function receives an unsigned parameter, but
@@ -95,113 +123,107 @@ typedef struct thr_timer_table    thr_timer_table_t;
 typedef void (*thr_timer_func_t)( sigval_t );
 
 struct thr_timer {
-    thr_timer_t*       next;     /* next in free list */
-    timer_t            id;       /* TIMER_ID_NONE iff free or dying */
-    clockid_t          clock;
-    pthread_t          thread;
-    pthread_attr_t     attributes;
-    thr_timer_func_t   callback;
-    sigval_t           value;
-
-    /* the following are used to communicate between
-     * the timer thread and the timer_XXX() functions
-     */
-    pthread_mutex_t           mutex;     /* lock */
-    pthread_cond_t            cond;      /* signal a state change to thread */
-    int volatile              done;      /* set by timer_delete */
-    int volatile              stopped;   /* set by _start_stop() */
-    struct timespec volatile  expires;   /* next expiration time, or 0 */
-    struct timespec volatile  period;    /* reload value, or 0 */
-    int volatile              overruns;  /* current number of overruns */
+    thr_timer_t*          next;        /* next in free list or work queue */
+    timer_t               id;          /* TIMER_ID_NONE iff free or zombie */
+    int                   index;       /* position in the table */
+    thr_timer_service_t*  service;     /* the service thread for our clock */
+    thr_timer_func_t      callback;
+    sigval_t              value;
+    int                   has_attributes;
+    pthread_attr_t        attributes;  /* for notification threads, if has_attributes */
+
+    struct timespec       expires;     /* next expiration time, or 0 */
+    struct timespec       period;      /* reload value, or 0 */
+    int                   heap_index;  /* position in the service's heap, or -1 */
+    int                   queued;      /* a notification is waiting to run */
+    int                   running;     /* number of callbacks in progress */
+    int                   overruns;    /* overruns since the last notification started */
+    int                   delivered_overruns;  /* reported by timer_getoverrun() */
 };
 
-#define  MAX_THREAD_TIMERS  32
+struct thr_timer_service {
+    clockid_t        clock;
+    int              started;       /* has the service thread been created? */
+    pthread_cond_t   cond;          /* signals a new head of the heap */
+    thr_timer_t**    heap;          /* armed timers, earliest expiration first */
+    int              heap_size;
+    int              heap_capacity; /* always enough for all of 'timer_count' */
+    int              timer_count;   /* timers on this clock */
+};
 
 struct thr_timer_table {
-    pthread_mutex_t  lock;
-    thr_timer_t*     free_timer;
-    thr_timer_t      timers[ MAX_THREAD_TIMERS ];
+    pthread_mutex_t      lock;
+    thr_timer_t*         free_timer;
+    int                  timer_count;   /* timers ever allocated */
+    thr_timer_t*         chunks[ MAX_TIMER_CHUNKS ];
+
+    thr_timer_service_t  services[ MAX_TIMER_SERVICES ];
+    int                  service_count;
+
+    thr_timer_t*         work_head;     /* notifications waiting for a worker */
+    thr_timer_t*         work_tail;
+    pthread_cond_t       work_cond;
+    int                  worker_count;
+    int                  idle_worker_count;
 };
 
+static void* timer_service_start(void*);
+static void* timer_worker_start(void*);
+static void* timer_notification_start(void*);
+
 /** GLOBAL TABLE OF THREAD TIMERS
  **/
 
 static void
 thr_timer_table_init( thr_timer_table_t*  t )
 {
-    int  nn;
-
     memset(t, 0, sizeof *t);
     pthread_mutex_init( &t->lock, NULL );
-
-    for (nn = 0; nn < MAX_THREAD_TIMERS; nn++)
-        t->timers[nn].id = TIMER_ID_NONE;
-
-    t->free_timer = &t->timers[0];
-    for (nn = 1; nn < MAX_THREAD_TIMERS; nn++)
-        t->timers[nn-1].next = &t->timers[nn];
+    pthread_cond_init( &t->work_cond, NULL );
 }
 
+/* the following functions must be called with the table lock held */
 
 static thr_timer_t*
 thr_timer_table_alloc( thr_timer_table_t*  t )
 {
-    thr_timer_t*  timer;
+    thr_timer_t*  timer = t->free_timer;
 
-    if (t == NULL)
-        return NULL;
-
-    pthread_mutex_lock(&t->lock);
-    timer = t->free_timer;
     if (timer != NULL) {
         t->free_timer = timer->next;
-        timer->next   = NULL;
-        timer->id     = TIMER_ID_WRAP((timer - t->timers));
+    } else {
+        int  chunk = t->timer_count / TIMERS_PER_CHUNK;
+
+        if (t->timer_count == MAX_THREAD_TIMERS)
+            return NULL;
+
+        if (t->chunks[chunk] == NULL) {
+            t->chunks[chunk] = calloc(TIMERS_PER_CHUNK, sizeof(thr_timer_t));
+            if (t->chunks[chunk] == NULL)
+                return NULL;
+        }
+        timer = &t->chunks[chunk][t->timer_count % TIMERS_PER_CHUNK];
+        timer->index = t->timer_count++;
     }
-    pthread_mutex_unlock(&t->lock);
+
+    timer->next = NULL;
+    timer->id   = TIMER_ID_WRAP(timer->index);
     return timer;
 }
 
-
 static void
 thr_timer_table_free( thr_timer_table_t*  t, thr_timer_t*  timer )
 {
-    pthread_mutex_lock( &t->lock );
     timer->id     = TIMER_ID_NONE;
-    timer->thread = 0;
     timer->next   = t->free_timer;
     t->free_timer = timer;
-    pthread_mutex_unlock( &t->lock );
 }
 
-
-static void thr_timer_table_start_stop(thr_timer_table_t* t, int stop) {
-  if (t == NULL) {
-    return;
-  }
-
-  pthread_mutex_lock(&t->lock);
-  for (int nn = 0; nn < MAX_THREAD_TIMERS; ++nn) {
-    thr_timer_t*  timer  = &t->timers[nn];
-    if (TIMER_ID_IS_VALID(timer->id)) {
-      // Tell the thread to start/stop.
-      pthread_mutex_lock(&timer->mutex);
-      timer->stopped = stop;
-      pthread_cond_signal( &timer->cond );
-      pthread_mutex_unlock(&timer->mutex);
-    }
-  }
-  pthread_mutex_unlock(&t->lock);
-}
-
-
 /* convert a timer_id into the corresponding thr_timer_t* pointer
  * returns NULL if the id is not wrapped or is invalid/free
  */
 static thr_timer_t*
-thr_timer_table_from_id( thr_timer_table_t*  t,
-                         timer_t             id,
-                         int                 remove )
+thr_timer_table_from_id( thr_timer_table_t*  t, timer_t  id )
 {
     unsigned      index;
     thr_timer_t*  timer;
@@ -210,27 +232,24 @@ thr_timer_table_from_id( thr_timer_table_t*  t,
         return NULL;
 
     index = (unsigned) TIMER_ID_UNWRAP(id);
-    if (index >= MAX_THREAD_TIMERS)
+    if (index >= (unsigned) t->timer_count)
         return NULL;
 
-    pthread_mutex_lock(&t->lock);
-
-    timer = &t->timers[index];
-
-    if (!TIMER_ID_IS_VALID(timer->id)) {
-        timer = NULL;
-    } else {
-        /* if we're removing this timer, clear the id
-         * right now to prevent another thread to
-         * use the same id after the unlock */
-        if (remove)
-            timer->id = TIMER_ID_NONE;
-    }
-    pthread_mutex_unlock(&t->lock);
+    timer = &t->chunks[index / TIMERS_PER_CHUNK][index % TIMERS_PER_CHUNK];
+    if (timer->id != id)
+        return NULL;
 
     return timer;
 }
 
+/* free a deleted timer, unless a notification still needs it */
+static void
+thr_timer_table_release( thr_timer_table_t*  t, thr_timer_t*  timer )
+{
+    if (!timer->queued && timer->running == 0)
+        thr_timer_table_free(t, timer);
+}
+
 /* the static timer table - we only create it if the process
  * really wants to use SIGEV_THREAD timers, which should be
  * pretty infrequent
@@ -260,29 +279,58 @@ static thr_timer_table_t* __timer_table_get(void) {
  **/
 __LIBC_HIDDEN__ void __timer_table_start_stop(int stop) {
   // We access __timer_table directly so we don't create it if it doesn't yet exist.
-  thr_timer_table_start_stop(__timer_table, stop);
+  thr_timer_table_t* t = __timer_table;
+  if (t == NULL) {
+    return;
+  }
+
+  // Holding the lock keeps the service threads from dispatching anything,
+  // and means that the child gets a consistent table.
+  if (stop) {
+    pthread_mutex_lock(&t->lock);
+  } else {
+    pthread_mutex_unlock(&t->lock);
+  }
 }
 
-static thr_timer_t*
-thr_timer_from_id( timer_t   id )
-{
-    thr_timer_table_t*  table = __timer_table_get();
-    thr_timer_t*        timer = thr_timer_table_from_id( table, id, 0 );
+__LIBC_HIDDEN__ void __timer_table_fork_child(void) {
+  thr_timer_table_t* t = __timer_table;
+  if (t == NULL) {
+    return;
+  }
 
-    return timer;
-}
+  // None of our service or worker threads exist in the child. Disarm every
+  // timer, and drop pending notifications (freeing timers that had only been
+  // kept for them), so that timer_settime() starts from scratch.
+  for (int i = 0; i < t->service_count; ++i) {
+    thr_timer_service_t* service = &t->services[i];
+    service->started = 0;
+    service->heap_size = 0;
+    pthread_cond_init(&service->cond, NULL);
+  }
 
+  for (int i = 0; i < t->timer_count; ++i) {
+    thr_timer_t* timer = &t->chunks[i / TIMERS_PER_CHUNK][i % TIMERS_PER_CHUNK];
+    int zombie = !TIMER_ID_IS_VALID(timer->id) && (timer->queued || timer->running != 0);
 
-static __inline__ void
-thr_timer_lock( thr_timer_t*  t )
-{
-    pthread_mutex_lock(&t->mutex);
-}
+    timer->heap_index = -1;
+    timer->queued = 0;
+    timer->running = 0;
+    timer->overruns = 0;
+    timer->expires.tv_sec = timer->expires.tv_nsec = 0;
+    timer->period.tv_sec = timer->period.tv_nsec = 0;
+    if (zombie) {
+      thr_timer_table_free(t, timer);
+    }
+  }
 
-static __inline__ void
-thr_timer_unlock( thr_timer_t*  t )
-{
-    pthread_mutex_unlock(&t->mutex);
+  t->work_head = t->work_tail = NULL;
+  t->worker_count = 0;
+  t->idle_worker_count = 0;
+  pthread_cond_init(&t->work_cond, NULL);
+
+  // Taken by __timer_table_start_stop(1) before the fork.
+  pthread_mutex_unlock(&t->lock);
 }
 
 
@@ -295,6 +343,10 @@ static __inline__ void timespec_add(struct timespec* a, const struct timespec* b
   }
 }
 
+static __inline__ int64_t timespec_to_ns(const struct timespec* a) {
+  return (int64_t) a->tv_sec * 1000000000 + a->tv_nsec;
+}
+
 static __inline__ void timespec_sub(struct timespec* a, const struct timespec* b) {
   a->tv_sec  -= b->tv_sec;
   a->tv_nsec -= b->tv_nsec;
@@ -328,6 +380,324 @@ static __inline__ int timespec_cmp0(const struct timespec* a) {
   return 0;
 }
 
+/** TIMER HEAPS
+ **
+ ** Binary min-heaps of armed timers, ordered by expiration time. Each timer
+ ** remembers its position so that it can be removed when it's re-armed,
+ ** disarmed or deleted.
+ **/
+
+static __inline__ void
+thr_timer_heap_set( thr_timer_service_t*  s, int  i, thr_timer_t*  timer )
+{
+    s->heap[i] = timer;
+    timer->heap_index = i;
+}
+
+static void
+thr_timer_heap_up( thr_timer_service_t*  s, int  i )
+{
+    thr_timer_t*  timer = s->heap[i];
+
+    while (i > 0) {
+        int  parent = (i - 1) / 2;
+        if (timespec_cmp(&s->heap[parent]->expires, &timer->expires) <= 0)
+            break;
+        thr_timer_heap_set(s, i, s->heap[parent]);
+        i = parent;
+    }
+    thr_timer_heap_set(s, i, timer);
+}
+
+static void
+thr_timer_heap_down( thr_timer_service_t*  s, int  i )
+{
+    thr_timer_t*  timer = s->heap[i];
+
+    for (;;) {
+        int  child = 2*i + 1;
+        if (child >= s->heap_size)
+            break;
+        if (child + 1 < s->heap_size &&
+            timespec_cmp(&s->heap[child + 1]->expires, &s->heap[child]->expires) < 0)
+            child++;
+        if (timespec_cmp(&timer->expires, &s->heap[child]->expires) <= 0)
+            break;
+        thr_timer_heap_set(s, i, s->heap[child]);
+        i = child;
+    }
+    thr_timer_heap_set(s, i, timer);
+}
+
+static void
+thr_timer_heap_insert( thr_timer_service_t*  s, thr_timer_t*  timer )
+{
+    /* there's always room: see thr_timer_service_get() */
+    thr_timer_heap_set(s, s->heap_size++, timer);
+    thr_timer_heap_up(s, timer->heap_index);
+}
+
+static void
+thr_timer_heap_remove( thr_timer_service_t*  s, thr_timer_t*  timer )
+{
+    int           i    = timer->heap_index;
+    thr_timer_t*  last = s->heap[--s->heap_size];
+
+    timer->heap_index = -1;
+    if (last != timer) {
+        thr_timer_heap_set(s, i, last);
+        thr_timer_heap_up(s, i);
+        thr_timer_heap_down(s, last->heap_index);
+    }
+}
+
+/** SERVICE AND WORKER THREADS
+ **/
+
+static int
+thr_timer_create_detached( void* (*start)(void*), void*  arg )
+{
+    pthread_t       thread;
+    pthread_attr_t  attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    return pthread_create(&thread, &attr, start, arg);
+}
+
+/* make sure the service thread is running. returns 0 or an errno value */
+static int
+thr_timer_service_start( thr_timer_service_t*  s )
+{
+    if (!s->started) {
+        int  ret = thr_timer_create_detached(timer_service_start, s);
+        if (ret != 0)
+            return ret;
+        s->started = 1;
+    }
+    return 0;
+}
+
+/* find or create the service for 'clock', with room in its heap for one
+ * more timer. returns NULL on failure, with errno set */
+static thr_timer_service_t*
+thr_timer_service_get( thr_timer_table_t*  t, clockid_t  clock )
+{
+    thr_timer_service_t*  s = NULL;
+    int                   nn;
+
+    for (nn = 0; nn < t->service_count; nn++) {
+        if (t->services[nn].clock == clock) {
+            s = &t->services[nn];
+            break;
+        }
+    }
+
+    if (s == NULL) {
+        if (t->service_count == MAX_TIMER_SERVICES) {
+            errno = EAGAIN;
+            return NULL;
+        }
+        s = &t->services[t->service_count++];
+        s->clock = clock;
+        pthread_cond_init(&s->cond, NULL);
+    }
+
+    if (s->timer_count == s->heap_capacity) {
+        int            capacity = (s->heap_capacity == 0) ? 16 : 2 * s->heap_capacity;
+        thr_timer_t**  heap = realloc(s->heap, capacity * sizeof(thr_timer_t*));
+        if (heap == NULL) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        s->heap = heap;
+        s->heap_capacity = capacity;
+    }
+
+    int ret = thr_timer_service_start(s);
+    if (ret != 0) {
+        errno = ret;
+        return NULL;
+    }
+    return s;
+}
+
+static __inline__ void
+thr_timer_add_overruns( thr_timer_t*  timer, int64_t  count )
+{
+    if (count < DELAYTIMER_MAX - timer->overruns)
+        timer->overruns += (int) count;
+    else
+        timer->overruns = DELAYTIMER_MAX;
+}
+
+static __inline__ void
+thr_timer_add_overrun( thr_timer_t*  timer )
+{
+    thr_timer_add_overruns(timer, 1);
+}
+
+/* hand an expired timer's notification over to a worker */
+static void
+thr_timer_notify( thr_timer_table_t*  t, thr_timer_t*  timer )
+{
+    if (timer->queued) {
+        thr_timer_add_overrun(timer);
+        return;
+    }
+
+    if (timer->has_attributes) {
+        pthread_t  thread;
+
+        if (timer->running != 0) {
+            thr_timer_add_overrun(timer);
+            return;
+        }
+        timer->queued = 1;
+        if (pthread_create(&thread, &timer->attributes, timer_notification_start, timer) != 0) {
+            timer->queued = 0;
+            thr_timer_add_overrun(timer);
+        }
+        return;
+    }
+
+    timer->queued = 1;
+    timer->next = NULL;
+    if (t->work_tail != NULL)
+        t->work_tail->next = timer;
+    else
+        t->work_head = timer;
+    t->work_tail = timer;
+
+    if (t->idle_worker_count > 0) {
+        pthread_cond_signal(&t->work_cond);
+    } else if (t->worker_count < MAX_TIMER_WORKERS) {
+        /* if this fails, the notification waits for a busy worker */
+        if (thr_timer_create_detached(timer_worker_start, t) == 0)
+            t->worker_count++;
+    }
+}
+
+/* run a queued notification, releasing the lock around the callback */
+static void
+thr_timer_run( thr_timer_table_t*  t, thr_timer_t*  timer )
+{
+    thr_timer_func_t  callback = timer->callback;
+    sigval_t          value    = timer->value;
+
+    timer->queued = 0;
+    if (!TIMER_ID_IS_VALID(timer->id)) {
+        /* deleted while the notification was pending */
+        thr_timer_table_release(t, timer);
+        return;
+    }
+
+    timer->running++;
+    timer->delivered_overruns = timer->overruns;
+    timer->overruns = 0;
+
+    // NOTE: at this point we trust the callback not to be a
+    //      total moron and pthread_kill() the worker thread
+    pthread_mutex_unlock(&t->lock);
+    callback(value);
+    pthread_mutex_lock(&t->lock);
+
+    timer->running--;
+    if (!TIMER_ID_IS_VALID(timer->id))
+        thr_timer_table_release(t, timer);
+}
+
+static void* timer_service_start(void* arg) {
+  thr_timer_service_t* service = arg;
+  thr_timer_table_t* t = __timer_table;
+
+  pthread_setname_np(pthread_self(), "timer service");
+
+  pthread_mutex_lock(&t->lock);
+  for (;;) {
+    // Wait for something to be armed.
+    if (service->heap_size == 0) {
+      pthread_cond_wait(&service->cond, &t->lock);
+      continue;
+    }
+
+    // Sleep until the earliest timer is due, or the head of the heap changes.
+    thr_timer_t* timer = service->heap[0];
+    struct timespec expires = timer->expires;
+    struct timespec now;
+    clock_gettime(service->clock, &now);
+    if (timespec_cmp(&expires, &now) > 0) {
+      __pthread_cond_timedwait(&service->cond, &t->lock, &expires, service->clock);
+      continue;
+    }
+
+    // It's expired. Reload or disarm it, counting any whole periods we
+    // missed as overruns.
+    thr_timer_heap_remove(service, timer);
+    if (!timespec_is_zero(&timer->period)) {
+      timespec_add(&expires, &timer->period);
+      if (timespec_cmp(&expires, &now) <= 0) {
+        // Skip straight past 'now' rather than a period at a time, since a
+        // short period on a busy system can mean a great many of them.
+        struct timespec late = now;
+        timespec_sub(&late, &expires);
+        int64_t period_ns = timespec_to_ns(&timer->period);
+        int64_t missed = timespec_to_ns(&late) / period_ns + 1;
+        int64_t skip_ns = missed * period_ns;
+        struct timespec skip;
+        skip.tv_sec = skip_ns / 1000000000;
+        skip.tv_nsec = skip_ns % 1000000000;
+        timespec_add(&expires, &skip);
+        thr_timer_add_overruns(timer, missed);
+      }
+      timer->expires = expires;
+      thr_timer_heap_insert(service, timer);
+    } else {
+      timespec_zero(&timer->expires);
+    }
+
+    thr_timer_notify(t, timer);
+  }
+  /* NOTREACHED */
+  return NULL;
+}
+
+static void* timer_worker_start(void* arg) {
+  thr_timer_table_t* t = arg;
+
+  pthread_setname_np(pthread_self(), "timer worker");
+
+  pthread_mutex_lock(&t->lock);
+  for (;;) {
+    while (t->work_head == NULL) {
+      t->idle_worker_count++;
+      pthread_cond_wait(&t->work_cond, &t->lock);
+      t->idle_worker_count--;
+    }
+
+    thr_timer_t* timer = t->work_head;
+    t->work_head = timer->next;
+    if (t->work_head == NULL) {
+      t->work_tail = NULL;
+    }
+    timer->next = NULL;
+
+    thr_timer_run(t, timer);
+  }
+  /* NOTREACHED */
+  return NULL;
+}
+
+static void* timer_notification_start(void* arg) {
+  thr_timer_t* timer = arg;
+  thr_timer_table_t* t = __timer_table;
+
+  pthread_mutex_lock(&t->lock);
+  thr_timer_run(t, timer);
+  pthread_mutex_unlock(&t->lock);
+  return NULL;
+}
+
 /** POSIX TIMERS APIs */
 
 extern int __timer_create(clockid_t, struct sigevent*, timer_t*);
@@ -336,8 +706,6 @@ extern int __timer_gettime(timer_t, struct itimerspec*);
 extern int __timer_settime(timer_t, int, const struct itimerspec*, struct itimerspec*);
 extern int __timer_getoverrun(timer_t);
 
-static void* timer_thread_start(void*);
-
 int timer_create(clockid_t clock_id, struct sigevent* evp, timer_t* timer_id) {
   // If not a SIGEV_THREAD timer, the kernel can handle it without our help.
   if (__predict_true(evp == NULL || evp->sigev_notify != SIGEV_THREAD)) {
@@ -356,49 +724,53 @@ int timer_create(clockid_t clock_id, struct sigevent* evp, timer_t* timer_id) {
     return -1;
   }
 
-  // Create a new timer and its thread.
-  // TODO: use a single global thread for all timers.
   thr_timer_table_t* table = __timer_table_get();
+  if (table == NULL) {
+    errno = ENOMEM;
+    return -1;
+  }
+
+  pthread_mutex_lock(&table->lock);
+
+  // Find (or start) the service thread for this clock.
+  thr_timer_service_t* service = thr_timer_service_get(table, clock_id);
+  if (service == NULL) {
+    pthread_mutex_unlock(&table->lock);
+    return -1;
+  }
+
   thr_timer_t* timer = thr_timer_table_alloc(table);
   if (timer == NULL) {
+    pthread_mutex_unlock(&table->lock);
     errno = ENOMEM;
     return -1;
   }
 
-  // Copy the thread attributes.
-  if (evp->sigev_notify_attributes == NULL) {
-    pthread_attr_init(&timer->attributes);
-  } else {
+  // Copy the thread attributes, if any.
+  timer->has_attributes = (evp->sigev_notify_attributes != NULL);
+  if (timer->has_attributes) {
     timer->attributes = ((pthread_attr_t*) evp->sigev_notify_attributes)[0];
-  }
 
-  // Posix says that the default is PTHREAD_CREATE_DETACHED and
-  // that PTHREAD_CREATE_JOINABLE has undefined behavior.
-  // So simply always use DETACHED :-)
-  pthread_attr_setdetachstate(&timer->attributes, PTHREAD_CREATE_DETACHED);
+    // Posix says that the default is PTHREAD_CREATE_DETACHED and
+    // that PTHREAD_CREATE_JOINABLE has undefined behavior.
+    // So simply always use DETACHED :-)
+    pthread_attr_setdetachstate(&timer->attributes, PTHREAD_CREATE_DETACHED);
+  }
 
+  timer->service = service;
   timer->callback = evp->sigev_notify_function;
   timer->value = evp->sigev_value;
-  timer->clock = clock_id;
-
-  pthread_mutex_init(&timer->mutex, NULL);
-  pthread_cond_init(&timer->cond, NULL);
-
-  timer->done = 0;
-  timer->stopped = 0;
   timer->expires.tv_sec = timer->expires.tv_nsec = 0;
   timer->period.tv_sec = timer->period.tv_nsec  = 0;
+  timer->heap_index = -1;
+  timer->queued = 0;
+  timer->running = 0;
   timer->overruns = 0;
-
-  // Create the thread.
-  int rc = pthread_create(&timer->thread, &timer->attributes, timer_thread_start, timer);
-  if (rc != 0) {
-    thr_timer_table_free(table, timer);
-    errno = rc;
-    return -1;
-  }
+  timer->delivered_overruns = 0;
+  service->timer_count++;
 
   *timer_id = timer->id;
+  pthread_mutex_unlock(&table->lock);
   return 0;
 }
 
@@ -411,24 +783,30 @@ timer_delete( timer_t  id )
     else
     {
         thr_timer_table_t*  table = __timer_table_get();
-        thr_timer_t*        timer = thr_timer_table_from_id(table, id, 1);
+        thr_timer_t*        timer;
 
+        if (table == NULL) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        pthread_mutex_lock(&table->lock);
+        timer = thr_timer_table_from_id(table, id);
         if (timer == NULL) {
+            pthread_mutex_unlock(&table->lock);
             errno = EINVAL;
             return -1;
         }
 
-        /* tell the timer's thread to stop */
-        thr_timer_lock(timer);
-        timer->done = 1;
-        pthread_cond_signal( &timer->cond );
-        thr_timer_unlock(timer);
+        /* disarm the timer and invalidate its id right now. the object
+         * itself is only freed once no notification needs it any more */
+        if (timer->heap_index >= 0)
+            thr_timer_heap_remove(timer->service, timer);
+        timer->service->timer_count--;
+        timer->id = TIMER_ID_NONE;
+        thr_timer_table_release(table, timer);
 
-        /* NOTE: the thread will call __timer_table_free() to free the
-         * timer object. the '1' parameter to thr_timer_table_from_id
-         * above ensured that the object and its timer_id cannot be
-         * reused before that.
-         */
+        pthread_mutex_unlock(&table->lock);
         return 0;
     }
 }
@@ -446,7 +824,7 @@ timer_gettime_internal( thr_timer_t*        timer,
     {
         struct timespec  now;
 
-        clock_gettime( timer->clock, &now );
+        clock_gettime( timer->service->clock, &now );
         timespec_sub(&diff, &now);
 
         /* in case of overrun, return 0 */
@@ -471,15 +849,23 @@ timer_gettime( timer_t  id, struct itimerspec*  ospec )
     if ( __predict_true(!TIMER_ID_IS_WRAPPED(id)) ) {
         return __timer_gettime( id, ospec );
     } else {
-        thr_timer_t*  timer = thr_timer_from_id(id);
+        thr_timer_table_t*  table = __timer_table_get();
+        thr_timer_t*        timer;
 
+        if (table == NULL) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        pthread_mutex_lock(&table->lock);
+        timer = thr_timer_table_from_id(table, id);
         if (timer == NULL) {
+            pthread_mutex_unlock(&table->lock);
             errno = EINVAL;
             return -1;
         }
-        thr_timer_lock(timer);
         timer_gettime_internal( timer, ospec );
-        thr_timer_unlock(timer);
+        pthread_mutex_unlock(&table->lock);
     }
     return 0;
 }
@@ -499,14 +885,34 @@ timer_settime( timer_t                   id,
     if ( __predict_true(!TIMER_ID_IS_WRAPPED(id)) ) {
         return __timer_settime( id, flags, spec, ospec );
     } else {
-        thr_timer_t*        timer = thr_timer_from_id(id);
-        struct timespec     expires, now;
+        thr_timer_table_t*    table = __timer_table_get();
+        thr_timer_t*          timer;
+        thr_timer_service_t*  service;
+        struct timespec       expires, now;
+        int                   ret;
 
+        if (table == NULL) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        pthread_mutex_lock(&table->lock);
+        timer = thr_timer_table_from_id(table, id);
         if (timer == NULL) {
+            pthread_mutex_unlock(&table->lock);
             errno = EINVAL;
             return -1;
         }
-        thr_timer_lock(timer);
+        service = timer->service;
+
+        /* the service thread may be gone if we forked since the
+         * timer was created */
+        ret = thr_timer_service_start(service);
+        if (ret != 0) {
+            pthread_mutex_unlock(&table->lock);
+            errno = ret;
+            return -1;
+        }
 
         /* return current timer value if ospec isn't NULL */
         if (ospec != NULL) {
@@ -514,11 +920,11 @@ timer_settime( timer_t                   id,
         }
 
         /* compute next expiration time. note that if the
-         * new it_interval is 0, we should disarm the timer
+         * new it_value is 0, we should disarm the timer
          */
         expires = spec->it_value;
         if (!timespec_is_zero(&expires)) {
-            clock_gettime( timer->clock, &now );
+            clock_gettime( service->clock, &now );
             if (!(flags & TIMER_ABSTIME)) {
                 timespec_add(&expires, &now);
             } else {
@@ -526,12 +932,19 @@ timer_settime( timer_t                   id,
                     expires = now;
             }
         }
+
+        if (timer->heap_index >= 0)
+            thr_timer_heap_remove(service, timer);
         timer->expires = expires;
         timer->period  = spec->it_interval;
-        thr_timer_unlock( timer );
+        if (!timespec_is_zero(&expires)) {
+            thr_timer_heap_insert(service, timer);
+            /* wake the service thread if we're its new deadline */
+            if (timer->heap_index == 0)
+                pthread_cond_signal(&service->cond);
+        }
 
-        /* signal the change to the thread */
-        pthread_cond_signal( &timer->cond );
+        pthread_mutex_unlock(&table->lock);
     }
     return 0;
 }
@@ -543,110 +956,25 @@ timer_getoverrun(timer_t  id)
     if ( __predict_true(!TIMER_ID_IS_WRAPPED(id)) ) {
         return __timer_getoverrun( id );
     } else {
-        thr_timer_t*  timer = thr_timer_from_id(id);
-        int           result;
+        thr_timer_table_t*  table = __timer_table_get();
+        thr_timer_t*        timer;
+        int                 result;
 
-        if (timer == NULL) {
+        if (table == NULL) {
             errno = EINVAL;
             return -1;
         }
 
-        thr_timer_lock(timer);
-        result = timer->overruns;
-        thr_timer_unlock(timer);
+        pthread_mutex_lock(&table->lock);
+        timer = thr_timer_table_from_id(table, id);
+        if (timer == NULL) {
+            pthread_mutex_unlock(&table->lock);
+            errno = EINVAL;
+            return -1;
+        }
+        result = timer->delivered_overruns;
+        pthread_mutex_unlock(&table->lock);
 
         return result;
     }
 }
-
-
-static void* timer_thread_start(void* arg) {
-  thr_timer_t* timer = arg;
-
-  thr_timer_lock(timer);
-
-  // Give this thread a meaningful name.
-  char name[32];
-  snprintf(name, sizeof(name), "POSIX interval timer 0x%08x", timer->id);
-  pthread_setname_np(pthread_self(), name);
-
-  // We loop until timer->done is set in timer_delete().
-  while (!timer->done) {
-    struct timespec expires = timer->expires;
-    struct timespec period = timer->period;
-
-    // If the timer is stopped or disarmed, wait indefinitely
-    // for a state change from timer_settime/_delete/_start_stop.
-    if (timer->stopped || timespec_is_zero(&expires)) {
-      pthread_cond_wait(&timer->cond, &timer->mutex);
-      continue;
-    }
-
-    // Otherwise, we need to do a timed wait until either a
-    // state change of the timer expiration time.
-    struct timespec now;
-    clock_gettime(timer->clock, &now);
-
-    if (timespec_cmp(&expires, &now) > 0) {
-      // Cool, there was no overrun, so compute the
-      // relative timeout as 'expires - now', then wait.
-      struct timespec diff = expires;
-      timespec_sub(&diff, &now);
-
-      int ret = __pthread_cond_timedwait_relative(&timer->cond, &timer->mutex, &diff);
-
-      // If we didn't time out, it means that a state change
-      // occurred, so loop to take care of it.
-      if (ret != ETIMEDOUT) {
-        continue;
-      }
-    } else {
-      // Overrun was detected before we could wait!
-      if (!timespec_is_zero(&period)) {
-        // For periodic timers, compute total overrun count.
-        do {
-          timespec_add(&expires, &period);
-          if (timer->overruns < DELAYTIMER_MAX) {
-            timer->overruns += 1;
-          }
-        } while (timespec_cmp(&expires, &now) < 0);
-
-        // Backtrack the last one, because we're going to
-        // add the same value just a bit later.
-        timespec_sub(&expires, &period);
-      } else {
-        // For non-periodic timers, things are simple.
-        timer->overruns = 1;
-      }
-    }
-
-    // If we get here, a timeout was detected.
-    // First reload/disarm the timer as needed.
-    if (!timespec_is_zero(&period)) {
-      timespec_add(&expires, &period);
-    } else {
-      timespec_zero(&expires);
-    }
-    timer->expires = expires;
-
-    // Now call the timer callback function. Release the
-    // lock to allow the function to modify the timer setting
-    // or call timer_getoverrun().
-    // NOTE: at this point we trust the callback not to be a
-    //      total moron and pthread_kill() the timer thread
-    thr_timer_unlock(timer);
-    timer->callback(timer->value);
-    thr_timer_lock(timer);
-
-    // Now clear the overruns counter. it only makes sense
-    // within the callback.
-    timer->overruns = 0;
-  }
-
-  thr_timer_unlock(timer);
-
-  // Free the timer object.
-  thr_timer_table_free(__timer_table_get(), timer);
-
-  return NULL;
-}
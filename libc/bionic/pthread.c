@@ -46,6 +46,7 @@ extern void pthread_debug_mutex_unlock_check(pthread_mutex_t *mutex);
 
 extern void _exit_with_stack_teardown(void * stackBase, int stackSize, int retCode);
 extern void _exit_thread(int  retCode);
+extern int  __set_tid_address(int* tid_address);
 
 int  __futex_wake_ex(volatile void *ftx, int pshared, int val)
 {
@@ -88,6 +89,11 @@ void pthread_exit(void * retval)
     void*                stack_base = thread->attr.stack_base;
     int                  stack_size = thread->attr.stack_size;
     int                  user_stack = (thread->attr.flags & PTHREAD_ATTR_FLAG_USER_STACK) != 0;
+    void*                mmap_base  = thread->mmap_base;
+    size_t               mmap_size  = thread->mmap_size;
+    int                  keep_mapping = 0;
+    int                  joinable = 0;
+    pthread_internal_list_t* list;
     sigset_t mask;
 
     // call the cleanup handlers first
@@ -97,10 +103,8 @@ void pthread_exit(void * retval)
         c->__cleanup_routine(c->__cleanup_arg);
     }
 
-    // call the TLS destructors, it is important to do that before removing this
-    // thread from the global list. this will ensure that if someone else deletes
-    // a TLS key, the corresponding value will be set to NULL in this thread's TLS
-    // space (see pthread_key_delete)
+    // call the TLS destructors, and release the pages holding this thread's
+    // values for keys past the direct TLS slots.
     pthread_key_clean_all();
 
     if (thread->alternate_signal_stack != NULL) {
@@ -110,16 +114,28 @@ void pthread_exit(void * retval)
       ss.ss_flags = SS_DISABLE;
       sigaltstack(&ss, NULL);
 
-      // Free it.
-      munmap(thread->alternate_signal_stack, SIGSTKSZ);
+      // Free it, unless it's part of our stack's mapping.
+      if (mmap_base == NULL) {
+        munmap(thread->alternate_signal_stack, SIGSTKSZ);
+      }
       thread->alternate_signal_stack = NULL;
     }
 
     // if the thread is detached, destroy the pthread_internal_t
-    // otherwise, keep it in memory and signal any joiners.
-    pthread_mutex_lock(&gThreadListLock);
+    // otherwise, keep it in memory for whoever joins us.
+    list = _pthread_internal_list_for((pthread_t) thread);
+    pthread_mutex_lock(&list->lock);
     if (thread->attr.flags & PTHREAD_ATTR_FLAG_DETACHED) {
         _pthread_internal_remove_locked(thread);
+        pthread_mutex_unlock(&list->lock);
+
+        // Nobody will join us, so our resources are ours to dispose of.
+        // Leave our mapping for a future thread if we can.
+        if (mmap_base != NULL) {
+            keep_mapping = __cache_thread_mapping(thread);
+        } else {
+            _pthread_internal_free(thread);
+        }
     } else {
        /* make sure that the thread struct doesn't have stale pointers to a stack that
         * will be unmapped after the exit call below.
@@ -130,24 +146,30 @@ void pthread_exit(void * retval)
             thread->tls = NULL;
         }
 
-       /* Indicate that the thread has exited for joining threads. */
-        thread->attr.flags |= PTHREAD_ATTR_FLAG_ZOMBIE;
+       /* Indicate that the thread has exited for joining threads.
+        * Our mapping, if any, now belongs to whoever joins us. */
         thread->return_value = retval;
-
-       /* Signal the joining thread if present. */
-        if (thread->attr.flags & PTHREAD_ATTR_FLAG_JOINED) {
-            pthread_cond_signal(&thread->join_cond);
-        }
+        thread->attr.flags |= PTHREAD_ATTR_FLAG_ZOMBIE;
+        pthread_mutex_unlock(&list->lock);
+        joinable = 1;
     }
-    pthread_mutex_unlock(&gThreadListLock);
 
     sigfillset(&mask);
     sigdelset(&mask, SIGSEGV);
     (void)sigprocmask(SIG_SETMASK, &mask, (sigset_t *)NULL);
 
+    // Anyone joining us, or waiting to reuse our mapping, waits for us to be
+    // really gone. Have the kernel clear our tid (and wake any futex waiters
+    // on it) once it no longer needs our stack.
+    if (joinable || keep_mapping) {
+        __set_tid_address((int*) &thread->tid);
+    }
+
     // destroy the thread stack
-    if (user_stack)
+    if (user_stack || keep_mapping || (joinable && mmap_base != NULL))
         _exit_thread((int)retval);
+    else if (mmap_base != NULL)
+        _exit_with_stack_teardown(mmap_base, mmap_size, (int)retval);
     else
         _exit_with_stack_teardown(stack_base, stack_size, (int)retval);
 }
@@ -255,17 +277,20 @@ void pthread_exit(void * retval)
 #define  MUTEX_TYPE_NORMAL          0  /* Must be 0 to match __PTHREAD_MUTEX_INIT_VALUE */
 #define  MUTEX_TYPE_RECURSIVE       1
 #define  MUTEX_TYPE_ERRORCHECK      2
+#define  MUTEX_TYPE_PI              3  /* see "Priority inheritance" below */
 
 #define  MUTEX_TYPE_TO_BITS(t)       FIELD_TO_BITS(t, MUTEX_TYPE_SHIFT, MUTEX_TYPE_LEN)
 
 #define  MUTEX_TYPE_BITS_NORMAL      MUTEX_TYPE_TO_BITS(MUTEX_TYPE_NORMAL)
 #define  MUTEX_TYPE_BITS_RECURSIVE   MUTEX_TYPE_TO_BITS(MUTEX_TYPE_RECURSIVE)
 #define  MUTEX_TYPE_BITS_ERRORCHECK  MUTEX_TYPE_TO_BITS(MUTEX_TYPE_ERRORCHECK)
+#define  MUTEX_TYPE_BITS_PI          MUTEX_TYPE_TO_BITS(MUTEX_TYPE_PI)
 
 /* Mutex owner field:
  *
  * This is only used for recursive and errorcheck mutexes. It holds the
- * tid of the owning thread. Note that this works because the Linux
+ * tid of the owning thread (priority-inheritance mutexes keep the index of
+ * their side-table slot here instead). Note that this works because the Linux
  * kernel _only_ uses 16-bit values for tids.
  *
  * More specifically, it will wrap to 10000 when it reaches over 32768 for
@@ -308,9 +333,12 @@ void pthread_exit(void * retval)
  * bits:     name       description
  * 0-3       type       type of mutex
  * 4         shared     process-shared flag
+ * 5-6       protocol   PTHREAD_PRIO_NONE or PTHREAD_PRIO_INHERIT
  */
 #define  MUTEXATTR_TYPE_MASK   0x000f
 #define  MUTEXATTR_SHARED_MASK 0x0010
+#define  MUTEXATTR_PROTOCOL_SHIFT  5
+#define  MUTEXATTR_PROTOCOL_MASK   0x0060
 
 
 int pthread_mutexattr_init(pthread_mutexattr_t *attr)
@@ -391,6 +419,36 @@ int pthread_mutexattr_getpshared(pthread_mutexattr_t *attr, int *pshared)
     return 0;
 }
 
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol)
+{
+    if (!attr)
+        return EINVAL;
+
+    switch (protocol) {
+    case PTHREAD_PRIO_NONE:
+    case PTHREAD_PRIO_INHERIT:
+        *attr = (*attr & ~MUTEXATTR_PROTOCOL_MASK) | (protocol << MUTEXATTR_PROTOCOL_SHIFT);
+        return 0;
+
+    case PTHREAD_PRIO_PROTECT:
+        /* priority ceilings are not supported */
+        return ENOTSUP;
+    }
+    return EINVAL;
+}
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr, int *protocol)
+{
+    if (!attr || !protocol)
+        return EINVAL;
+
+    *protocol = (*attr & MUTEXATTR_PROTOCOL_MASK) >> MUTEXATTR_PROTOCOL_SHIFT;
+    return 0;
+}
+
+static int _pi_mutex_init(pthread_mutex_t *mutex, int kind);
+static void _pi_mutex_forget(pthread_mutex_t *mutex);
+
 int pthread_mutex_init(pthread_mutex_t *mutex,
                        const pthread_mutexattr_t *attr)
 {
@@ -399,6 +457,10 @@ int pthread_mutex_init(pthread_mutex_t *mutex,
     if (mutex == NULL)
         return EINVAL;
 
+    /* re-initializing a PI mutex without destroying it first */
+    if (__predict_false((mutex->value & MUTEX_TYPE_MASK) == MUTEX_TYPE_BITS_PI))
+        _pi_mutex_forget(mutex);
+
     if (__predict_true(attr == NULL)) {
         mutex->value = MUTEX_TYPE_BITS_NORMAL;
         return 0;
@@ -421,11 +483,67 @@ int pthread_mutex_init(pthread_mutex_t *mutex,
         return EINVAL;
     }
 
+    if ((*attr & MUTEXATTR_PROTOCOL_MASK) == (PTHREAD_PRIO_INHERIT << MUTEXATTR_PROTOCOL_SHIFT)) {
+        /* the side table behind these is private to this process */
+        if ((value & MUTEX_SHARED_MASK) != 0)
+            return ENOTSUP;
+        return _pi_mutex_init(mutex, *attr & MUTEXATTR_TYPE_MASK);
+    }
+
     mutex->value = value;
     return 0;
 }
 
 
+/*
+ * Adaptive spinning.
+ *
+ * On SMP, a thread that finds a mutex locked first spins for a while before
+ * going to sleep in the kernel: critical sections are often shorter than a
+ * futex wait/wake round trip, and the owner is probably running on another
+ * CPU. How long to spin is learned from how long recent successful spins
+ * took, and shrinks when spinning keeps failing.
+ *
+ * There's no room left in pthread_mutex_t to keep that estimate per mutex,
+ * so mutexes hash into a small table of spin budgets instead. A collision
+ * only means that two mutexes share an estimate, and the unsynchronized
+ * updates to the table can't do worse than lose an adjustment.
+ */
+#define  MUTEX_SPIN_SLOTS  64
+#define  MUTEX_SPIN_MIN    10
+#define  MUTEX_SPIN_MAX    100
+
+static int __mutex_spin_budgets[MUTEX_SPIN_SLOTS];
+
+/*
+ * Spin until the mutex is unlocked or the spin budget runs out, and return
+ * the last value read from the mutex.
+ */
+static __inline__ int
+_mutex_spin(pthread_mutex_t*  mutex)
+{
+#if ANDROID_SMP
+    uintptr_t  hash   = (uintptr_t)mutex;
+    int*       budget = &__mutex_spin_budgets[((hash >> 2) ^ (hash >> 12)) % MUTEX_SPIN_SLOTS];
+    int        limit  = 2 * *budget + MUTEX_SPIN_MIN;
+    int        count;
+
+    if (limit > MUTEX_SPIN_MAX)
+        limit = MUTEX_SPIN_MAX;
+
+    for (count = 0; count < limit; count++) {
+        int mvalue = mutex->value;
+        if ((mvalue & MUTEX_STATE_MASK) == MUTEX_STATE_BITS_UNLOCKED) {
+            *budget += (count - *budget) / 8;
+            return mvalue;
+        }
+        __bionic_cpu_relax();
+    }
+    *budget -= (*budget + 7) / 8;
+#endif
+    return mutex->value;
+}
+
 /*
  * Lock a non-recursive mutex.
  *
@@ -452,6 +570,16 @@ _normal_lock(pthread_mutex_t*  mutex, int shared)
      */
     if (__bionic_cmpxchg(unlocked, locked_uncontended, &mutex->value) != 0) {
         const int locked_contended = shared | MUTEX_STATE_BITS_LOCKED_CONTENDED;
+        /*
+         * Before sleeping, spin for a while in case the owner is about to
+         * release the mutex. If we get it this way, it stays in state 1;
+         * any sleepers will push it back to 2 when they wake up.
+         */
+        if (_mutex_spin(mutex) == unlocked &&
+            __bionic_cmpxchg(unlocked, locked_uncontended, &mutex->value) == 0) {
+            ANDROID_MEMBAR_FULL();
+            return;
+        }
         /*
          * We want to go to sleep until the mutex is available, which
          * requires promoting it to state 2 (CONTENDED). We need to
@@ -530,6 +658,24 @@ _normal_unlock(pthread_mutex_t*  mutex, int shared)
     }
 }
 
+/*
+ * Lock a non-recursive mutex, leaving it in state 2 (CONTENDED) even if
+ * nobody else wants it. This is used by threads returning from a condition
+ * variable wait, as pthread_cond_broadcast() may have requeued other
+ * waiters onto the mutex's futex: they're only woken by an unlock from
+ * state 2, and nobody else knows they're there.
+ */
+static __inline__ void
+_normal_lock_contended(pthread_mutex_t*  mutex, int shared)
+{
+    const int unlocked         = shared | MUTEX_STATE_BITS_UNLOCKED;
+    const int locked_contended = shared | MUTEX_STATE_BITS_LOCKED_CONTENDED;
+
+    while (__bionic_swap(locked_contended, &mutex->value) != unlocked)
+        __futex_wait_ex(&mutex->value, shared, locked_contended, 0);
+    ANDROID_MEMBAR_FULL();
+}
+
 /* This common inlined function is used to increment the counter of an
  * errorcheck or recursive mutex.
  *
@@ -577,6 +723,224 @@ _recursive_increment(pthread_mutex_t* mutex, int mvalue, int mtype)
     }
 }
 
+/*
+ * Priority inheritance.
+ *
+ * For PTHREAD_PRIO_INHERIT mutexes the kernel boosts the owner to the
+ * priority of its most urgent waiter (FUTEX_LOCK_PI/FUTEX_UNLOCK_PI). The
+ * kernel requires such a futex word to hold nothing but the owner's tid and
+ * its own FUTEX_WAITERS/FUTEX_OWNER_DIED bits, which leaves no room for our
+ * type bits. So the mutex value of a PI mutex only holds MUTEX_TYPE_BITS_PI
+ * and, in the owner field, the index of a slot in a per-process side table
+ * that holds the real futex word, the mutex kind and the recursion count.
+ * This is also why PI mutexes can't be process-shared.
+ *
+ * Slots are allocated in page-sized chunks that are never unmapped, so
+ * finding a mutex's slot doesn't need any lock.
+ *
+ * A slot is only given back by pthread_mutex_destroy, or by initializing
+ * the same mutex again (each in-use slot remembers its mutex, so stale or
+ * garbage values can't take another mutex's slot). A PI mutex that is
+ * freed without being destroyed keeps its slot for the life of the process.
+ */
+typedef struct {
+    int volatile  futex;      /* 0 or owner tid | FUTEX_WAITERS | FUTEX_OWNER_DIED */
+    int           kind;       /* PTHREAD_MUTEX_NORMAL/RECURSIVE/ERRORCHECK, or -1 if free */
+    int           count;      /* recursive re-locks, only touched by the owner */
+    union {
+        pthread_mutex_t*  mutex;      /* in use: the mutex using this slot */
+        int               next_free;  /* free: index + 1 of the next free slot, or 0 */
+    } u;
+} pi_mutex_slot_t;
+
+#define  PI_MUTEX_SLOTS_PER_CHUNK  (PAGE_SIZE / sizeof(pi_mutex_slot_t))
+#define  PI_MUTEX_MAX_SLOTS        (1 << MUTEX_OWNER_LEN)
+#define  PI_MUTEX_MAX_CHUNKS       ((PI_MUTEX_MAX_SLOTS + PI_MUTEX_SLOTS_PER_CHUNK - 1) / PI_MUTEX_SLOTS_PER_CHUNK)
+
+static pi_mutex_slot_t*  __pi_mutex_chunks[PI_MUTEX_MAX_CHUNKS];
+static int               __pi_mutex_slot_count;  /* slots ever handed out */
+static int               __pi_mutex_free_slots;  /* index + 1 of the first free slot, or 0 */
+static pthread_mutex_t   __pi_mutex_slot_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static __inline__ pi_mutex_slot_t*
+_pi_mutex_slot_at(int index)
+{
+    return &__pi_mutex_chunks[index / PI_MUTEX_SLOTS_PER_CHUNK][index % PI_MUTEX_SLOTS_PER_CHUNK];
+}
+
+static __inline__ pi_mutex_slot_t*
+_pi_mutex_slot(int mvalue)
+{
+    return _pi_mutex_slot_at(MUTEX_OWNER_FROM_BITS(mvalue));
+}
+
+static int
+_pi_mutex_init(pthread_mutex_t *mutex, int kind)
+{
+    pi_mutex_slot_t*  slot;
+    int               index = -1;
+
+    pthread_mutex_lock(&__pi_mutex_slot_lock);
+    if (__pi_mutex_free_slots != 0) {
+        index = __pi_mutex_free_slots - 1;
+        __pi_mutex_free_slots = _pi_mutex_slot_at(index)->u.next_free;
+    } else if (__pi_mutex_slot_count < PI_MUTEX_MAX_SLOTS) {
+        int chunk = __pi_mutex_slot_count / PI_MUTEX_SLOTS_PER_CHUNK;
+        if (__pi_mutex_chunks[chunk] == NULL) {
+            void* p = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE,
+                           MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED)
+                __pi_mutex_chunks[chunk] = p;
+        }
+        if (__pi_mutex_chunks[chunk] != NULL)
+            index = __pi_mutex_slot_count++;
+    }
+    pthread_mutex_unlock(&__pi_mutex_slot_lock);
+
+    if (index < 0)
+        return EAGAIN;
+
+    slot = _pi_mutex_slot_at(index);
+    slot->futex = 0;
+    slot->kind  = kind;
+    slot->count = 0;
+    slot->u.mutex = mutex;
+    mutex->value = MUTEX_OWNER_TO_BITS(index) | MUTEX_TYPE_BITS_PI;
+    return 0;
+}
+
+/* Puts a slot back on the free list. Called with __pi_mutex_slot_lock held. */
+static void
+_pi_mutex_free_slot(int index)
+{
+    pi_mutex_slot_t*  slot = _pi_mutex_slot_at(index);
+
+    slot->kind = -1;
+    slot->u.next_free = __pi_mutex_free_slots;
+    __pi_mutex_free_slots = index + 1;
+}
+
+static int
+_pi_mutex_destroy(pthread_mutex_t *mutex, int mvalue)
+{
+    int index = MUTEX_OWNER_FROM_BITS(mvalue);
+
+    if (_pi_mutex_slot_at(index)->futex != 0)
+        return EBUSY;
+
+    mutex->value = 0xdead10cc;
+
+    pthread_mutex_lock(&__pi_mutex_slot_lock);
+    _pi_mutex_free_slot(index);
+    pthread_mutex_unlock(&__pi_mutex_slot_lock);
+    return 0;
+}
+
+/*
+ * pthread_mutex_init on something that looks like a PI mutex. If it really
+ * is one that was never destroyed, give its slot back so that re-initializing
+ * doesn't leak it. The next PI init takes the head of the free list, so a
+ * mutex that stays PI gets the same slot again.
+ */
+static void
+_pi_mutex_forget(pthread_mutex_t *mutex)
+{
+    int index = MUTEX_OWNER_FROM_BITS(mutex->value);
+
+    pthread_mutex_lock(&__pi_mutex_slot_lock);
+    if (index < __pi_mutex_slot_count &&
+        _pi_mutex_slot_at(index)->kind >= 0 &&
+        _pi_mutex_slot_at(index)->u.mutex == mutex)
+        _pi_mutex_free_slot(index);
+    pthread_mutex_unlock(&__pi_mutex_slot_lock);
+}
+
+/* Re-locking a PI mutex we already own: same rules as _recursive_increment. */
+static int
+_pi_mutex_relock(pi_mutex_slot_t* slot)
+{
+    if (slot->kind == PTHREAD_MUTEX_ERRORCHECK)
+        return EDEADLK;
+    if (slot->count == INT_MAX)
+        return EAGAIN;
+    slot->count++;
+    return 0;
+}
+
+/* Locks a PI mutex, giving up at 'abstime' (CLOCK_REALTIME) if not NULL. */
+static int
+_pi_mutex_lock(int mvalue, const struct timespec* abstime)
+{
+    pi_mutex_slot_t*  slot = _pi_mutex_slot(mvalue);
+    int               tid = __get_thread()->tid;
+    int               ret;
+
+    if ((slot->futex & FUTEX_TID_MASK) == tid) {
+        /* a normal mutex would deadlock here; say so rather than hang */
+        if (slot->kind == PTHREAD_MUTEX_NORMAL)
+            return EDEADLK;
+        return _pi_mutex_relock(slot);
+    }
+
+    /* Uncontended: take it without entering the kernel. */
+    if (__bionic_cmpxchg(0, tid, &slot->futex) == 0) {
+        ANDROID_MEMBAR_FULL();
+        return 0;
+    }
+
+    /* Otherwise the kernel queues us by priority and lends ours to the owner. */
+    do {
+        ret = __futex_syscall4(&slot->futex, FUTEX_LOCK_PI_PRIVATE, 0, abstime);
+    } while (ret == -EINTR);
+    if (ret != 0)
+        return -ret;
+
+    ANDROID_MEMBAR_FULL();
+    return 0;
+}
+
+static int
+_pi_mutex_trylock(int mvalue)
+{
+    pi_mutex_slot_t*  slot = _pi_mutex_slot(mvalue);
+    int               tid = __get_thread()->tid;
+
+    if ((slot->futex & FUTEX_TID_MASK) == tid) {
+        if (slot->kind == PTHREAD_MUTEX_NORMAL)
+            return EBUSY;
+        return _pi_mutex_relock(slot);
+    }
+
+    if (__bionic_cmpxchg(0, tid, &slot->futex) == 0) {
+        ANDROID_MEMBAR_FULL();
+        return 0;
+    }
+    return EBUSY;
+}
+
+static int
+_pi_mutex_unlock(int mvalue)
+{
+    pi_mutex_slot_t*  slot = _pi_mutex_slot(mvalue);
+    int               tid = __get_thread()->tid;
+
+    if ((slot->futex & FUTEX_TID_MASK) != tid)
+        return EPERM;
+
+    if (slot->count > 0) {
+        slot->count--;
+        return 0;
+    }
+
+    /* With no waiters the word is exactly our tid and we can just clear it.
+     * Otherwise FUTEX_WAITERS is set and the kernel must hand the mutex
+     * over to the highest-priority waiter and drop our boost. */
+    ANDROID_MEMBAR_FULL();  /* RELEASE BARRIER */
+    if (__bionic_cmpxchg(tid, 0, &slot->futex) != 0)
+        __futex_syscall3(&slot->futex, FUTEX_UNLOCK_PI_PRIVATE, 0);
+    return 0;
+}
+
 __LIBC_HIDDEN__
 int pthread_mutex_lock_impl(pthread_mutex_t *mutex)
 {
@@ -595,6 +959,9 @@ int pthread_mutex_lock_impl(pthread_mutex_t *mutex)
         return 0;
     }
 
+    if (mtype == MUTEX_TYPE_BITS_PI)
+        return _pi_mutex_lock(mvalue, NULL);
+
     /* Do we already own this recursive or error-check mutex ? */
     tid = __get_thread()->tid;
     if ( tid == MUTEX_OWNER_FROM_BITS(mvalue) )
@@ -603,6 +970,11 @@ int pthread_mutex_lock_impl(pthread_mutex_t *mutex)
     /* Add in shared state to avoid extra 'or' operations below */
     mtype |= shared;
 
+    /* If another thread holds the mutex, spin for a while in case it is
+     * about to release it, before falling back to the futex below. */
+    if (mvalue != mtype)
+        mvalue = _mutex_spin(mutex);
+
     /* First, if the mutex is unlocked, try to quickly acquire it.
      * In the optimistic case where this works, set the state to 1 to
      * indicate locked with no contention */
@@ -689,6 +1061,9 @@ int pthread_mutex_unlock_impl(pthread_mutex_t *mutex)
         return 0;
     }
 
+    if (mtype == MUTEX_TYPE_BITS_PI)
+        return _pi_mutex_unlock(mvalue);
+
     /* Do we already own this recursive or error-check mutex ? */
     tid = __get_thread()->tid;
     if ( tid != MUTEX_OWNER_FROM_BITS(mvalue) )
@@ -763,6 +1138,9 @@ int pthread_mutex_trylock_impl(pthread_mutex_t *mutex)
         return EBUSY;
     }
 
+    if (mtype == MUTEX_TYPE_BITS_PI)
+        return _pi_mutex_trylock(mvalue);
+
     /* Do we already own this recursive or error-check mutex ? */
     tid = __get_thread()->tid;
     if ( tid == MUTEX_OWNER_FROM_BITS(mvalue) )
@@ -799,7 +1177,7 @@ int pthread_mutex_trylock(pthread_mutex_t *mutex)
 /* initialize 'ts' with the difference between 'abstime' and the current time
  * according to 'clock'. Returns -1 if abstime already expired, or 0 otherwise.
  */
-static int
+__LIBC_HIDDEN__ int
 __timespec_to_absolute(struct timespec*  ts, const struct timespec*  abstime, clockid_t  clock)
 {
     clock_gettime(clock, ts);
@@ -872,6 +1250,14 @@ int pthread_mutex_lock_timeout_np_impl(pthread_mutex_t *mutex, unsigned msecs)
         return 0;
     }
 
+    if (mtype == MUTEX_TYPE_BITS_PI) {
+        /* FUTEX_LOCK_PI only takes an absolute CLOCK_REALTIME timeout */
+        int ret;
+        __timespec_to_relative_msec(&abstime, msecs, CLOCK_REALTIME);
+        ret = _pi_mutex_lock(mvalue, &abstime);
+        return (ret == ETIMEDOUT) ? EBUSY : ret;
+    }
+
     /* Do we already own this recursive or error-check mutex ? */
     tid = __get_thread()->tid;
     if ( tid == MUTEX_OWNER_FROM_BITS(mvalue) )
@@ -962,6 +1348,9 @@ int pthread_mutex_destroy(pthread_mutex_t *mutex)
 {
     int ret;
 
+    if (mutex != NULL && (mutex->value & MUTEX_TYPE_MASK) == MUTEX_TYPE_BITS_PI)
+        return _pi_mutex_destroy(mutex, mutex->value);
+
     /* use trylock to ensure that the mutex value is
      * valid and is not already locked. */
     ret = pthread_mutex_trylock_impl(mutex);
@@ -1023,6 +1412,104 @@ int pthread_condattr_destroy(pthread_condattr_t *attr)
 
 #define COND_IS_SHARED(c)  (((c)->value & COND_SHARED_MASK) != 0)
 
+/*
+ * pthread_cond_broadcast() avoids waking every waiter only to have all but
+ * one of them go straight back to sleep on the mutex: it wakes one waiter
+ * and requeues the others onto the mutex's futex with FUTEX_CMP_REQUEUE, so
+ * that each unlock hands the mutex to the next one.
+ *
+ * That requires knowing the waiters' mutex, and pthread_cond_t has no room
+ * for it. Waiters record it in a small table keyed by the condition
+ * variable's address instead. Requeueing is only done when every current
+ * waiter of the condition variable uses the same normal, private mutex, and
+ * the condition variable is private itself: process-shared objects can be
+ * mapped at different addresses in each process, so they always wake all
+ * waiters. Neither does a condition variable sharing its slot with another
+ * one that has waiters.
+ */
+#define COND_MUTEX_SLOTS  64
+
+typedef struct {
+    pthread_mutex_t   lock;
+    pthread_cond_t*   cond;
+    pthread_mutex_t*  mutex;    /* NULL if requeueing isn't possible */
+    int               waiters;
+} cond_mutex_slot_t;
+
+static cond_mutex_slot_t  __cond_mutex_slots[COND_MUTEX_SLOTS];
+
+static __inline__ cond_mutex_slot_t*
+__cond_mutex_slot(pthread_cond_t*  cond)
+{
+    uintptr_t  hash = (uintptr_t)cond;
+    return &__cond_mutex_slots[((hash >> 2) ^ (hash >> 12)) % COND_MUTEX_SLOTS];
+}
+
+/* Record that a waiter is about to sleep on 'cond' and will then lock
+ * 'mutex'. Returns 1 if the waiter was counted, in which case it must call
+ * __cond_mutex_remove_waiter() once it has woken up.
+ */
+static int
+__cond_mutex_add_waiter(pthread_cond_t*  cond, pthread_mutex_t*  mutex)
+{
+    cond_mutex_slot_t*  slot = __cond_mutex_slot(cond);
+    int                 mvalue = mutex->value;
+    int                 added = 0;
+
+    if ((mvalue & (MUTEX_TYPE_MASK|MUTEX_SHARED_MASK)) != MUTEX_TYPE_BITS_NORMAL)
+        mutex = NULL;
+
+    _normal_lock(&slot->lock, 0);
+    if (slot->cond != cond && slot->waiters == 0) {
+        slot->cond = cond;
+        slot->mutex = mutex;
+    } else if (slot->cond == cond && slot->waiters == 0) {
+        slot->mutex = mutex;
+    } else if (slot->cond == cond && slot->mutex != mutex) {
+        slot->mutex = NULL;
+    }
+    if (slot->cond == cond) {
+        slot->waiters++;
+        added = 1;
+    }
+    _normal_unlock(&slot->lock, 0);
+    return added;
+}
+
+static void
+__cond_mutex_remove_waiter(pthread_cond_t*  cond)
+{
+    cond_mutex_slot_t*  slot = __cond_mutex_slot(cond);
+
+    _normal_lock(&slot->lock, 0);
+    slot->waiters--;
+    _normal_unlock(&slot->lock, 0);
+}
+
+/* Wake one waiter of 'cond' and move the others to its mutex, given that
+ * the condition variable's value is now 'value'. Returns 0 on success, or
+ * -1 if requeueing isn't possible and all waiters must be woken instead.
+ */
+static int
+__cond_requeue(pthread_cond_t*  cond, int  value)
+{
+    cond_mutex_slot_t*  slot = __cond_mutex_slot(cond);
+    int                 ret = -1;
+
+    /* Hold the slot lock across the requeue, so that no waiter with a
+     * different mutex can slip in between the lookup and the syscall. */
+    _normal_lock(&slot->lock, 0);
+    if (slot->cond == cond && slot->mutex != NULL) {
+        if (__futex_syscall6(&cond->value, FUTEX_CMP_REQUEUE_PRIVATE, 1,
+                             (const struct timespec*)INT_MAX,
+                             &slot->mutex->value, value) >= 0) {
+            ret = 0;
+        }
+    }
+    _normal_unlock(&slot->lock, 0);
+    return ret;
+}
+
 /* XXX *technically* there is a race condition that could allow
  * XXX a signal to be missed.  If thread A is preempted in _wait()
  * XXX after unlocking the mutex and before waiting, and if other
@@ -1062,6 +1549,7 @@ static int
 __pthread_cond_pulse(pthread_cond_t *cond, int  counter)
 {
     long flags;
+    long newval;
 
     if (__predict_false(cond == NULL))
         return EINVAL;
@@ -1069,8 +1557,8 @@ __pthread_cond_pulse(pthread_cond_t *cond, int  counter)
     flags = (cond->value & ~COND_COUNTER_MASK);
     for (;;) {
         long oldval = cond->value;
-        long newval = ((oldval - COND_COUNTER_INCREMENT) & COND_COUNTER_MASK)
-                      | flags;
+        newval = ((oldval - COND_COUNTER_INCREMENT) & COND_COUNTER_MASK)
+                 | flags;
         if (__bionic_cmpxchg(oldval, newval, &cond->value) == 0)
             break;
     }
@@ -1087,6 +1575,11 @@ __pthread_cond_pulse(pthread_cond_t *cond, int  counter)
      */
     ANDROID_MEMBAR_FULL();
 
+    /* If the value changed again since our update, the requeue fails and
+     * we fall back to waking everybody. */
+    if (counter > 1 && !COND_IS_SHARED(cond) && __cond_requeue(cond, newval) == 0)
+        return 0;
+
     __futex_wake_ex(&cond->value, COND_IS_SHARED(cond), counter);
     return 0;
 }
@@ -1112,10 +1605,28 @@ int __pthread_cond_timedwait_relative(pthread_cond_t *cond,
 {
     int  status;
     int  oldvalue = cond->value;
+    int  counted = 0;
+
+    if (!COND_IS_SHARED(cond))
+        counted = __cond_mutex_add_waiter(cond, mutex);
 
     pthread_mutex_unlock(mutex);
     status = __futex_wait_ex(&cond->value, COND_IS_SHARED(cond), oldvalue, reltime);
-    pthread_mutex_lock(mutex);
+
+    if (counted) {
+        __cond_mutex_remove_waiter(cond);
+    }
+    if (!COND_IS_SHARED(cond) && (mutex->value & MUTEX_TYPE_MASK) == MUTEX_TYPE_BITS_NORMAL) {
+        /* We may have been requeued onto the mutex, along with others. */
+        _normal_lock_contended(mutex, mutex->value & MUTEX_SHARED_MASK);
+#ifdef PTHREAD_DEBUG
+        if (PTHREAD_DEBUG_ENABLED) {
+            pthread_debug_mutex_lock_check(mutex);
+        }
+#endif
+    } else {
+        pthread_mutex_lock(mutex);
+    }
 
     if (status == (-ETIMEDOUT)) return ETIMEDOUT;
     return 0;
@@ -24,8 +24,9 @@
 class pthread_accessor {
  public:
   explicit pthread_accessor(pthread_t desired_thread) {
+    list_ = _pthread_internal_list_for(desired_thread);
     Lock();
-    for (thread_ = gThreadList; thread_ != NULL; thread_ = thread_->next) {
+    for (thread_ = list_->head; thread_ != NULL; thread_ = thread_->next) {
       if (thread_ == reinterpret_cast<pthread_internal_t*>(desired_thread)) {
         break;
       }
@@ -40,7 +41,7 @@ class pthread_accessor {
     if (is_locked_) {
       is_locked_ = false;
       thread_ = NULL;
-      pthread_mutex_unlock(&gThreadListLock);
+      pthread_mutex_unlock(&list_->lock);
     }
   }
 
@@ -49,11 +50,12 @@ class pthread_accessor {
   pthread_internal_t* get() const { return thread_; }
 
  private:
+  pthread_internal_list_t* list_;
   pthread_internal_t* thread_;
   bool is_locked_;
 
   void Lock() {
-    pthread_mutex_lock(&gThreadListLock);
+    pthread_mutex_lock(&list_->lock);
     is_locked_ = true;
   }
 
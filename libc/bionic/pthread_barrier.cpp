@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "bionic_atomic_inline.h"
+#include "bionic_futex.h"
+
+// A barrier is a count of the threads that have arrived in the current phase,
+// and a phase number that the last thread to arrive bumps to let everyone go.
+// Waiters spin on the phase for a little while, since the other threads are
+// often not far behind, and then sleep on it in the kernel. The last thread
+// only makes a (single) wake-up call if anybody actually went to sleep.
+// Released threads still look at the barrier on their way out, so every
+// thread counts itself in 'waiters' for its whole stay, and destroy waits
+// for that to drop to zero before the memory can be reused.
+
+// How many times to check the phase before sleeping.
+static const int kBarrierSpinCount = 100;
+
+int pthread_barrierattr_init(pthread_barrierattr_t* attr) {
+  *attr = PTHREAD_PROCESS_PRIVATE;
+  return 0;
+}
+
+int pthread_barrierattr_destroy(pthread_barrierattr_t* attr) {
+  *attr = -1;
+  return 0;
+}
+
+int pthread_barrierattr_setpshared(pthread_barrierattr_t* attr, int pshared) {
+  if (pshared != PTHREAD_PROCESS_PRIVATE && pshared != PTHREAD_PROCESS_SHARED) {
+    return EINVAL;
+  }
+  *attr = pshared;
+  return 0;
+}
+
+int pthread_barrierattr_getpshared(const pthread_barrierattr_t* attr, int* pshared) {
+  *pshared = *attr;
+  return 0;
+}
+
+int pthread_barrier_init(pthread_barrier_t* barrier, const pthread_barrierattr_t* attr, unsigned int count) {
+  if (count == 0 || count > INT_MAX) {
+    return EINVAL;
+  }
+  barrier->count = count;
+  barrier->shared = (attr != NULL && *attr == PTHREAD_PROCESS_SHARED);
+  barrier->arrived = 0;
+  barrier->phase = 0;
+  barrier->sleepers = 0;
+  barrier->waiters = 0;
+  return 0;
+}
+
+int pthread_barrier_destroy(pthread_barrier_t* barrier) {
+  if (barrier->arrived != 0) {
+    return EBUSY;
+  }
+  // Threads from the last phase may not have got out yet. They're already
+  // runnable, so this doesn't take long.
+  while (barrier->waiters != 0) {
+    sched_yield();
+  }
+  ANDROID_MEMBAR_FULL();
+  barrier->count = 0;
+  return 0;
+}
+
+int pthread_barrier_wait(pthread_barrier_t* barrier) {
+  if (barrier->count == 0) {
+    return EINVAL;
+  }
+
+  __bionic_atomic_inc(&barrier->waiters);
+
+  // The phase can't move on until we've arrived, so this is our phase.
+  int phase = barrier->phase;
+  ANDROID_MEMBAR_FULL();
+
+  if (__bionic_atomic_inc(&barrier->arrived) + 1 == static_cast<int>(barrier->count)) {
+    // We're the last: reset for the next phase and let everyone go.
+    barrier->arrived = 0;
+    ANDROID_MEMBAR_FULL();
+    barrier->phase = phase + 1;
+    ANDROID_MEMBAR_FULL();
+    if (barrier->sleepers != 0) {
+      __futex_wake_ex(&barrier->phase, barrier->shared, INT_MAX);
+    }
+    // This must be our last touch of the barrier.
+    __bionic_atomic_dec(&barrier->waiters);
+    return PTHREAD_BARRIER_SERIAL_THREAD;
+  }
+
+#if ANDROID_SMP
+  for (int i = 0; i < kBarrierSpinCount && barrier->phase == phase; ++i) {
+    __bionic_cpu_relax();
+  }
+#endif
+
+  if (barrier->phase == phase) {
+    // Announce ourselves before checking the phase one last time (inside the
+    // futex wait), so that the last thread can't miss us.
+    __bionic_atomic_inc(&barrier->sleepers);
+    ANDROID_MEMBAR_FULL();
+    while (barrier->phase == phase) {
+      __futex_wait_ex(&barrier->phase, barrier->shared, phase, NULL);
+    }
+    __bionic_atomic_dec(&barrier->sleepers);
+  }
+
+  ANDROID_MEMBAR_FULL();
+  __bionic_atomic_dec(&barrier->waiters);
+  return 0;
+}
@@ -29,6 +29,7 @@
 #include <pthread.h>
 
 #include <errno.h>
+#include <string.h>
 #include <sys/mman.h>
 
 #include "pthread_internal.h"
@@ -56,6 +57,35 @@ static pthread_mutex_t gPthreadStackCreationLock = PTHREAD_MUTEX_INITIALIZER;
 
 static pthread_mutex_t gDebuggerNotificationLock = PTHREAD_MUTEX_INITIALIZER;
 
+// Threads whose stacks we allocate get a single mapping, laid out like this
+// from low to high addresses:
+//
+//   alternate signal stack | guard region | stack ... TLS slots | pthread_internal_t
+//
+// attr.stack_base and attr.stack_size cover the guard region and the stack,
+// just as they did when the stack was a mapping of its own, so a thread's
+// descriptor always starts right after its TLS slots. The one guard region
+// keeps an overflowing thread stack out of the alternate signal stack, and a
+// signal handler that overflows the alternate signal stack runs off the
+// bottom of the mapping, away from the descriptor. So setting up a new
+// mapping costs one mmap and one mprotect.
+static const size_t kThreadDescriptorSize = (sizeof(pthread_internal_t) + (PAGE_SIZE-1)) & ~(PAGE_SIZE-1);
+static const size_t kSignalStackSize = (SIGSTKSZ + (PAGE_SIZE-1)) & ~(PAGE_SIZE-1);
+
+static size_t __thread_mapping_size(size_t stack_size) {
+  return kSignalStackSize + stack_size + kThreadDescriptorSize;
+}
+
+// The mappings of threads that have gone for good are kept here for reuse,
+// which saves pthread_create an mmap/mprotect pair and pthread_exit a munmap.
+// Cached threads are chained through their 'next' field. A mapping may only be
+// reused once the kernel has cleared the 'tid' of the thread that last ran on
+// it (see pthread_exit). Protected by gPthreadStackCreationLock.
+static const size_t kMaxCachedThreads = 8;
+
+static pthread_internal_t* gThreadCache = NULL;
+static size_t gThreadCacheCount = 0;
+
 void  __init_tls(pthread_internal_t* thread) {
   // Zero-initialize all the slots.
   for (size_t i = 0; i < BIONIC_TLS_SLOTS; ++i) {
@@ -70,10 +100,13 @@ void  __init_tls(pthread_internal_t* thread) {
 
   __set_tls(thread->tls);
 
-  // Create and set an alternate signal stack.
+  // Create and set an alternate signal stack, unless it's part of our stack's mapping.
   // This must happen after __set_tls, in case a system call fails and tries to set errno.
   stack_t ss;
-  ss.ss_sp = mmap(NULL, SIGSTKSZ, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, 0, 0);
+  ss.ss_sp = thread->alternate_signal_stack;
+  if (ss.ss_sp == NULL) {
+    ss.ss_sp = mmap(NULL, SIGSTKSZ, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, 0, 0);
+  }
   if (ss.ss_sp != MAP_FAILED) {
     ss.ss_size = SIGSTKSZ;
     ss.ss_flags = 0;
@@ -122,7 +155,6 @@ int _init_thread(pthread_internal_t* thread, bool add_to_thread_list) {
     }
   }
 
-  pthread_cond_init(&thread->join_cond, NULL);
   thread->cleanup_stack = NULL;
 
   if (add_to_thread_list) {
@@ -132,31 +164,105 @@ int _init_thread(pthread_internal_t* thread, bool add_to_thread_list) {
   return error;
 }
 
-static void* __create_thread_stack(pthread_internal_t* thread) {
+// Returns an idle cached thread whose mapping suits 'attr', or NULL.
+// Called with gPthreadStackCreationLock held.
+static pthread_internal_t* __get_cached_thread(const pthread_attr_t* attr) {
+  size_t mmap_size = __thread_mapping_size(attr->stack_size);
+  for (pthread_internal_t** it = &gThreadCache; *it != NULL; it = &(*it)->next) {
+    pthread_internal_t* thread = *it;
+    if (thread->tid == 0 &&
+        thread->mmap_size == mmap_size &&
+        thread->attr.guard_size == attr->guard_size) {
+      *it = thread->next;
+      --gThreadCacheCount;
+      return thread;
+    }
+  }
+  return NULL;
+}
+
+// Hands the mapping of a thread that has gone for good (or is about to) to
+// the cache. Returns 1 on success, or 0 if the cache is full of mappings
+// that are still in use, in which case the caller must dispose of it.
+int __cache_thread_mapping(pthread_internal_t* thread) {
   ScopedPthreadMutexLocker lock(&gPthreadStackCreationLock);
 
-  // Create a new private anonymous map.
-  int prot = PROT_READ | PROT_WRITE;
-  int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
-  void* stack = mmap(NULL, thread->attr.stack_size, prot, flags, -1, 0);
-  if (stack == MAP_FAILED) {
-    __libc_format_log(ANDROID_LOG_WARN,
-                      "libc",
-                      "pthread_create failed: couldn't allocate %zd-byte stack: %s",
-                      thread->attr.stack_size, strerror(errno));
-    return NULL;
+  if (gThreadCacheCount == kMaxCachedThreads) {
+    // Make room by dropping the least recently cached idle mapping, if there is one.
+    pthread_internal_t** victim = NULL;
+    for (pthread_internal_t** it = &gThreadCache; *it != NULL; it = &(*it)->next) {
+      if ((*it)->tid == 0) {
+        victim = it;
+      }
+    }
+    if (victim == NULL) {
+      return 0;
+    }
+    pthread_internal_t* idle = *victim;
+    *victim = idle->next;
+    --gThreadCacheCount;
+    munmap(idle->mmap_base, idle->mmap_size);
   }
 
-  // Set the guard region at the end of the stack to PROT_NONE.
-  if (mprotect(stack, thread->attr.guard_size, PROT_NONE) == -1) {
-    __libc_format_log(ANDROID_LOG_WARN, "libc",
-                      "pthread_create failed: couldn't mprotect PROT_NONE %zd-byte stack guard region: %s",
-                      thread->attr.guard_size, strerror(errno));
-    munmap(stack, thread->attr.stack_size);
-    return NULL;
+  thread->next = gThreadCache;
+  gThreadCache = thread;
+  ++gThreadCacheCount;
+  return 1;
+}
+
+// Releases the mapping of a thread that has been joined, once the kernel has
+// cleared its tid: the mapping goes back in the cache if there's room, or
+// is unmapped otherwise.
+void __release_thread_mapping(pthread_internal_t* thread) {
+  if (!__cache_thread_mapping(thread)) {
+    munmap(thread->mmap_base, thread->mmap_size);
   }
+}
+
+// Allocates the mapping for a thread with the given attributes, and returns
+// the descriptor inside it. Sets attr->stack_base.
+static pthread_internal_t* __allocate_thread(pthread_attr_t* attr) {
+  ScopedPthreadMutexLocker lock(&gPthreadStackCreationLock);
 
-  return stack;
+  void* mmap_base;
+  size_t mmap_size;
+  pthread_internal_t* thread = __get_cached_thread(attr);
+  if (thread != NULL) {
+    mmap_base = thread->mmap_base;
+    mmap_size = thread->mmap_size;
+    memset(thread, 0, sizeof(*thread));
+  } else {
+    // Create a new private anonymous map.
+    mmap_size = __thread_mapping_size(attr->stack_size);
+    int prot = PROT_READ | PROT_WRITE;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    mmap_base = mmap(NULL, mmap_size, prot, flags, -1, 0);
+    if (mmap_base == MAP_FAILED) {
+      __libc_format_log(ANDROID_LOG_WARN,
+                        "libc",
+                        "pthread_create failed: couldn't allocate %zd-byte stack: %s",
+                        attr->stack_size, strerror(errno));
+      return NULL;
+    }
+
+    // Set the guard region at the end of the stack to PROT_NONE.
+    uint8_t* stack_base = reinterpret_cast<uint8_t*>(mmap_base) + kSignalStackSize;
+    if (mprotect(stack_base, attr->guard_size, PROT_NONE) == -1) {
+      __libc_format_log(ANDROID_LOG_WARN, "libc",
+                        "pthread_create failed: couldn't mprotect PROT_NONE %zd-byte stack guard region: %s",
+                        attr->guard_size, strerror(errno));
+      munmap(mmap_base, mmap_size);
+      return NULL;
+    }
+
+    thread = reinterpret_cast<pthread_internal_t*>(stack_base + attr->stack_size);
+  }
+
+  thread->mmap_base = mmap_base;
+  thread->mmap_size = mmap_size;
+  thread->alternate_signal_stack = mmap_base;
+  attr->stack_base = reinterpret_cast<uint8_t*>(mmap_base) + kSignalStackSize;
+  return thread;
 }
 
 int pthread_create(pthread_t* thread_out, pthread_attr_t const* attr,
@@ -170,35 +276,38 @@ int pthread_create(pthread_t* thread_out, pthread_attr_t const* attr,
   // initialization routine that sets up the main thread's data structures.
   __isthreaded = 1;
 
-  pthread_internal_t* thread = reinterpret_cast<pthread_internal_t*>(calloc(sizeof(*thread), 1));
-  if (thread == NULL) {
-    __libc_format_log(ANDROID_LOG_WARN, "libc", "pthread_create failed: couldn't allocate thread");
-    return EAGAIN;
-  }
-  thread->allocated_on_heap = true;
-
+  pthread_attr_t thread_attr;
   if (attr == NULL) {
-    pthread_attr_init(&thread->attr);
+    pthread_attr_init(&thread_attr);
   } else {
-    thread->attr = *attr;
+    thread_attr = *attr;
     attr = NULL; // Prevent misuse below.
   }
 
   // Make sure the stack size and guard size are multiples of PAGE_SIZE.
-  thread->attr.stack_size = (thread->attr.stack_size + (PAGE_SIZE-1)) & ~(PAGE_SIZE-1);
-  thread->attr.guard_size = (thread->attr.guard_size + (PAGE_SIZE-1)) & ~(PAGE_SIZE-1);
-
-  if (thread->attr.stack_base == NULL) {
-    // The caller didn't provide a stack, so allocate one.
-    thread->attr.stack_base = __create_thread_stack(thread);
-    if (thread->attr.stack_base == NULL) {
-      free(thread);
+  thread_attr.stack_size = (thread_attr.stack_size + (PAGE_SIZE-1)) & ~(PAGE_SIZE-1);
+  thread_attr.guard_size = (thread_attr.guard_size + (PAGE_SIZE-1)) & ~(PAGE_SIZE-1);
+
+  pthread_internal_t* thread;
+  if (thread_attr.stack_base == NULL) {
+    // The caller didn't provide a stack, so allocate one, along with the
+    // thread's descriptor and alternate signal stack.
+    thread = __allocate_thread(&thread_attr);
+    if (thread == NULL) {
       return EAGAIN;
     }
   } else {
     // The caller did provide a stack, so remember we're not supposed to free it.
-    thread->attr.flags |= PTHREAD_ATTR_FLAG_USER_STACK;
+    // The descriptor has to go on the heap instead.
+    thread_attr.flags |= PTHREAD_ATTR_FLAG_USER_STACK;
+    thread = _pthread_internal_alloc();
+    if (thread == NULL) {
+      __libc_format_log(ANDROID_LOG_WARN, "libc", "pthread_create failed: couldn't allocate thread");
+      return EAGAIN;
+    }
+    thread->allocated_on_heap = true;
   }
+  thread->attr = thread_attr;
 
   // Make room for the TLS area.
   // The child stack is the same address, just growing in the opposite direction.
@@ -224,10 +333,11 @@ int pthread_create(pthread_t* thread_out, pthread_attr_t const* attr,
   int tid = __pthread_clone(start_routine, child_stack, flags, arg);
   if (tid < 0) {
     int clone_errno = errno;
-    if ((thread->attr.flags & PTHREAD_ATTR_FLAG_USER_STACK) == 0) {
-      munmap(thread->attr.stack_base, thread->attr.stack_size);
+    if (thread->mmap_base != NULL) {
+      munmap(thread->mmap_base, thread->mmap_size);
+    } else {
+      free(thread);
     }
-    free(thread);
     __libc_format_log(ANDROID_LOG_WARN, "libc", "pthread_create failed: clone failed: %s", strerror(errno));
     return clone_errno;
   }
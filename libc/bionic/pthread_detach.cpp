@@ -44,6 +44,15 @@ int pthread_detach(pthread_t t) {
     return 0; // Already being joined; silently do nothing, like glibc.
   }
 
+  if (thread->attr.flags & PTHREAD_ATTR_FLAG_ZOMBIE) {
+    // The thread has already exited, so nobody would ever clean it up.
+    pthread_internal_t* zombie = thread.get();
+    _pthread_internal_remove_locked(zombie);
+    thread.Unlock();
+    _pthread_internal_release(zombie);
+    return 0;
+  }
+
   thread->attr.flags |= PTHREAD_ATTR_FLAG_DETACHED;
   return 0;
 }
@@ -32,16 +32,35 @@
 #include <stdbool.h>
 #include <sys/cdefs.h>
 
+#include "private/bionic_tls.h"
+
 __BEGIN_DECLS
 
+/* A thread's value for one of the pthread keys past the direct TLS slots,
+ * and the sequence number of the key it was set under (see pthread_key.cpp).
+ */
+typedef struct {
+    int    seq;
+    void*  data;
+} pthread_key_data_t;
+
+#define PTHREAD_KEY_PAGE_ENTRIES  (PAGE_SIZE / sizeof(pthread_key_data_t))
+#define PTHREAD_KEY_PAGE_COUNT    ((BIONIC_TLS_EXTRA_KEYS + PTHREAD_KEY_PAGE_ENTRIES - 1) / PTHREAD_KEY_PAGE_ENTRIES)
+
 typedef struct pthread_internal_t
 {
     struct pthread_internal_t*  next;
     struct pthread_internal_t*  prev;
     pthread_attr_t              attr;
-    pid_t                       tid;
+    volatile pid_t              tid;         /* cleared by the kernel on exit; pthread_join waits for that */
+
+    /* The pid, cached by getpid, or 0 if it hasn't been asked yet. fork, vfork
+     * and clone set it to -1 while a child might see this struct, and then
+     * getpid and gettid ask the kernel rather than trust it or 'tid'. vfork.S
+     * assumes it's at offset 36.
+     */
+    pid_t                       cached_pid;
     bool                        allocated_on_heap;
-    pthread_cond_t              join_cond;
     void*                       return_value;
     int                         internal_flags;
     __pthread_cleanup_t*        cleanup_stack;
@@ -49,6 +68,20 @@ typedef struct pthread_internal_t
 
     void* alternate_signal_stack;
 
+    /* The mapping holding our stack, this descriptor and our alternate signal stack,
+     * if pthread_create allocated them. NULL for the main thread and for threads
+     * with a user-supplied stack, whose descriptor is 'allocated_on_heap' instead.
+     */
+    void* mmap_base;
+    size_t mmap_size;
+
+    /* The sequence number of the key each direct TLS slot's value was set
+     * under, and the pages holding the values of the other keys, allocated
+     * on first use.
+     */
+    int                  key_seqs[BIONIC_TLS_SLOTS];
+    pthread_key_data_t*  key_pages[PTHREAD_KEY_PAGE_COUNT];
+
     /*
      * The dynamic linker implements dlerror(3), which makes it hard for us to implement this
      * per-thread buffer by simply using malloc(3) and free(3).
@@ -63,7 +96,16 @@ void _pthread_internal_add(pthread_internal_t* thread);
 pthread_internal_t* __get_thread(void);
 
 __LIBC_HIDDEN__ void pthread_key_clean_all(void);
+__LIBC_HIDDEN__ pthread_internal_t* _pthread_internal_alloc(void);
+__LIBC_HIDDEN__ void _pthread_internal_free(pthread_internal_t* thread);
 __LIBC_HIDDEN__ void _pthread_internal_remove_locked(pthread_internal_t* thread);
+__LIBC_HIDDEN__ void _pthread_internal_release(pthread_internal_t* thread);
+__LIBC_HIDDEN__ int __cache_thread_mapping(pthread_internal_t* thread);
+__LIBC_HIDDEN__ void __release_thread_mapping(pthread_internal_t* thread);
+
+/* Sets 'ts' to the time remaining until 'abstime' on 'clock'. Returns -1 if
+ * 'abstime' has already passed, 0 otherwise. */
+__LIBC_HIDDEN__ int __timespec_to_absolute(struct timespec* ts, const struct timespec* abstime, clockid_t clock);
 
 /* Has the thread been detached by a pthread_join or pthread_detach call? */
 #define PTHREAD_ATTR_FLAG_DETACHED      0x00000001
@@ -77,11 +119,25 @@ __LIBC_HIDDEN__ void _pthread_internal_remove_locked(pthread_internal_t* thread)
 /* Has the thread already exited but not been joined? */
 #define PTHREAD_ATTR_FLAG_ZOMBIE        0x00000008
 
-__LIBC_HIDDEN__ extern pthread_internal_t* gThreadList;
-__LIBC_HIDDEN__ extern pthread_mutex_t gThreadListLock;
+/* Live threads are kept in a small hash table keyed on the descriptor's address,
+ * with a lock per bucket, so that threads starting and exiting at the same time
+ * don't all serialize on one lock. A thread's flags are protected by its
+ * bucket's lock.
+ */
+#define PTHREAD_INTERNAL_LIST_COUNT     16
+
+typedef struct {
+    pthread_mutex_t      lock;
+    pthread_internal_t*  head;
+} pthread_internal_list_t;
+
+__LIBC_HIDDEN__ extern pthread_internal_list_t gThreadLists[PTHREAD_INTERNAL_LIST_COUNT];
+
+__LIBC_HIDDEN__ pthread_internal_list_t* _pthread_internal_list_for(pthread_t thread);
 
 /* needed by fork.c */
 extern void __timer_table_start_stop(int  stop);
+extern void __timer_table_fork_child(void);
 extern void __bionic_atfork_run_prepare();
 extern void __bionic_atfork_run_child();
 extern void __bionic_atfork_run_parent();
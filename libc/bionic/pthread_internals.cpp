@@ -28,11 +28,66 @@
 
 #include "pthread_internal.h"
 
+#include <stdlib.h>
+#include <string.h>
+
+#include "bionic_futex.h"
 #include "bionic_tls.h"
 #include "ScopedPthreadMutexLocker.h"
 
-__LIBC_HIDDEN__ pthread_internal_t* gThreadList = NULL;
-__LIBC_HIDDEN__ pthread_mutex_t gThreadListLock = PTHREAD_MUTEX_INITIALIZER;
+// All-zero mutexes are valid, unlocked PTHREAD_MUTEX_INITIALIZER mutexes.
+__LIBC_HIDDEN__ pthread_internal_list_t gThreadLists[PTHREAD_INTERNAL_LIST_COUNT];
+
+// Descriptors of threads with user-supplied stacks that have gone for good,
+// kept for reuse by pthread_create.
+static const size_t kMaxFreeThreads = 8;
+static pthread_mutex_t gFreeThreadListLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_internal_t* gFreeThreadList = NULL;
+static size_t gFreeThreadCount = 0;
+
+pthread_internal_list_t* _pthread_internal_list_for(pthread_t thread) {
+  // Descriptors are often page-aligned, so mix in the page number.
+  uintptr_t address = static_cast<uintptr_t>(thread);
+  return &gThreadLists[((address >> PAGE_SHIFT) ^ (address >> 4)) % PTHREAD_INTERNAL_LIST_COUNT];
+}
+
+pthread_internal_t* _pthread_internal_alloc() {
+  pthread_internal_t* thread;
+  {
+    ScopedPthreadMutexLocker locker(&gFreeThreadListLock);
+    thread = gFreeThreadList;
+    if (thread != NULL) {
+      gFreeThreadList = thread->next;
+      --gFreeThreadCount;
+    }
+  }
+
+  if (thread == NULL) {
+    thread = reinterpret_cast<pthread_internal_t*>(calloc(1, sizeof(*thread)));
+  } else {
+    memset(thread, 0, sizeof(*thread));
+  }
+  return thread;
+}
+
+void _pthread_internal_free(pthread_internal_t* thread) {
+  // The main thread is not heap-allocated. See __libc_init_tls for the declaration,
+  // and __libc_init_common for the point where it's added to the thread list.
+  // Nor are threads whose descriptor lives in their stack's mapping; that's
+  // released along with the stack (see __release_thread_mapping).
+  if (!thread->allocated_on_heap) {
+    return;
+  }
+
+  ScopedPthreadMutexLocker locker(&gFreeThreadListLock);
+  if (gFreeThreadCount < kMaxFreeThreads) {
+    thread->next = gFreeThreadList;
+    gFreeThreadList = thread;
+    ++gFreeThreadCount;
+  } else {
+    free(thread);
+  }
+}
 
 void _pthread_internal_remove_locked(pthread_internal_t* thread) {
   if (thread->next != NULL) {
@@ -41,26 +96,36 @@ void _pthread_internal_remove_locked(pthread_internal_t* thread) {
   if (thread->prev != NULL) {
     thread->prev->next = thread->next;
   } else {
-    gThreadList = thread->next;
+    _pthread_internal_list_for(reinterpret_cast<pthread_t>(thread))->head = thread->next;
   }
+}
 
-  // The main thread is not heap-allocated. See __libc_init_tls for the declaration,
-  // and __libc_init_common for the point where it's added to the thread list.
-  if (thread->allocated_on_heap) {
-    free(thread);
+// Disposes of a joined or detached thread that has already been removed from
+// its list, once the kernel has finished with it.
+void _pthread_internal_release(pthread_internal_t* thread) {
+  pid_t tid;
+  while ((tid = thread->tid) != 0) {
+    __futex_wait(&thread->tid, tid, NULL);
+  }
+
+  if (thread->mmap_base != NULL) {
+    __release_thread_mapping(thread);
+  } else {
+    _pthread_internal_free(thread);
   }
 }
 
 __LIBC_ABI_PRIVATE__ void _pthread_internal_add(pthread_internal_t* thread) {
-  ScopedPthreadMutexLocker locker(&gThreadListLock);
+  pthread_internal_list_t* list = _pthread_internal_list_for(reinterpret_cast<pthread_t>(thread));
+  ScopedPthreadMutexLocker locker(&list->lock);
 
   // We insert at the head.
-  thread->next = gThreadList;
+  thread->next = list->head;
   thread->prev = NULL;
   if (thread->next != NULL) {
     thread->next->prev = thread;
   }
-  gThreadList = thread;
+  list->head = thread;
 }
 
 __LIBC_ABI_PRIVATE__ pthread_internal_t* __get_thread(void) {
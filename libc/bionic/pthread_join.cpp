@@ -30,33 +30,51 @@
 
 #include "pthread_accessor.h"
 
+#include "private/bionic_atomic_inline.h"
+#include "private/bionic_futex.h"
+#include "private/ScopedPthreadMutexLocker.h"
+
 int pthread_join(pthread_t t, void** ret_val) {
   if (t == pthread_self()) {
     return EDEADLK;
   }
 
-  pthread_accessor thread(t);
-  if (thread.get() == NULL) {
-      return ESRCH;
-  }
+  pthread_internal_t* joined;
+  {
+    pthread_accessor thread(t);
+    if (thread.get() == NULL) {
+        return ESRCH;
+    }
 
-  if (thread->attr.flags & PTHREAD_ATTR_FLAG_DETACHED) {
-    return EINVAL;
-  }
+    if (thread->attr.flags & PTHREAD_ATTR_FLAG_DETACHED) {
+      return EINVAL;
+    }
 
-  if (thread->attr.flags & PTHREAD_ATTR_FLAG_JOINED) {
-    return EINVAL;
+    if (thread->attr.flags & PTHREAD_ATTR_FLAG_JOINED) {
+      return EINVAL;
+    }
+
+    // Signal our intention to join. This also means nobody else will free the thread.
+    thread->attr.flags |= PTHREAD_ATTR_FLAG_JOINED;
+    joined = thread.get();
   }
 
-  // Signal our intention to join, and wait for the thread to exit.
-  thread->attr.flags |= PTHREAD_ATTR_FLAG_JOINED;
-  while ((thread->attr.flags & PTHREAD_ATTR_FLAG_ZOMBIE) == 0) {
-    pthread_cond_wait(&thread->join_cond, &gThreadListLock);
+  // Wait for the kernel to clear the thread's tid, which it does once the thread has exited.
+  pid_t tid;
+  while ((tid = joined->tid) != 0) {
+    __futex_wait(&joined->tid, tid, NULL);
   }
+  ANDROID_MEMBAR_FULL();
+
   if (ret_val) {
-    *ret_val = thread->return_value;
+    *ret_val = joined->return_value;
   }
 
-  _pthread_internal_remove_locked(thread.get());
+  {
+    pthread_internal_list_t* list = _pthread_internal_list_for(t);
+    ScopedPthreadMutexLocker locker(&list->lock);
+    _pthread_internal_remove_locked(joined);
+  }
+  _pthread_internal_release(joined);
   return 0;
 }
@@ -27,175 +27,177 @@
  */
 
 #include <pthread.h>
+#include <sys/mman.h>
 
+#include "bionic_atomic_inline.h"
 #include "bionic_tls.h"
 #include "pthread_internal.h"
 
 /* A technical note regarding our thread-local-storage (TLS) implementation:
  *
- * There can be up to BIONIC_TLS_SLOTS independent TLS keys in a given process,
- * The keys below TLS_SLOT_FIRST_USER_SLOT are reserved for Bionic to hold
- * special thread-specific variables like errno or a pointer to
- * the current thread's descriptor. These entries cannot be accessed through
- * pthread_getspecific() / pthread_setspecific() or pthread_key_delete()
+ * There are two kinds of key. The first BIONIC_TLS_SLOTS keys are slots in
+ * each thread's TLS area, a simple array of void* pointers (stack-allocated
+ * in __libc_init_common for the main thread, and placed at the top of their
+ * stack by pthread_create for the others). The keys below
+ * TLS_SLOT_FIRST_USER_SLOT are reserved for Bionic to hold special
+ * thread-specific variables like errno or a pointer to the current thread's
+ * descriptor. These entries cannot be accessed through pthread_getspecific() /
+ * pthread_setspecific() or pthread_key_delete().
  *
- * The 'tls_map_t' type defined below implements a shared global map of
- * currently created/allocated TLS keys and the destructors associated
- * with them.
+ * The next BIONIC_TLS_EXTRA_KEYS keys have their values in per-thread pages,
+ * hung off the thread's descriptor, that are only allocated when the thread
+ * first sets one of them, and released when it exits.
  *
- * The global TLS map simply contains a bitmap of allocated keys, and
- * an array of destructors.
+ * Which keys are allocated is a global bitmap that is only ever updated with
+ * atomic operations, and each key has a sequence number that is odd while
+ * it's allocated and bumped both when it's created and when it's deleted.
+ * Threads record the sequence number a value was set under next to the value,
+ * and a value only counts if that's the key's current sequence number. So
+ * pthread_key_delete() doesn't need to clear the key's value in all threads:
+ * bumping the sequence number makes all of them stale at once, and none of
+ * pthread_key_create(), pthread_key_delete(), pthread_getspecific() or
+ * pthread_setspecific() takes a lock.
  *
- * Each thread has a TLS area that is a simple array of BIONIC_TLS_SLOTS void*
- * pointers. the TLS area of the main thread is stack-allocated in
- * __libc_init_common, while the TLS area of other threads is placed at
- * the top of their stack in pthread_create.
- *
- * When pthread_key_delete() is called it will erase the key's bitmap bit
- * and its destructor, and will also clear the key data in the TLS area of
- * all created threads. As mandated by Posix, it is the responsibility of
- * the caller of pthread_key_delete() to properly reclaim the objects that
- * were pointed to by these data fields (either before or after the call).
+ * As mandated by Posix, it is the responsibility of the caller of
+ * pthread_key_delete() to properly reclaim the objects that were pointed to
+ * by the key's values (either before or after the call).
  */
 
-#define TLSMAP_BITS       32
-#define TLSMAP_WORDS      ((BIONIC_TLS_SLOTS+TLSMAP_BITS-1)/TLSMAP_BITS)
-#define TLSMAP_WORD(m,k)  (m).map[(k)/TLSMAP_BITS]
-#define TLSMAP_MASK(k)    (1U << ((k)&(TLSMAP_BITS-1)))
-
-static inline bool IsValidUserKey(pthread_key_t key) {
-  return (key >= TLS_SLOT_FIRST_USER_SLOT && key < BIONIC_TLS_SLOTS);
-}
-
 typedef void (*key_destructor_t)(void*);
 
-struct tls_map_t {
-  bool is_initialized;
+static const int kKeyCount = BIONIC_TLS_SLOTS + BIONIC_TLS_EXTRA_KEYS;
 
-  /* bitmap of allocated keys */
-  uint32_t map[TLSMAP_WORDS];
+#define KEYMAP_BITS   32
+#define KEYMAP_WORDS  ((kKeyCount + KEYMAP_BITS - 1) / KEYMAP_BITS)
 
-  key_destructor_t key_destructors[BIONIC_TLS_SLOTS];
+struct key_info_t {
+  int volatile seq;
+  key_destructor_t volatile destructor;
 };
 
-class ScopedTlsMapAccess {
- public:
-  ScopedTlsMapAccess() {
-    Lock();
-
-    // If this is the first time the TLS map has been accessed,
-    // mark the slots belonging to well-known keys as being in use.
-    // This isn't currently necessary because the well-known keys
-    // can only be accessed directly by bionic itself, do not have
-    // destructors, and all the functions that touch the TLS map
-    // start after the maximum well-known slot.
-    if (!s_tls_map_.is_initialized) {
-      for (pthread_key_t key = 0; key < TLS_SLOT_FIRST_USER_SLOT; ++key) {
-        SetInUse(key, NULL);
-      }
-      s_tls_map_.is_initialized = true;
-    }
-  }
+// The well-known slots are never available to pthread_key_create.
+static uint32_t volatile gKeyMap[KEYMAP_WORDS] = { (1U << TLS_SLOT_FIRST_USER_SLOT) - 1 };
+static key_info_t gKeys[kKeyCount];
 
-  ~ScopedTlsMapAccess() {
-    Unlock();
-  }
+// Atomically replaces 'old_bits' with 'new_bits', failing if the word has changed.
+static inline bool UpdateKeyMapWord(uint32_t volatile* word, uint32_t old_bits, uint32_t new_bits) {
+  return __bionic_cmpxchg(static_cast<int32_t>(old_bits), static_cast<int32_t>(new_bits),
+                          reinterpret_cast<int32_t volatile*>(word)) == 0;
+}
 
-  int CreateKey(pthread_key_t* result, void (*key_destructor)(void*)) {
-    // Take the first unallocated key.
-    for (int key = 0; key < BIONIC_TLS_SLOTS; ++key) {
-      if (!IsInUse(key)) {
-        SetInUse(key, key_destructor);
-        *result = key;
-        return 0;
-      }
-    }
+static inline bool IsValidUserKey(pthread_key_t key) {
+  return (key >= TLS_SLOT_FIRST_USER_SLOT && key < kKeyCount);
+}
 
-    // We hit PTHREAD_KEYS_MAX. POSIX says EAGAIN for this case.
-    return EAGAIN;
-  }
+static inline bool IsInUse(int seq) {
+  return (seq & 1) != 0;
+}
 
-  void DeleteKey(pthread_key_t key) {
-    TLSMAP_WORD(s_tls_map_, key) &= ~TLSMAP_MASK(key);
-    s_tls_map_.key_destructors[key] = NULL;
+// Returns where 'thread' keeps its value for 'key', if there's room for one yet.
+static void** GetValueSlot(pthread_internal_t* thread, pthread_key_t key, int** seq, bool allocate) {
+  if (key < BIONIC_TLS_SLOTS) {
+    *seq = &thread->key_seqs[key];
+    return &reinterpret_cast<void**>(const_cast<void*>(__get_tls()))[key];
   }
 
-  bool IsInUse(pthread_key_t key) {
-    return (TLSMAP_WORD(s_tls_map_, key) & TLSMAP_MASK(key)) != 0;
+  size_t index = key - BIONIC_TLS_SLOTS;
+  pthread_key_data_t*& page = thread->key_pages[index / PTHREAD_KEY_PAGE_ENTRIES];
+  if (page == NULL) {
+    if (!allocate) {
+      return NULL;
+    }
+    void* p = mmap(NULL, PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      return NULL;
+    }
+    page = reinterpret_cast<pthread_key_data_t*>(p);
   }
+  pthread_key_data_t* entry = &page[index % PTHREAD_KEY_PAGE_ENTRIES];
+  *seq = &entry->seq;
+  return &entry->data;
+}
 
-  void SetInUse(pthread_key_t key, void (*key_destructor)(void*)) {
-    TLSMAP_WORD(s_tls_map_, key) |= TLSMAP_MASK(key);
-    s_tls_map_.key_destructors[key] = key_destructor;
-  }
+// Called from pthread_exit() to remove all TLS key data from this thread.
+// This must call the destructor of all keys that have a non-NULL data value
+// and a non-NULL destructor.
+__LIBC_HIDDEN__ void pthread_key_clean_all() {
+  pthread_internal_t* thread = __get_thread();
+
+  // Because destructors can do funky things like deleting/creating other
+  // keys, we need to implement this in a loop.
+  for (int rounds = PTHREAD_DESTRUCTOR_ITERATIONS; rounds > 0; --rounds) {
+    size_t called_destructor_count = 0;
+    for (int word = 0; word < KEYMAP_WORDS; ++word) {
+      uint32_t bits = gKeyMap[word];
+      while (bits != 0) {
+        pthread_key_t key = word * KEYMAP_BITS + __builtin_ctz(bits);
+        bits &= bits - 1;
+        if (key < TLS_SLOT_FIRST_USER_SLOT) {
+          continue;
+        }
 
-  // Called from pthread_exit() to remove all TLS key data
-  // from this thread's TLS area. This must call the destructor of all keys
-  // that have a non-NULL data value and a non-NULL destructor.
-  void CleanAll() {
-    void** tls = (void**)__get_tls();
-
-    // Because destructors can do funky things like deleting/creating other
-    // keys, we need to implement this in a loop.
-    for (int rounds = PTHREAD_DESTRUCTOR_ITERATIONS; rounds > 0; --rounds) {
-      size_t called_destructor_count = 0;
-      for (int key = 0; key < BIONIC_TLS_SLOTS; ++key) {
-        if (IsInUse(key)) {
-          void* data = tls[key];
-          void (*key_destructor)(void*) = s_tls_map_.key_destructors[key];
-
-          if (data != NULL && key_destructor != NULL) {
-            // we need to clear the key data now, this will prevent the
-            // destructor (or a later one) from seeing the old value if
-            // it calls pthread_getspecific() for some odd reason
-
-            // we do not do this if 'key_destructor == NULL' just in case another
-            // destructor function might be responsible for manually
-            // releasing the corresponding data.
-            tls[key] = NULL;
-
-            // because the destructor is free to call pthread_key_create
-            // and/or pthread_key_delete, we need to temporarily unlock
-            // the TLS map
-            Unlock();
-            (*key_destructor)(data);
-            Lock();
-            ++called_destructor_count;
-          }
+        int key_seq = gKeys[key].seq;
+        ANDROID_MEMBAR_FULL();
+        key_destructor_t key_destructor = gKeys[key].destructor;
+        if (!IsInUse(key_seq) || key_destructor == NULL) {
+          // we do not clear the value if 'key_destructor == NULL' just in case
+          // another destructor function might be responsible for manually
+          // releasing the corresponding data.
+          continue;
         }
-      }
 
-      // If we didn't call any destructors, there is no need to check the TLS data again.
-      if (called_destructor_count == 0) {
-        break;
+        int* seq;
+        void** value = GetValueSlot(thread, key, &seq, false);
+        if (value == NULL || *seq != key_seq || *value == NULL) {
+          continue;
+        }
+
+        // we need to clear the key data now, this will prevent the destructor
+        // (or a later one) from seeing the old value if it calls
+        // pthread_getspecific() for some odd reason
+        void* data = *value;
+        *value = NULL;
+        (*key_destructor)(data);
+        ++called_destructor_count;
       }
     }
-  }
-
- private:
-  static tls_map_t s_tls_map_;
-  static pthread_mutex_t s_tls_map_lock_;
 
-  void Lock() {
-    pthread_mutex_lock(&s_tls_map_lock_);
+    // If we didn't call any destructors, there is no need to check the TLS data again.
+    if (called_destructor_count == 0) {
+      break;
+    }
   }
 
-  void Unlock() {
-    pthread_mutex_unlock(&s_tls_map_lock_);
+  for (size_t i = 0; i < PTHREAD_KEY_PAGE_COUNT; ++i) {
+    if (thread->key_pages[i] != NULL) {
+      munmap(thread->key_pages[i], PAGE_SIZE);
+      thread->key_pages[i] = NULL;
+    }
   }
-};
-
-__LIBC_HIDDEN__ tls_map_t ScopedTlsMapAccess::s_tls_map_;
-__LIBC_HIDDEN__ pthread_mutex_t ScopedTlsMapAccess::s_tls_map_lock_;
-
-__LIBC_HIDDEN__ void pthread_key_clean_all() {
-  ScopedTlsMapAccess tls_map;
-  tls_map.CleanAll();
 }
 
 int pthread_key_create(pthread_key_t* key, void (*key_destructor)(void*)) {
-  ScopedTlsMapAccess tls_map;
-  return tls_map.CreateKey(key, key_destructor);
+  // Take the first unallocated key.
+  for (int word = 0; word < KEYMAP_WORDS; ++word) {
+    uint32_t bits;
+    while ((bits = gKeyMap[word]) != ~0U) {
+      int bit = __builtin_ctz(~bits);
+      pthread_key_t new_key = word * KEYMAP_BITS + bit;
+      if (new_key >= kKeyCount) {
+        break;
+      }
+      if (UpdateKeyMapWord(&gKeyMap[word], bits, bits | (1U << bit))) {
+        gKeys[new_key].destructor = key_destructor;
+        ANDROID_MEMBAR_FULL();
+        __bionic_atomic_inc(&gKeys[new_key].seq);
+        *key = new_key;
+        return 0;
+      }
+    }
+  }
+
+  // We hit the maximum number of keys. POSIX says EAGAIN for this case.
+  return EAGAIN;
 }
 
 // Deletes a pthread_key_t. note that the standard mandates that this does
@@ -203,30 +205,24 @@ int pthread_key_create(pthread_key_t* key, void (*key_destructor)(void*)) {
 // responsibility of the caller to properly dispose of the corresponding data
 // and resources, using any means it finds suitable.
 int pthread_key_delete(pthread_key_t key) {
-  ScopedTlsMapAccess tls_map;
-
-  if (!IsValidUserKey(key) || !tls_map.IsInUse(key)) {
+  if (!IsValidUserKey(key)) {
     return EINVAL;
   }
 
-  // Clear value in all threads.
-  pthread_mutex_lock(&gThreadListLock);
-  for (pthread_internal_t*  t = gThreadList; t != NULL; t = t->next) {
-    // Skip zombie threads. They don't have a valid TLS area any more.
-    // Similarly, it is possible to have t->tls == NULL for threads that
-    // were just recently created through pthread_create() but whose
-    // startup trampoline (__thread_entry) hasn't been run yet by the
-    // scheduler. t->tls will also be NULL after a thread's stack has been
-    // unmapped but before the ongoing pthread_join() is finished.
-    if ((t->attr.flags & PTHREAD_ATTR_FLAG_ZOMBIE) || t->tls == NULL) {
-      continue;
-    }
-
-    t->tls[key] = NULL;
+  // Bumping the sequence number invalidates every thread's value at once.
+  int seq = gKeys[key].seq;
+  if (!IsInUse(seq) || __bionic_cmpxchg(seq, seq + 1, &gKeys[key].seq) != 0) {
+    return EINVAL;
   }
-  tls_map.DeleteKey(key);
-
-  pthread_mutex_unlock(&gThreadListLock);
+  gKeys[key].destructor = NULL;
+  ANDROID_MEMBAR_FULL();
+
+  // Only now can the key be handed out again.
+  uint32_t volatile* word = &gKeyMap[key / KEYMAP_BITS];
+  uint32_t bits;
+  do {
+    bits = *word;
+  } while (!UpdateKeyMapWord(word, bits, bits & ~(1U << (key % KEYMAP_BITS))));
   return 0;
 }
 
@@ -235,20 +231,32 @@ void* pthread_getspecific(pthread_key_t key) {
     return NULL;
   }
 
-  // For performance reasons, we do not lock/unlock the global TLS map
-  // to check that the key is properly allocated. If the key was not
-  // allocated, the value read from the TLS should always be NULL
-  // due to pthread_key_delete() clearing the values for all threads.
-  return (void *)(((unsigned *)__get_tls())[key]);
+  int key_seq = gKeys[key].seq;
+  int* seq;
+  void** value = GetValueSlot(__get_thread(), key, &seq, false);
+  if (value == NULL || !IsInUse(key_seq) || *seq != key_seq) {
+    return NULL;
+  }
+  return *value;
 }
 
 int pthread_setspecific(pthread_key_t key, const void* ptr) {
-  ScopedTlsMapAccess tls_map;
+  if (!IsValidUserKey(key)) {
+    return EINVAL;
+  }
 
-  if (!IsValidUserKey(key) || !tls_map.IsInUse(key)) {
+  int key_seq = gKeys[key].seq;
+  if (!IsInUse(key_seq)) {
     return EINVAL;
   }
 
-  ((uint32_t *)__get_tls())[key] = (uint32_t)ptr;
+  int* seq;
+  void** value = GetValueSlot(__get_thread(), key, &seq, ptr != NULL);
+  if (value == NULL) {
+    // Only possible if we couldn't allocate the page to put a non-NULL value in.
+    return (ptr == NULL) ? 0 : ENOMEM;
+  }
+  *seq = key_seq;
+  *value = const_cast<void*>(ptr);
   return 0;
 }
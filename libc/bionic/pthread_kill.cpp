@@ -46,6 +46,11 @@ int pthread_kill(pthread_t t, int sig) {
   pid_t tid = thread->tid;
   thread.Unlock();
 
+  // The kernel clears the tid of a thread that has exited.
+  if (tid == 0) {
+    return ESRCH;
+  }
+
   int rc = tgkill(getpid(), tid, sig);
   if (rc == -1) {
     return errno;
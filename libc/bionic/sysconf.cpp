@@ -26,6 +26,8 @@
  * SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE 1  // For the CPU_* macros in <sched.h>.
+
 #include <asm/page.h>
 #include <bionic_tls.h>
 #include <ctype.h>
@@ -34,9 +36,12 @@
 #include <fcntl.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdio.h>  // For FOPEN_MAX.
+#include <stdlib.h>
 #include <string.h>
 #include <sys/sysconf.h>
+#include <sys/sysinfo.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -95,27 +100,98 @@ static int __sysconf_nprocessors_conf() {
   return result;
 }
 
+// Counts the CPUs in a kernel range list such as "0-3,5,7-8\n".
+static int __count_cpu_list(const char* s) {
+  int result = 0;
+  while (*s != '\0' && *s != '\n') {
+    char* end;
+    unsigned long first = strtoul(s, &end, 10);
+    if (end == s) {
+      return 0;
+    }
+    unsigned long last = first;
+    if (*end == '-') {
+      s = end + 1;
+      last = strtoul(s, &end, 10);
+      if (end == s || last < first) {
+        return 0;
+      }
+    }
+    result += last - first + 1;
+    s = end;
+    if (*s == ',') {
+      ++s;
+    }
+  }
+  return result;
+}
+
 static int __sysconf_nprocessors_onln() {
-  FILE* fp = fopen("/proc/stat", "r");
-  if (fp == NULL) {
+  int fd = TEMP_FAILURE_RETRY(open("/sys/devices/system/cpu/online", O_RDONLY | O_CLOEXEC));
+  if (fd == -1) {
     return 1;
   }
-
-  int result = 0;
   char buf[256];
-  while (fgets(buf, sizeof(buf), fp) != NULL) {
-    // Extract just the first word from the line.
-    // 'cpu0 7976751 1364388 3116842 469770388 8629405 0 49047 0 0 0'
-    char* p = strchr(buf, ' ');
-    if (p != NULL) {
-      *p = 0;
-    }
-    if (__matches_cpuN(buf)) {
-      ++result;
+  ssize_t n = TEMP_FAILURE_RETRY(read(fd, buf, sizeof(buf) - 1));
+  close(fd);
+  if (n <= 0) {
+    return 1;
+  }
+  buf[n] = '\0';
+
+  int result = __count_cpu_list(buf);
+  return (result > 0) ? result : 1;
+}
+
+// CPUs come and go (ARM devices take them offline to save power), but thread
+// pools ask how many there are far more often than that, so the counts are
+// only worked out again once they're a second or so old.
+struct CpuCount {
+  volatile int count;
+  volatile time_t expires;
+};
+
+static CpuCount gNprocessorsConf;
+static CpuCount gNprocessorsOnln;
+
+static int __cached_cpu_count(CpuCount* cache, int (*fn)()) {
+  timespec now;
+  if (clock_gettime(CLOCK_MONOTONIC_COARSE, &now) == -1) {
+    return fn();
+  }
+  int count = cache->count;
+  if (count > 0 && now.tv_sec < cache->expires) {
+    return count;
+  }
+  count = fn();
+  cache->count = count;
+  __sync_synchronize();
+  cache->expires = now.tv_sec + 1;
+  return count;
+}
+
+int get_nprocs_conf() {
+  return __cached_cpu_count(&gNprocessorsConf, __sysconf_nprocessors_conf);
+}
+
+int get_nprocs() {
+  return __cached_cpu_count(&gNprocessorsOnln, __sysconf_nprocessors_onln);
+}
+
+int get_nprocs_affinity() {
+  // Only count the CPUs this thread may run on, which is what matters when
+  // sizing a thread pool in a restricted cpuset. The kernel leaves offline
+  // CPUs out of the mask. cpu_set_t only has room for 32 CPUs, so use our own
+  // bigger set in case the kernel supports more than that.
+  __CPU_BITTYPE bits[1024 / __CPU_BITS];
+  cpu_set_t* set = reinterpret_cast<cpu_set_t*>(bits);
+  if (sched_getaffinity(0, sizeof(bits), set) == 0) {
+    int count = CPU_COUNT_S(sizeof(bits), set);
+    if (count > 0) {
+      return count;
     }
   }
-  fclose(fp);
-  return result;
+  return get_nprocs();
 }
 
 static int __get_meminfo(const char* pattern) {
@@ -307,7 +383,7 @@ int sysconf(int name) {
       return _POSIX_THREAD_DESTRUCTOR_ITERATIONS;
 
     case _SC_THREAD_KEYS_MAX:
-      return (BIONIC_TLS_SLOTS - TLS_SLOT_FIRST_USER_SLOT - GLOBAL_INIT_THREAD_LOCAL_BUFFER_COUNT);
+      return (BIONIC_TLS_SLOTS + BIONIC_TLS_EXTRA_KEYS - TLS_SLOT_FIRST_USER_SLOT - GLOBAL_INIT_THREAD_LOCAL_BUFFER_COUNT);
 
     case _SC_THREAD_STACK_MIN:    return PTHREAD_STACK_MIN;
     case _SC_THREAD_THREADS_MAX:  return SYSTEM_THREAD_THREADS_MAX;
@@ -335,8 +411,8 @@ int sysconf(int name) {
 #endif
 
     case _SC_MONOTONIC_CLOCK:   return __sysconf_monotonic_clock();
-    case _SC_NPROCESSORS_CONF:  return __sysconf_nprocessors_conf();
-    case _SC_NPROCESSORS_ONLN:  return __sysconf_nprocessors_onln();
+    case _SC_NPROCESSORS_CONF:  return get_nprocs_conf();
+    case _SC_NPROCESSORS_ONLN:  return get_nprocs();
     case _SC_PHYS_PAGES:        return __sysconf_phys_pages();
     case _SC_AVPHYS_PAGES:      return __sysconf_avphys_pages();
 
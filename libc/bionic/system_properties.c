@@ -254,9 +254,7 @@ static int map_prop_area()
         goto cleanup;
     }
 
-    if (pa->version == PROP_AREA_VERSION_COMPAT) {
-        compat_mode = true;
-    }
+    compat_mode = (pa->version == PROP_AREA_VERSION_COMPAT);
 
     result = 0;
 
@@ -487,7 +485,7 @@ static int send_prop_msg(prop_msg *msg)
     int r;
     int result = -1;
 
-    s = socket(AF_LOCAL, SOCK_STREAM, 0);
+    s = socket(AF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if(s < 0) {
         return result;
     }
@@ -622,6 +620,9 @@ int __system_property_add(const char *name, unsigned int namelen,
 
 unsigned int __system_property_serial(const prop_info *pi)
 {
+    if (__predict_false(compat_mode)) {
+        return __system_property_serial_compat(pi);
+    }
     return pi->serial;
 }
 
@@ -114,6 +114,13 @@ int __system_property_read_compat(const prop_info *_pi, char *name, char *value)
     }
 }
 
+unsigned int __system_property_serial_compat(const prop_info *_pi)
+{
+    const prop_info_compat *pi = (const prop_info_compat *)_pi;
+
+    return pi->serial;
+}
+
 int __system_property_foreach_compat(
         void (*propfn)(const prop_info *pi, void *cookie),
         void *cookie)
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <elf.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/auxv.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "libc_init_common.h"
+
+// Not all of our kernel headers define this, but its value is the same
+// everywhere, and getauxval just returns 0 if the kernel didn't map a vDSO.
+#ifndef AT_SYSINFO_EHDR
+#define AT_SYSINFO_EHDR 33
+#endif
+
+extern "C" int __clock_gettime(clockid_t, timespec*);
+extern "C" int __gettimeofday(timeval*, struct timezone*);
+
+typedef int (*ClockGettimeFn)(clockid_t, timespec*);
+typedef int (*GettimeofdayFn)(timeval*, struct timezone*);
+
+// Set once by __libc_init_vdso, before there are any other threads.
+static ClockGettimeFn gVdsoClockGettime = NULL;
+static GettimeofdayFn gVdsoGettimeofday = NULL;
+
+// The vDSO functions fall back to the syscall themselves when they can't
+// answer a query in user space, and then return the raw -errno.
+
+int clock_gettime(clockid_t clock, timespec* ts) {
+  ClockGettimeFn fn = gVdsoClockGettime;
+  if (fn == NULL) {
+    return __clock_gettime(clock, ts);
+  }
+  int result = fn(clock, ts);
+  if (result < 0) {
+    errno = -result;
+    return -1;
+  }
+  return result;
+}
+
+int gettimeofday(timeval* tv, struct timezone* tz) {
+  GettimeofdayFn fn = gVdsoGettimeofday;
+  if (fn == NULL) {
+    return __gettimeofday(tv, tz);
+  }
+  int result = fn(tv, tz);
+  if (result < 0) {
+    errno = -result;
+    return -1;
+  }
+  return result;
+}
+
+void __libc_init_vdso() {
+  uintptr_t vdso = static_cast<uintptr_t>(getauxval(AT_SYSINFO_EHDR));
+  if (vdso == 0) {
+    return;
+  }
+
+  Elf32_Ehdr* ehdr = reinterpret_cast<Elf32_Ehdr*>(vdso);
+
+  // How many dynamic symbols are there?
+  size_t symbol_count = 0;
+  Elf32_Shdr* shdr = reinterpret_cast<Elf32_Shdr*>(vdso + ehdr->e_shoff);
+  for (size_t i = 0; i < ehdr->e_shnum; ++i) {
+    if (shdr[i].sh_type == SHT_DYNSYM) {
+      symbol_count = shdr[i].sh_size / sizeof(Elf32_Sym);
+    }
+  }
+
+  // Where's the dynamic section, and where was the vDSO linked to run?
+  uintptr_t load_bias = 0;
+  Elf32_Dyn* dynamic = NULL;
+  Elf32_Phdr* phdr = reinterpret_cast<Elf32_Phdr*>(vdso + ehdr->e_phoff);
+  for (size_t i = 0; i < ehdr->e_phnum; ++i) {
+    if (phdr[i].p_type == PT_DYNAMIC) {
+      dynamic = reinterpret_cast<Elf32_Dyn*>(vdso + phdr[i].p_offset);
+    } else if (phdr[i].p_type == PT_LOAD) {
+      load_bias = vdso + phdr[i].p_offset - phdr[i].p_vaddr;
+    }
+  }
+  if (dynamic == NULL || symbol_count == 0) {
+    return;
+  }
+
+  // Find its string and symbol tables.
+  const char* strtab = NULL;
+  Elf32_Sym* symtab = NULL;
+  for (Elf32_Dyn* d = dynamic; d->d_tag != DT_NULL; ++d) {
+    if (d->d_tag == DT_STRTAB) {
+      strtab = reinterpret_cast<const char*>(load_bias + d->d_un.d_ptr);
+    } else if (d->d_tag == DT_SYMTAB) {
+      symtab = reinterpret_cast<Elf32_Sym*>(load_bias + d->d_un.d_ptr);
+    }
+  }
+  if (strtab == NULL || symtab == NULL) {
+    return;
+  }
+
+  // Are there any functions we want?
+  for (size_t i = 0; i < symbol_count; ++i) {
+    if (symtab[i].st_shndx == SHN_UNDEF || ELF32_ST_TYPE(symtab[i].st_info) != STT_FUNC) {
+      continue;
+    }
+    const char* name = strtab + symtab[i].st_name;
+    uintptr_t address = load_bias + symtab[i].st_value;
+    if (strcmp(name, "__vdso_clock_gettime") == 0) {
+      gVdsoClockGettime = reinterpret_cast<ClockGettimeFn>(address);
+    } else if (strcmp(name, "__vdso_gettimeofday") == 0) {
+      gVdsoGettimeofday = reinterpret_cast<GettimeofdayFn>(address);
+    }
+  }
+}
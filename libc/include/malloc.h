@@ -24,6 +24,7 @@
  */
 #include <sys/cdefs.h>
 #include <stddef.h>
+#include <stdint.h>
 
 __BEGIN_DECLS
 
@@ -56,6 +57,54 @@ struct mallinfo {
 
 extern struct mallinfo mallinfo(void);
 
+/*
+ * Heap walking, for in-process memory accounting.
+ *
+ * malloc_iterate calls 'callback' with the address and usable size of every
+ * block in use whose address is in [base, base + size). It must be called
+ * between malloc_disable and malloc_enable, which stop all other threads'
+ * allocations from making progress in the meantime. The thread holding
+ * malloc disabled must not allocate, free, or fork until it calls
+ * malloc_enable; that includes from 'callback'.
+ *
+ * Blocks large enough to have been given their own mapping (see
+ * mallinfo's hblkhd) aren't reported.
+ */
+extern void malloc_iterate(uintptr_t base, size_t size,
+                           void (*callback)(uintptr_t base, size_t size, void* arg), void* arg);
+extern void malloc_disable(void);
+extern void malloc_enable(void);
+
+/*
+ * Allocator statistics that are cheap to collect and so always maintained.
+ *
+ * Size class 'i' counts chunks whose size, including dlmalloc's per-chunk
+ * overhead, is in [2^i, 2^(i+1)); the last class also counts anything
+ * bigger. 'free_bytes' is the space held in free chunks, not counting the
+ * top chunk still to be carved up; it includes a few bytes of bookkeeping
+ * per heap segment. The lock counters only count
+ * acquisitions that found the heap lock held by another thread.
+ *
+ * malloc_get_extended_stats only holds the heap lock long enough to copy
+ * the counters, so it's fine to call while other threads are allocating.
+ */
+#define MALLOC_SIZE_CLASS_COUNT 32
+
+struct malloc_size_class_stats {
+  size_t live;    /* Number of chunks in this class currently allocated. */
+  uint64_t total; /* Number of chunks in this class ever allocated. */
+};
+
+struct malloc_extended_stats {
+  struct malloc_size_class_stats size_classes[MALLOC_SIZE_CLASS_COUNT];
+  size_t free_bytes;          /* Bytes held in free chunks. */
+  size_t mmapped_chunks;      /* Number of chunks with their own mapping. */
+  uint64_t lock_contentions;  /* Number of heap lock acquisitions that had to wait. */
+  uint64_t lock_wait_ns;      /* Total time spent waiting for the heap lock. */
+};
+
+extern void malloc_get_extended_stats(struct malloc_extended_stats* stats);
+
 __END_DECLS
 
 #endif  /* LIBC_INCLUDE_MALLOC_H_ */
@@ -104,6 +104,10 @@ typedef volatile int  pthread_once_t;
 #define PTHREAD_SCOPE_SYSTEM     0
 #define PTHREAD_SCOPE_PROCESS    1
 
+#define PTHREAD_PRIO_NONE        0
+#define PTHREAD_PRIO_INHERIT     1
+#define PTHREAD_PRIO_PROTECT     2
+
 /*
  * Prototypes
  */
@@ -160,6 +164,14 @@ int pthread_mutexattr_gettype(const pthread_mutexattr_t *attr, int *type);
 int pthread_mutexattr_settype(pthread_mutexattr_t *attr, int type);
 int pthread_mutexattr_setpshared(pthread_mutexattr_t *attr, int  pshared);
 int pthread_mutexattr_getpshared(pthread_mutexattr_t *attr, int *pshared);
+/*
+ * A PTHREAD_PRIO_INHERIT mutex uses one of 65536 process-wide slots until
+ * it is destroyed or initialized again. Freeing one without destroying it
+ * leaks its slot, and once all are in use initializing another fails with
+ * EAGAIN. PI mutexes can't be PTHREAD_PROCESS_SHARED.
+ */
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t *attr, int protocol);
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t *attr, int *protocol);
 
 int pthread_mutex_init(pthread_mutex_t *mutex,
                        const pthread_mutexattr_t *attr);
@@ -228,16 +240,18 @@ int pthread_mutex_lock_timeout_np(pthread_mutex_t *mutex, unsigned msecs);
 typedef int pthread_rwlockattr_t;
 
 typedef struct {
-    pthread_mutex_t  lock;
-    pthread_cond_t   cond;
-    int              numLocks;
-    int              writerThreadId;
-    int              pendingReaders;
-    int              pendingWriters;
-    void*            reserved[4];  /* for future extensibility */
+    int volatile     state;
+    int volatile     writer_thread_id;
+    int              write_lock_count;
+    pthread_mutex_t  pending_lock;
+    int              pending_reader_count;
+    int              pending_writer_count;
+    int volatile     pending_reader_wakeup_serial;
+    int volatile     pending_writer_wakeup_serial;
+    void*            reserved[2];  /* for future extensibility */
 } pthread_rwlock_t;
 
-#define PTHREAD_RWLOCK_INITIALIZER  { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, { NULL, NULL, NULL, NULL } }
+#define PTHREAD_RWLOCK_INITIALIZER  { 0, 0, 0, PTHREAD_MUTEX_INITIALIZER, 0, 0, 0, 0, { NULL, NULL } }
 
 int pthread_rwlockattr_init(pthread_rwlockattr_t *attr);
 int pthread_rwlockattr_destroy(pthread_rwlockattr_t *attr);
@@ -257,6 +271,40 @@ int pthread_rwlock_timedwrlock(pthread_rwlock_t *rwlock, const struct timespec *
 
 int pthread_rwlock_unlock(pthread_rwlock_t *rwlock);
 
+/* barrier support */
+
+typedef int pthread_barrierattr_t;
+
+typedef struct {
+    unsigned int  count;
+    int           shared;
+    int volatile  arrived;   /* threads that have reached the barrier in this phase */
+    int volatile  phase;     /* bumped each time the barrier opens */
+    int volatile  sleepers;  /* threads waiting in the kernel for 'phase' to change */
+    int volatile  waiters;   /* threads inside pthread_barrier_wait, released or not */
+} pthread_barrier_t;
+
+#define PTHREAD_BARRIER_SERIAL_THREAD  -1
+
+int pthread_barrierattr_init(pthread_barrierattr_t *attr);
+int pthread_barrierattr_destroy(pthread_barrierattr_t *attr);
+int pthread_barrierattr_setpshared(pthread_barrierattr_t *attr, int pshared);
+int pthread_barrierattr_getpshared(const pthread_barrierattr_t *attr, int *pshared);
+
+int pthread_barrier_init(pthread_barrier_t *barrier, const pthread_barrierattr_t *attr, unsigned int count);
+int pthread_barrier_destroy(pthread_barrier_t *barrier);
+int pthread_barrier_wait(pthread_barrier_t *barrier);
+
+/* spinlock support */
+
+typedef volatile int pthread_spinlock_t;
+
+int pthread_spin_init(pthread_spinlock_t *lock, int pshared);
+int pthread_spin_destroy(pthread_spinlock_t *lock);
+int pthread_spin_lock(pthread_spinlock_t *lock);
+int pthread_spin_trylock(pthread_spinlock_t *lock);
+int pthread_spin_unlock(pthread_spinlock_t *lock);
+
 
 int pthread_key_create(pthread_key_t *key, void (*destructor_function)(void *));
 int pthread_key_delete (pthread_key_t);
@@ -135,6 +135,7 @@ unsigned int __system_property_wait_any(unsigned int serial);
  ** a pre-K release no longer needed to be supported. */
 const prop_info *__system_property_find_compat(const char *name);
 int __system_property_read_compat(const prop_info *pi, char *name, char *value);
+unsigned int __system_property_serial_compat(const prop_info *pi);
 int __system_property_foreach_compat(
         void (*propfn)(const prop_info *pi, void *cookie),
         void *cookie);
@@ -34,6 +34,7 @@
 __BEGIN_DECLS
 
 extern ssize_t sendfile(int out_fd, int in_fd, off_t *offset, size_t count);
+extern ssize_t sendfile64(int out_fd, int in_fd, off64_t *offset, size_t count);
 
 __END_DECLS
 
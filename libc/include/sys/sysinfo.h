@@ -35,6 +35,13 @@ __BEGIN_DECLS
 
 extern int sysinfo (struct sysinfo *info);
 
+/* The number of CPUs configured, and the number online. */
+extern int get_nprocs_conf(void);
+extern int get_nprocs(void);
+
+/* The number of online CPUs the calling thread may run on (a bionic extension). */
+extern int get_nprocs_affinity(void);
+
 __END_DECLS
 
 #endif /* _SYS_SYSINFO_H_ */
@@ -37,6 +37,11 @@ __BEGIN_DECLS
 int readv(int, const struct iovec *, int);
 int writev(int, const struct iovec *, int);
 
+ssize_t preadv(int, const struct iovec *, int, off_t);
+ssize_t preadv64(int, const struct iovec *, int, off64_t);
+ssize_t pwritev(int, const struct iovec *, int, off_t);
+ssize_t pwritev64(int, const struct iovec *, int, off64_t);
+
 __END_DECLS
 
 #endif /* _SYS_UIO_H_ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef res_dg_batch_h
+#define res_dg_batch_h
+
+/*
+ * Batched UDP receives for send_dg. This is a header rather than part of
+ * res_send.c so that the tests can include it and force the fallback path.
+ * The includer must already have PACKETSZ.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <errno.h>
+#include <string.h>
+
+/*
+ * The datagrams read from a UDP socket with one recvmmsg(2). When a try
+ * times out, its late answer is often queued ahead of the next try's. The
+ * first datagram goes straight into the caller's answer buffer and the rest
+ * into 'extra', which is big enough for any answer without EDNS0.
+ */
+#define DG_BATCH	4
+
+struct dg_batch {
+	struct mmsghdr		msgs[DG_BATCH];
+	struct iovec		iovs[DG_BATCH];
+	struct sockaddr_storage	from[DG_BATCH];
+	u_char			extra[DG_BATCH - 1][PACKETSZ];
+	int			count;	/* how many recvmmsg returned */
+	int			next;	/* the next one to look at */
+};
+
+/*
+ * Set once recvmmsg(2) turns out not to exist (before Linux 2.6.33). From
+ * then on every receive is a single recvfrom(2), as it used to be.
+ */
+static int dg_batch_no_recvmmsg;
+
+static int
+dg_batch_recv(int s, struct dg_batch *b, u_char *ans, int anssiz, int vlen)
+{
+	socklen_t fromlen;
+	ssize_t n;
+	int i;
+
+	for (i = 0; i < vlen; i++) {
+		memset(&b->msgs[i], 0, sizeof(b->msgs[i]));
+		b->iovs[i].iov_base = (i == 0) ? ans : b->extra[i - 1];
+		b->iovs[i].iov_len = (i == 0) ? (size_t)anssiz : PACKETSZ;
+		b->msgs[i].msg_hdr.msg_name = &b->from[i];
+		b->msgs[i].msg_hdr.msg_namelen = sizeof(b->from[i]);
+		b->msgs[i].msg_hdr.msg_iov = &b->iovs[i];
+		b->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	b->next = 0;
+	if (!dg_batch_no_recvmmsg) {
+		/* Wait for the first, but only take the rest if they're already here. */
+		b->count = recvmmsg(s, b->msgs, (unsigned int)vlen, MSG_WAITFORONE, NULL);
+		/* x86 goes through socketcall(2), which says EINVAL instead. */
+		if (b->count < 0 && (errno == ENOSYS
+#if defined(__i386__)
+		    || errno == EINVAL
+#endif
+		    ))
+			dg_batch_no_recvmmsg = 1;
+	}
+	if (dg_batch_no_recvmmsg) {
+		fromlen = sizeof(b->from[0]);
+		n = recvfrom(s, (char *)ans, (size_t)anssiz, 0,
+		    (struct sockaddr *)(void *)&b->from[0], &fromlen);
+		if (n >= 0) {
+			b->msgs[0].msg_len = (unsigned int)n;
+			b->msgs[0].msg_hdr.msg_namelen = fromlen;
+		}
+		b->count = (n < 0) ? -1 : 1;
+	}
+	if (b->count < 0)
+		b->count = 0;
+	return b->count;
+}
+
+/*
+ * Puts the next datagram in 'ans' and returns its length, or returns -1 if
+ * it didn't fit in 'extra' (and so can't be an answer to us).
+ */
+static int
+dg_batch_next(struct dg_batch *b, u_char *ans, struct sockaddr **fromp)
+{
+	const int i = b->next++;
+	const struct mmsghdr *m = &b->msgs[i];
+
+	*fromp = (struct sockaddr *)(void *)&b->from[i];
+	if (i == 0)
+		return (int)m->msg_len;
+	if ((m->msg_hdr.msg_flags & MSG_TRUNC) != 0)
+		return -1;
+	memcpy(ans, b->extra[i - 1], m->msg_len);
+	return (int)m->msg_len;
+}
+
+#endif
@@ -132,6 +132,7 @@ __RCSID("$NetBSD: res_send.c,v 1.9 2006/01/24 17:41:25 christos Exp $");
 #endif
 #include "res_debug.h"
 #include "res_private.h"
+#include "res_dg_batch.h"
 
 #define EXT(res) ((res)->_u._ext)
 #define DBG 0
@@ -778,7 +779,7 @@ send_vc(res_state statp,
 		if (statp->_vcsock >= 0)
 			res_nclose(statp);
 
-		statp->_vcsock = socket(nsap->sa_family, SOCK_STREAM, 0);
+		statp->_vcsock = socket(nsap->sa_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
 		if (statp->_vcsock > highestFD) {
 			res_nclose(statp);
 			errno = ENOTSOCK;
@@ -1054,14 +1055,14 @@ send_dg(res_state statp,
 	int nsaplen;
 	struct timespec now, timeout, finish;
 	fd_set dsmask;
-	struct sockaddr_storage from;
-	socklen_t fromlen;
-	int resplen, seconds, n, s;
+	struct dg_batch batch;
+	struct sockaddr *from;
+	int resplen, seconds, n, s, vlen;
 
 	nsap = get_nsaddr(statp, (size_t)ns);
 	nsaplen = get_salen(nsap);
 	if (EXT(statp).nssocks[ns] == -1) {
-		EXT(statp).nssocks[ns] = socket(nsap->sa_family, SOCK_DGRAM, 0);
+		EXT(statp).nssocks[ns] = socket(nsap->sa_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
 		if (EXT(statp).nssocks[ns] > highestFD) {
 			res_nclose(statp);
 			errno = ENOTSOCK;
@@ -1141,25 +1142,39 @@ send_dg(res_state statp,
 	now = evNowTime();
 	timeout = evConsTime((long)seconds, 0L);
 	finish = evAddTime(now, timeout);
+	/* Only batch when every answer fits in 'extra'. */
+	vlen = (anssiz >= PACKETSZ) ? DG_BATCH : 1;
+#ifdef RES_USE_EDNS0
+	if ((statp->options & RES_USE_EDNS0) != 0U)
+		vlen = 1;
+#endif
+	batch.count = batch.next = 0;
 retry:
-	n = retrying_select(s, &dsmask, NULL, &finish);
+	if (batch.next == batch.count) {
+		n = retrying_select(s, &dsmask, NULL, &finish);
 
-	if (n == 0) {
-		Dprint(statp->options & RES_DEBUG, (stdout, ";; timeout\n"));
-		*gotsomewhere = 1;
-		return (0);
-	}
-	if (n < 0) {
-		Perror(statp, stderr, "select", errno);
-		res_nclose(statp);
-		return (0);
+		if (n == 0) {
+			Dprint(statp->options & RES_DEBUG, (stdout, ";; timeout\n"));
+			*gotsomewhere = 1;
+			return (0);
+		}
+		if (n < 0) {
+			Perror(statp, stderr, "select", errno);
+			res_nclose(statp);
+			return (0);
+		}
+		errno = 0;
+		if (dg_batch_recv(s, &batch, ans, anssiz, vlen) == 0) {
+			Perror(statp, stderr, "recvmmsg", errno);
+			res_nclose(statp);
+			return (0);
+		}
 	}
-	errno = 0;
-	fromlen = sizeof(from);
-	resplen = recvfrom(s, (char*)ans, (size_t)anssiz,0,
-			   (struct sockaddr *)(void *)&from, &fromlen);
-	if (resplen <= 0) {
-		Perror(statp, stderr, "recvfrom", errno);
+	resplen = dg_batch_next(&batch, ans, &from);
+	if (resplen < 0)
+		goto retry;
+	if (resplen == 0) {
+		Perror(statp, stderr, "recvmmsg", errno);
 		res_nclose(statp);
 		return (0);
 	}
@@ -1191,7 +1206,7 @@ retry:
 		goto retry;
 	}
 	if (!(statp->options & RES_INSECURE1) &&
-	    !res_ourserver_p(statp, (struct sockaddr *)(void *)&from)) {
+	    !res_ourserver_p(statp, from)) {
 		/*
 		 * response from wrong server? ignore it.
 		 * XXX - potential security hazard could
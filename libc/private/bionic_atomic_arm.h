@@ -120,6 +120,23 @@ __bionic_memory_barrier(void)
 }
 #endif /* !ANDROID_SMP */
 
+/* Tell the CPU we're busy-waiting, e.g. spinning on a lock. The 'yield' hint
+ * only exists from ARMv6K on; elsewhere, this is just a compiler barrier.
+ */
+#ifdef __ARM_HAVE_DMB
+__ATOMIC_INLINE__ void
+__bionic_cpu_relax(void)
+{
+    __asm__ __volatile__ ( "yield" : : : "memory" );
+}
+#else
+__ATOMIC_INLINE__ void
+__bionic_cpu_relax(void)
+{
+    __asm__ __volatile__ ( "" : : : "memory" );
+}
+#endif
+
 #ifndef __ARM_HAVE_LDREX_STREX
 #error Only ARM devices which have LDREX / STREX are supported
 #endif
@@ -27,6 +27,12 @@ __bionic_memory_barrier(void)
     __sync_synchronize();
 }
 
+__ATOMIC_INLINE__ void
+__bionic_cpu_relax(void)
+{
+    __asm__ __volatile__ ( "" : : : "memory" );
+}
+
 __ATOMIC_INLINE__ int
 __bionic_cmpxchg(int32_t old_value, int32_t new_value, volatile int32_t* ptr)
 {
@@ -34,6 +34,15 @@ __bionic_memory_barrier()
 }
 #endif
 
+/* Tell the CPU we're busy-waiting, e.g. spinning on a lock. MIPS has no
+ * such hint, so this is just a compiler barrier.
+ */
+__ATOMIC_INLINE__ void
+__bionic_cpu_relax()
+{
+    __asm__ __volatile__ ( "" : : : "memory" );
+}
+
 /* Compare-and-swap, without any explicit barriers. Note that this function
  * returns 0 on success, and 1 on failure. The opposite convention is typically
  * used on other platforms.
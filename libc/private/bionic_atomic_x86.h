@@ -34,6 +34,13 @@ __bionic_memory_barrier()
 }
 #endif
 
+/* Tell the CPU we're busy-waiting, e.g. spinning on a lock. */
+__ATOMIC_INLINE__ void
+__bionic_cpu_relax()
+{
+    __asm__ __volatile__ ( "pause" : : : "memory" );
+}
+
 /* Compare-and-swap, without any explicit barriers. Note that this function
  * returns 0 on success, and 1 on failure. The opposite convention is typically
  * used on other platforms.
@@ -38,6 +38,8 @@ extern int __futex_wake(volatile void *ftx, int count);
 
 extern int __futex_syscall3(volatile void *ftx, int op, int val);
 extern int __futex_syscall4(volatile void *ftx, int op, int val, const struct timespec *timeout);
+extern int __futex_syscall6(volatile void *ftx, int op, int val, const struct timespec *timeout,
+                            volatile void *ftx2, int val3);
 
 #ifndef FUTEX_PRIVATE_FLAG
 #define FUTEX_PRIVATE_FLAG  128
@@ -51,6 +53,18 @@ extern int __futex_syscall4(volatile void *ftx, int op, int val, const struct ti
 #define FUTEX_WAKE_PRIVATE  (FUTEX_WAKE|FUTEX_PRIVATE_FLAG)
 #endif
 
+#ifndef FUTEX_CMP_REQUEUE_PRIVATE
+#define FUTEX_CMP_REQUEUE_PRIVATE  (FUTEX_CMP_REQUEUE|FUTEX_PRIVATE_FLAG)
+#endif
+
+#ifndef FUTEX_LOCK_PI_PRIVATE
+#define FUTEX_LOCK_PI_PRIVATE  (FUTEX_LOCK_PI|FUTEX_PRIVATE_FLAG)
+#endif
+
+#ifndef FUTEX_UNLOCK_PI_PRIVATE
+#define FUTEX_UNLOCK_PI_PRIVATE  (FUTEX_UNLOCK_PI|FUTEX_PRIVATE_FLAG)
+#endif
+
 /* Like __futex_wait/wake, but take an additionnal 'pshared' argument.
  * when non-0, this will use normal futexes. Otherwise, private futexes.
  */
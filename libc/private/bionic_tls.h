@@ -75,7 +75,7 @@ enum {
  * pthread_key_create; grep for GLOBAL_INIT_THREAD_LOCAL_BUFFER to find those. We need to manually
  * maintain that second number, but pthread_test will fail if we forget.
  */
-#define GLOBAL_INIT_THREAD_LOCAL_BUFFER_COUNT 4
+#define GLOBAL_INIT_THREAD_LOCAL_BUFFER_COUNT 5
 /*
  * This is PTHREAD_KEYS_MAX + TLS_SLOT_FIRST_USER_SLOT + GLOBAL_INIT_THREAD_LOCAL_BUFFER_COUNT
  * rounded up to maintain stack alignment.
@@ -83,6 +83,12 @@ enum {
 #define BIONIC_ALIGN(x, a) (((x) + (a - 1)) & ~(a - 1))
 #define BIONIC_TLS_SLOTS BIONIC_ALIGN(128 + TLS_SLOT_FIRST_USER_SLOT + GLOBAL_INIT_THREAD_LOCAL_BUFFER_COUNT, 4)
 
+/*
+ * pthread keys past the BIONIC_TLS_SLOTS direct slots. Their values live in
+ * per-thread pages that are only allocated when a thread first sets one.
+ */
+#define BIONIC_TLS_EXTRA_KEYS 1024
+
 /* syscall only, do not call directly */
 extern int __set_tls(void* ptr);
 
@@ -47,6 +47,9 @@
 
 /* BEGIN android-added: thread-safety. */
 #include <pthread.h>
+#define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
+#include <sys/_system_properties.h> // For __system_property_serial.
+#include "ThreadLocalBuffer.h"
 static pthread_mutex_t _tzMutex = PTHREAD_MUTEX_INITIALIZER;
 static inline void _tzLock(void) { pthread_mutex_lock(&_tzMutex); }
 static inline void _tzUnlock(void) { pthread_mutex_unlock(&_tzMutex); }
@@ -146,7 +149,7 @@ struct rule {
 
 /* NOTE: all internal functions assume that _tzLock() was already called */
 
-static int __bionic_open_tzdata(const char*, int*);
+static int __bionic_find_tzdata(const char*, const char**, int*);
 static int_fast32_t detzcode(const char * codep);
 static time_t   detzcode64(const char * codep);
 static int      differ_by_repeat(time_t t1, time_t t0);
@@ -197,14 +200,11 @@ static int      tzparse(const char * name, struct state * sp,
                 int lastditch);
 
 #ifdef ALL_STATE
-static struct state *   lclptr;
 static struct state *   gmtptr;
 #endif /* defined ALL_STATE */
 
 #ifndef ALL_STATE
-static struct state lclmem;
 static struct state gmtmem;
-#define lclptr      (&lclmem)
 #define gmtptr      (&gmtmem)
 #endif /* State Farm */
 
@@ -212,8 +212,38 @@ static struct state gmtmem;
 #define TZ_STRLEN_MAX 255
 #endif /* !defined TZ_STRLEN_MAX */
 
+// BEGIN android-changed: shared, immutable time zones.
+// A loaded time zone. Once published, its state never changes, so any number of
+// threads can use it without locking. Zones live in a small cache (see
+// __bionic_tz_get_locked) and are freed when their last reference is released,
+// except for zones that have been the local zone, which are kept for good:
+// tzname[] and tm_zone point into them.
+struct bionic_tz {
+    struct state        state;
+    volatile int        refcount;
+    struct bionic_tz *  pinned_next;    /* in lcl_pinned, if ever the local zone */
+    char                name[TZ_STRLEN_MAX + 1];
+};
+
+// The local zone is published with a sequence number, which is odd while
+// tzset_locked is changing it, along with what it was derived from: the TZ
+// environment variable, or the "persist.sys.timezone" property's serial number.
+// localtime_r and mktime check those without taking the lock (see lcl_tz_get).
+#define LCL_KEY_NONE        0   /* always revalidate */
+#define LCL_KEY_ENV         1   /* getenv("TZ") equals lcl_TZname */
+#define LCL_KEY_PROPERTY    2   /* no TZ, and lcl_prop's serial is lcl_prop_serial */
+
+static struct bionic_tz * volatile  lcl_tz;
+static volatile unsigned    lcl_seq;
+static volatile int         lcl_key;
+static const prop_info * volatile   lcl_prop;   /* NULL if the property didn't exist */
+static volatile unsigned    lcl_prop_serial;
+static struct bionic_tz *   lcl_pinned;
+
+#define lclptr      (&lcl_tz->state)
+// END android-changed
+
 static char     lcl_TZname[TZ_STRLEN_MAX + 1];
-static int      lcl_is_set;
 static int      gmt_is_set;
 
 char *          tzname[2] = {
@@ -346,48 +376,31 @@ tzload(register const char* name, register struct state* const sp,
 {
     register const char *       p;
     register int            i;
-    register int            fid;
     register int            stored;
-    register int            nread;
-    typedef union {
-        struct tzhead   tzhead;
-        char        buf[2 * sizeof(struct tzhead) +
-                    2 * sizeof *sp +
-                    4 * TZ_MAX_TIMES];
-    } u_t;
-#ifdef ALL_STATE
-    register u_t *			up;
-
-    up = (u_t *) calloc(1, sizeof *up);
-    if (up == NULL)
-        return -1;
-#else /* !defined ALL_STATE */
-    u_t				u;
-    register u_t * const		up = &u;
-#endif /* !defined ALL_STATE */
+    int                     nread;
+    /* The zone's data, parsed in place from the mapped tzdata file. */
+    const char *            buf;
+    const struct tzhead *   tzhead;
 
     sp->goback = sp->goahead = FALSE;
     if (name == NULL && (name = TZDEFAULT) == NULL)
-        goto oops;
-    int toread;
-    fid = __bionic_open_tzdata(name, &toread);
-    if (fid < 0) {
         return -1;
-    }
-    nread = read(fid, up->buf, toread);
-    if (close(fid) < 0 || nread <= 0)
-        goto oops;
+    if (__bionic_find_tzdata(name, &buf, &nread) != 0)
+        return -1;
     for (stored = 4; stored <= 8; stored *= 2) {
         int     ttisstdcnt;
         int     ttisgmtcnt;
 
-        ttisstdcnt = (int) detzcode(up->tzhead.tzh_ttisstdcnt);
-        ttisgmtcnt = (int) detzcode(up->tzhead.tzh_ttisgmtcnt);
-        sp->leapcnt = (int) detzcode(up->tzhead.tzh_leapcnt);
-        sp->timecnt = (int) detzcode(up->tzhead.tzh_timecnt);
-        sp->typecnt = (int) detzcode(up->tzhead.tzh_typecnt);
-        sp->charcnt = (int) detzcode(up->tzhead.tzh_charcnt);
-        p = up->tzhead.tzh_charcnt + sizeof up->tzhead.tzh_charcnt;
+        if (nread < (int) sizeof *tzhead)
+                return -1;
+        tzhead = (const struct tzhead *) buf;
+        ttisstdcnt = (int) detzcode(tzhead->tzh_ttisstdcnt);
+        ttisgmtcnt = (int) detzcode(tzhead->tzh_ttisgmtcnt);
+        sp->leapcnt = (int) detzcode(tzhead->tzh_leapcnt);
+        sp->timecnt = (int) detzcode(tzhead->tzh_timecnt);
+        sp->typecnt = (int) detzcode(tzhead->tzh_typecnt);
+        sp->charcnt = (int) detzcode(tzhead->tzh_charcnt);
+        p = tzhead->tzh_charcnt + sizeof tzhead->tzh_charcnt;
         if (sp->leapcnt < 0 || sp->leapcnt > TZ_MAX_LEAPS ||
             sp->typecnt <= 0 || sp->typecnt > TZ_MAX_TYPES ||
             sp->timecnt < 0 || sp->timecnt > TZ_MAX_TIMES ||
@@ -395,7 +408,7 @@ tzload(register const char* name, register struct state* const sp,
             (ttisstdcnt != sp->typecnt && ttisstdcnt != 0) ||
             (ttisgmtcnt != sp->typecnt && ttisgmtcnt != 0))
                 goto oops;
-        if (nread - (p - up->buf) <
+        if (nread - (p - buf) <
             sp->timecnt * stored +      /* ats */
             sp->timecnt +           /* types */
             sp->typecnt * 6 +       /* ttinfos */
@@ -508,25 +521,27 @@ tzload(register const char* name, register struct state* const sp,
         /*
         ** If this is an old file, we're done.
         */
-        if (up->tzhead.tzh_version[0] == '\0')
+        if (tzhead->tzh_version[0] == '\0')
             break;
-        nread -= p - up->buf;
-        for (i = 0; i < nread; ++i)
-            up->buf[i] = p[i];
+        nread -= p - buf;
+        buf = p;
         /*
         ** If this is a narrow integer time_t system, we're done.
         */
         if (stored >= (int) sizeof(time_t) && TYPE_INTEGRAL(time_t))
             break;
     }
-    if (doextend && nread > 2 &&
-        up->buf[0] == '\n' && up->buf[nread - 1] == '\n' &&
+    if (doextend && nread > 2 && nread - 2 <= TZ_STRLEN_MAX &&
+        buf[0] == '\n' && buf[nread - 1] == '\n' &&
         sp->typecnt + 2 <= TZ_MAX_TYPES) {
             struct state    ts;
             register int    result;
+            char            tzstring[TZ_STRLEN_MAX + 1];
 
-            up->buf[nread - 1] = '\0';
-            result = tzparse(&up->buf[1], &ts, FALSE);
+            /* The mapping is read-only, so terminate a copy. */
+            memcpy(tzstring, &buf[1], nread - 2);
+            tzstring[nread - 2] = '\0';
+            result = tzparse(tzstring, &ts, FALSE);
             if (result == 0 && ts.typecnt == 2 &&
                 sp->charcnt + ts.charcnt <= TZ_MAX_CHARS) {
                     for (i = 0; i < 2; ++i)
@@ -604,14 +619,8 @@ tzload(register const char* name, register struct state* const sp,
                 }
         }
         sp->defaulttype = i;
-#ifdef ALL_STATE
-        free(up);
-#endif /* defined ALL_STATE */
         return 0;
 oops:
-#ifdef ALL_STATE
-        free(up);
-#endif /* defined ALL_STATE */
         return -1;
 }
 
@@ -1170,6 +1179,136 @@ gmtload(struct state * const sp)
         (void) tzparse(gmt, sp, TRUE);
 }
 
+// BEGIN android-changed: shared, immutable time zones.
+#define TZ_CACHE_SIZE 8
+
+static struct bionic_tz *   tz_cache[TZ_CACHE_SIZE];
+static int                  tz_cache_next;
+
+static void
+__bionic_tz_release(struct bionic_tz * const tz)
+{
+    if (__sync_sub_and_fetch(&tz->refcount, 1) == 0)
+        free(tz);
+}
+
+static struct bionic_tz *
+__bionic_tz_load(const char * const name)
+{
+    struct bionic_tz *  tz;
+    struct state *      sp;
+
+    tz = malloc(sizeof *tz);
+    if (tz == NULL)
+        return NULL;
+    tz->refcount = 1;
+    tz->pinned_next = NULL;
+    (void) strcpy(tz->name, name);
+
+    sp = &tz->state;
+    if (*name == '\0') {
+        /*
+        ** User wants it fast rather than right.
+        */
+        sp->leapcnt = 0;        /* so, we're off a little */
+        sp->timecnt = 0;
+        sp->typecnt = 0;
+        sp->goback = sp->goahead = FALSE;
+        sp->defaulttype = 0;
+        sp->ttis[0].tt_isdst = 0;
+        sp->ttis[0].tt_gmtoff = 0;
+        sp->ttis[0].tt_abbrind = 0;
+        (void) strcpy(sp->chars, gmt);
+    } else if (tzload(name, sp, TRUE) != 0)
+        if (name[0] == ':' || tzparse(name, sp, FALSE) != 0)
+            gmtload(sp);
+    return tz;
+}
+
+/*
+** Returns a new reference to the zone called 'name', loading it if it isn't
+** already cached, or NULL if we're out of memory.
+*/
+static struct bionic_tz *
+__bionic_tz_get_locked(const char * name)
+{
+    struct bionic_tz *  tz;
+    int                 i;
+
+    if (strlen(name) > TZ_STRLEN_MAX)
+        name = gmt;
+
+    for (i = 0; i < TZ_CACHE_SIZE; ++i) {
+        tz = tz_cache[i];
+        if (tz != NULL && strcmp(tz->name, name) == 0) {
+            __sync_fetch_and_add(&tz->refcount, 1);
+            return tz;
+        }
+    }
+
+    tz = __bionic_tz_load(name);
+    if (tz == NULL)
+        return NULL;
+    /* The cache's reference replaces the oldest entry's. */
+    if (tz_cache[tz_cache_next] != NULL)
+        __bionic_tz_release(tz_cache[tz_cache_next]);
+    tz_cache[tz_cache_next] = tz;
+    tz_cache_next = (tz_cache_next + 1) % TZ_CACHE_SIZE;
+    __sync_fetch_and_add(&tz->refcount, 1);
+    return tz;
+}
+
+/* Returns the zone called 'name', which will never be freed. */
+static struct bionic_tz *
+__bionic_tz_pin_locked(const char * name)
+{
+    static struct bionic_tz     fallback;
+    struct bionic_tz *          tz;
+
+    if (strlen(name) > TZ_STRLEN_MAX)
+        name = gmt;
+    for (tz = lcl_pinned; tz != NULL; tz = tz->pinned_next)
+        if (strcmp(tz->name, name) == 0)
+            return tz;
+
+    /* We just keep the reference we're given. */
+    tz = __bionic_tz_get_locked(name);
+    if (tz == NULL) {
+        /* Out of memory: all we can do is GMT. */
+        if (fallback.name[0] == '\0') {
+            gmtload(&fallback.state);
+            (void) strcpy(fallback.name, gmt);
+        }
+        return &fallback;
+    }
+    tz->pinned_next = lcl_pinned;
+    lcl_pinned = tz;
+    return tz;
+}
+
+static void
+__bionic_set_local_tz_locked(struct bionic_tz * const tz, const int key,
+                             const char * const env, const prop_info * const pi,
+                             const unsigned serial)
+{
+    const int changed = (tz != lcl_tz);
+
+    lcl_seq++;
+    __sync_synchronize();
+    lcl_tz = tz;
+    lcl_key = key;
+    if (key == LCL_KEY_ENV)
+        (void) strcpy(lcl_TZname, env);
+    lcl_prop = pi;
+    lcl_prop_serial = serial;
+    __sync_synchronize();
+    lcl_seq++;
+
+    if (changed)
+        settzname();
+}
+// END android-changed
+
 #ifndef STD_INSPIRED
 /*
 ** A non-static declaration of tzsetwall in a system header file
@@ -1180,74 +1319,79 @@ static
 void
 tzsetwall(void)
 {
-    if (lcl_is_set < 0)
-        return;
-    lcl_is_set = -1;
-
-#ifdef ALL_STATE
-    if (lclptr == NULL) {
-        lclptr = calloc(1, sizeof *lclptr);
-        if (lclptr == NULL) {
-            settzname();    /* all we can do */
-            return;
-        }
-    }
-#endif /* defined ALL_STATE */
-    if (tzload(NULL, lclptr, TRUE) != 0)
-        gmtload(lclptr);
-    settzname();
+    // android-changed: until the next time TZ or the property is checked.
+    _tzLock();
+    __bionic_set_local_tz_locked(__bionic_tz_pin_locked(TZDEFAULT), LCL_KEY_NONE, NULL, NULL, 0);
+    _tzUnlock();
 }
 
-#include <sys/system_properties.h> // For __system_property_get.
-
 static void
 tzset_locked(void)
 {
     register const char *   name = NULL;
+    const char *            env;
+    const prop_info *       pi = NULL;
+    unsigned                serial = 0;
+    int                     key;
 
-    name = getenv("TZ");
+    env = name = getenv("TZ");
 
     // try the "persist.sys.timezone" system property first
+    // android-changed: remembering its serial number, read before its value,
+    // so that lcl_tz_get can tell whether it's changed since.
     static char buf[PROP_VALUE_MAX];
-    if (name == NULL && __system_property_get("persist.sys.timezone", buf) > 0) {
-        name = buf;
-    }
-
     if (name == NULL) {
-        tzsetwall();
-        return;
+        pi = __system_property_find("persist.sys.timezone");
+        if (pi != NULL) {
+            serial = __system_property_serial(pi);
+            if (__system_property_read(pi, NULL, buf) > 0)
+                name = buf;
+        }
     }
 
-    if (lcl_is_set > 0 && strcmp(lcl_TZname, name) == 0)
-        return;
-    lcl_is_set = strlen(name) < sizeof lcl_TZname;
-    if (lcl_is_set)
-        (void) strcpy(lcl_TZname, name);
+    key = (env != NULL) ? LCL_KEY_ENV : LCL_KEY_PROPERTY;
+    if (env != NULL && strlen(env) > TZ_STRLEN_MAX)
+        key = LCL_KEY_NONE;
+    if (name == NULL)
+        name = TZDEFAULT;
 
-#ifdef ALL_STATE
-    if (lclptr == NULL) {
-        lclptr = calloc(1, sizeof *lclptr);
-        if (lclptr == NULL) {
-            settzname();    /* all we can do */
-            return;
-        }
-    }
-#endif /* defined ALL_STATE */
-    if (*name == '\0') {
-        /*
-        ** User wants it fast rather than right.
-        */
-        lclptr->leapcnt = 0;        /* so, we're off a little */
-        lclptr->timecnt = 0;
-        lclptr->typecnt = 0;
-        lclptr->ttis[0].tt_isdst = 0;
-        lclptr->ttis[0].tt_gmtoff = 0;
-        lclptr->ttis[0].tt_abbrind = 0;
-        (void) strcpy(lclptr->chars, gmt);
-    } else if (tzload(name, lclptr, TRUE) != 0)
-        if (name[0] == ':' || tzparse(name, lclptr, FALSE) != 0)
-            (void) gmtload(lclptr);
-    settzname();
+    __bionic_set_local_tz_locked(__bionic_tz_pin_locked(name), key, env, pi, serial);
+}
+
+/*
+** android-added: returns the local zone, which is never freed, without taking
+** the lock unless TZ or the property has changed since it was published.
+*/
+static struct bionic_tz *
+lcl_tz_get(void)
+{
+    const char *        env = getenv("TZ");
+    struct bionic_tz *  tz;
+    unsigned            seq;
+    int                 valid;
+
+    seq = lcl_seq;
+    __sync_synchronize();
+    tz = lcl_tz;
+    if ((seq & 1) != 0 || tz == NULL)
+        valid = FALSE;
+    else if (env != NULL)
+        valid = (lcl_key == LCL_KEY_ENV && strcmp(env, lcl_TZname) == 0);
+    else if (lcl_key != LCL_KEY_PROPERTY)
+        valid = FALSE;
+    else if (lcl_prop != NULL)
+        valid = (__system_property_serial(lcl_prop) == lcl_prop_serial);
+    else
+        valid = (__system_property_find("persist.sys.timezone") == NULL);
+    __sync_synchronize();
+    if (valid && lcl_seq == seq)
+        return tz;
+
+    _tzLock();
+    tzset_locked();
+    tz = lcl_tz;
+    _tzUnlock();
+    return tz;
 }
 
 void
@@ -1278,8 +1422,9 @@ localsub(const time_t * const timep, const int_fast32_t offset,
     const time_t            t = *timep;
 
     // BEGIN android-changed: support user-supplied sp.
+    const struct bionic_tz * const lcl = lcl_tz;
     if (sp == NULL) {
-        sp = lclptr;
+        sp = &lcl->state;
     }
     // END android-changed
 #ifdef ALL_STATE
@@ -1349,7 +1494,9 @@ localsub(const time_t * const timep, const int_fast32_t offset,
     */
     result = timesub(&t, ttisp->tt_gmtoff, sp, tmp);
     tmp->tm_isdst = ttisp->tt_isdst;
-    tzname[tmp->tm_isdst] = &sp->chars[ttisp->tt_abbrind];
+    // android-changed: only the local zone is guaranteed to outlive us.
+    if (lcl != NULL && sp == &lcl->state)
+        tzname[tmp->tm_isdst] = (char *) &sp->chars[ttisp->tt_abbrind];
 #ifdef TM_ZONE
     tmp->TM_ZONE = &sp->chars[ttisp->tt_abbrind];
 #endif /* defined TM_ZONE */
@@ -1366,17 +1513,120 @@ localtime(const time_t * const timep)
 ** Re-entrant version of localtime.
 */
 
+// BEGIN android-added
+// Each thread remembers the last broken-down time localtime_r worked out, and
+// the range of times around it that fall on the same local day with the same
+// UTC offset. Timestamps that are close together (log lines, say) usually
+// land in that range, and then only the time of day needs recomputing.
+struct lcl_tm_cache {
+    const struct state *    sp;         /* NULL, or a zone that's never freed */
+    time_t                  first;      /* the range, inclusive */
+    time_t                  last;
+    time_t                  day_start;  /* the time at local midnight */
+    const char *            zone;       /* the abbreviation for tzname */
+    struct tm               tm;
+};
+
+GLOBAL_INIT_THREAD_LOCAL_BUFFER(lcl_tm_cache);
+
+static struct lcl_tm_cache *
+lcl_tm_cache_get(void)
+{
+    struct lcl_tm_cache *   c;
+
+    c = pthread_getspecific(__bionic_tls_lcl_tm_cache_key);
+    if (c == NULL) {
+        c = calloc(1, sizeof *c);
+        if (c != NULL && pthread_setspecific(__bionic_tls_lcl_tm_cache_key, c) != 0) {
+            free(c);
+            c = NULL;
+        }
+    }
+    return c;
+}
+
+/*
+** Sets *firstp and *lastp to the range of times around 't' between the same
+** two transitions in 'sp', and returns the local time type that applies, or
+** returns -1 if localsub doesn't simply look 't' up (leap seconds, or times
+** outside the table that are mapped into it).
+*/
+static int
+lcl_type_range(const struct state * const sp, const time_t t,
+               time_t * const firstp, time_t * const lastp)
+{
+    int lo;
+    int hi;
+
+    if (sp->leapcnt != 0)
+        return -1;
+    if ((sp->goback && t < sp->ats[0]) ||
+        (sp->goahead && t > sp->ats[sp->timecnt - 1]))
+            return -1;
+    if (sp->timecnt == 0) {
+        *firstp = time_t_min;
+        *lastp = time_t_max;
+        return sp->defaulttype;
+    }
+    if (t < sp->ats[0]) {
+        *firstp = time_t_min;
+        *lastp = sp->ats[0] - 1;
+        return sp->defaulttype;
+    }
+    lo = 1;
+    hi = sp->timecnt;
+    while (lo < hi) {
+        const int   mid = (lo + hi) >> 1;
+
+        if (t < sp->ats[mid])
+            hi = mid;
+        else    lo = mid + 1;
+    }
+    *firstp = sp->ats[lo - 1];
+    *lastp = (lo < sp->timecnt) ? sp->ats[lo] - 1 : time_t_max;
+    return sp->types[lo - 1];
+}
+// END android-added
+
 struct tm *
 localtime_r(const time_t * const timep, struct tm * tmp)
 {
-    struct tm*  result;
-
-    _tzLock();
-    tzset_locked();
-    result = localsub(timep, 0L, tmp, NULL); // android-changed: extra parameter.
-    _tzUnlock();
+    // BEGIN android-changed: lock-free, with an explicit state and a cache.
+    const struct state * const  sp = &lcl_tz_get()->state;
+    struct lcl_tm_cache * const c = lcl_tm_cache_get();
+    const time_t                t = *timep;
+    struct tm *                 result;
+    time_t                      first;
+    time_t                      last;
+    int                         i;
+    int                         secs;
+
+    if (c != NULL && c->sp == sp && t >= c->first && t <= c->last) {
+        secs = (int) (t - c->day_start);
+        *tmp = c->tm;
+        tmp->tm_hour = secs / SECSPERHOUR;
+        tmp->tm_min = secs / SECSPERMIN % MINSPERHOUR;
+        tmp->tm_sec = secs % SECSPERMIN;
+        tzname[tmp->tm_isdst] = (char *) c->zone;
+        return tmp;
+    }
 
+    result = localsub(timep, 0L, tmp, sp);
+    if (result == NULL || c == NULL || t < 0 || t > time_t_max - SECSPERDAY)
+        return result;
+    i = lcl_type_range(sp, t, &first, &last);
+    if (i < 0)
+        return result;
+    secs = tmp->tm_hour * SECSPERHOUR + tmp->tm_min * SECSPERMIN + tmp->tm_sec;
+    c->sp = sp;
+    c->day_start = t - secs;
+    c->first = (first > c->day_start) ? first : c->day_start;
+    c->last = (last < c->day_start + SECSPERDAY - 1) ?
+        last : c->day_start + SECSPERDAY - 1;
+    c->zone = &sp->chars[sp->ttis[i].tt_abbrind];
+    c->tm = *tmp;
     return result;
+    // END android-changed
 }
 
 /*
@@ -1979,11 +2229,8 @@ time1(struct tm * const tmp,
 time_t
 mktime(struct tm * const tmp)
 {
-    _tzLock();
-    tzset_locked();
-    time_t result = time1(tmp, localsub, 0L, NULL); // android-changed: extra parameter.
-    _tzUnlock();
-    return result;
+    // android-changed: lock-free, with an explicit state.
+    return time1(tmp, localsub, 0L, &lcl_tz_get()->state);
 }
 
 #ifdef STD_INSPIRED
@@ -2110,157 +2357,224 @@ posix2time(time_t t)
 #include <stdint.h>
 #include <arpa/inet.h> // For ntohl(3).
 
-static int to_int(unsigned char* s) {
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static int to_int(const unsigned char* s) {
   return (s[0] << 24) | (s[1] << 16) | (s[2] << 8) | s[3];
 }
 
-static int __bionic_open_tzdata_path(const char* path, const char* olson_id, int* data_size) {
-  int fd = TEMP_FAILURE_RETRY(open(path, OPEN_MODE));
-  if (fd == -1) {
-    XLOG(("%s: could not open \"%s\": %s\n", __FUNCTION__, path, strerror(errno)));
+// byte[12] tzdata_version  -- "tzdata2012f\0"
+// int index_offset
+// int data_offset
+// int zonetab_offset
+struct bionic_tzdata_header {
+  char tzdata_version[12];
+  int32_t index_offset;
+  int32_t data_offset;
+  int32_t zonetab_offset;
+};
+
+// The index is an array of these, sorted by name:
+// byte[40] name  -- NUL-padded, but not necessarily NUL-terminated
+// int start      -- relative to data_offset
+// int length
+// int raw_gmt_offset
+#define TZDATA_NAME_LENGTH 40
+#define TZDATA_INDEX_ENTRY_SIZE (TZDATA_NAME_LENGTH + 3 * sizeof(int32_t))
+
+// A tzdata file, mapped once and then kept for the life of the process unless
+// it's replaced on disk (as updates are, by renaming a new file into place).
+// Protected by _tzLock.
+struct bionic_tzdata_file {
+  const char* path;
+  const char* base; // NULL if not mapped.
+  size_t size;
+  dev_t dev;
+  ino_t ino;
+  time_t mtime;
+};
+
+// TODO: use $ANDROID_DATA and $ANDROID_ROOT like libcore, to support bionic on the host.
+static struct bionic_tzdata_file gTzdataFiles[] = {
+  { "/data/misc/zoneinfo/tzdata", NULL, 0, 0, 0, 0 },
+  { "/system/usr/share/zoneinfo/tzdata", NULL, 0, 0, 0, 0 },
+};
+
+static void __bionic_unmap_tzdata(struct bionic_tzdata_file* file) {
+  if (file->base != NULL) {
+    munmap((void*) file->base, file->size);
+    file->base = NULL;
+  }
+}
+
+// Returns 0 if 'file' is mapped and up to date, -2 if it doesn't exist,
+// and -1 if it's unusable.
+static int __bionic_map_tzdata(struct bionic_tzdata_file* file) {
+  struct stat sb;
+  if (TEMP_FAILURE_RETRY(stat(file->path, &sb)) == -1) {
+    XLOG(("%s: could not stat \"%s\": %s\n", __FUNCTION__, file->path, strerror(errno)));
+    __bionic_unmap_tzdata(file);
     return -2; // Distinguish failure to find any data from failure to find a specific id.
   }
+  if (file->base != NULL && sb.st_dev == file->dev && sb.st_ino == file->ino &&
+      (time_t) sb.st_mtime == file->mtime && (size_t) sb.st_size == file->size) {
+    return 0;
+  }
+  __bionic_unmap_tzdata(file);
 
-  // byte[12] tzdata_version  -- "tzdata2012f\0"
-  // int index_offset
-  // int data_offset
-  // int zonetab_offset
-  struct bionic_tzdata_header {
-    char tzdata_version[12];
-    int32_t index_offset;
-    int32_t data_offset;
-    int32_t zonetab_offset;
-  } header;
-  memset(&header, 0, sizeof(header));
-  ssize_t bytes_read = TEMP_FAILURE_RETRY(read(fd, &header, sizeof(header)));
-  if (bytes_read != sizeof(header)) {
-    fprintf(stderr, "%s: could not read header of \"%s\": %s\n",
-            __FUNCTION__, path, (bytes_read == -1) ? strerror(errno) : "short read");
+  int fd = TEMP_FAILURE_RETRY(open(file->path, OPEN_MODE));
+  if (fd == -1) {
+    XLOG(("%s: could not open \"%s\": %s\n", __FUNCTION__, file->path, strerror(errno)));
+    return -2;
+  }
+  // Take the identity of the file we actually opened, in case it just changed.
+  if (TEMP_FAILURE_RETRY(fstat(fd, &sb)) == -1) {
+    fprintf(stderr, "%s: could not stat \"%s\": %s\n", __FUNCTION__, file->path, strerror(errno));
     close(fd);
     return -1;
   }
-
-  if (strncmp(header.tzdata_version, "tzdata", 6) != 0 || header.tzdata_version[11] != 0) {
-    fprintf(stderr, "%s: bad magic in \"%s\": \"%.6s\"\n",
-            __FUNCTION__, path, header.tzdata_version);
+  if ((size_t) sb.st_size < sizeof(struct bionic_tzdata_header)) {
+    fprintf(stderr, "%s: could not read header of \"%s\": short read\n", __FUNCTION__, file->path);
     close(fd);
     return -1;
   }
-
-#if 0
-  fprintf(stderr, "version: %s\n", header.tzdata_version);
-  fprintf(stderr, "index_offset = %d\n", ntohl(header.index_offset));
-  fprintf(stderr, "data_offset = %d\n", ntohl(header.data_offset));
-  fprintf(stderr, "zonetab_offset = %d\n", ntohl(header.zonetab_offset));
-#endif
-
-  if (TEMP_FAILURE_RETRY(lseek(fd, ntohl(header.index_offset), SEEK_SET)) == -1) {
-    fprintf(stderr, "%s: couldn't seek to index in \"%s\": %s\n",
-            __FUNCTION__, path, strerror(errno));
-    close(fd);
+  void* base = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "%s: could not map \"%s\": %s\n", __FUNCTION__, file->path, strerror(errno));
     return -1;
   }
 
-  off_t specific_zone_offset = -1;
+  const struct bionic_tzdata_header* header = (const struct bionic_tzdata_header*) base;
+  if (strncmp(header->tzdata_version, "tzdata", 6) != 0 || header->tzdata_version[11] != 0) {
+    fprintf(stderr, "%s: bad magic in \"%s\": \"%.6s\"\n",
+            __FUNCTION__, file->path, header->tzdata_version);
+    munmap(base, sb.st_size);
+    return -1;
+  }
+  uint32_t index_offset = ntohl(header->index_offset);
+  uint32_t data_offset = ntohl(header->data_offset);
+  if (index_offset < sizeof(*header) || index_offset > data_offset ||
+      data_offset > (size_t) sb.st_size) {
+    fprintf(stderr, "%s: bad index in \"%s\"\n", __FUNCTION__, file->path);
+    munmap(base, sb.st_size);
+    return -1;
+  }
 
-  static const size_t NAME_LENGTH = 40;
-  unsigned char buf[NAME_LENGTH + 3 * sizeof(int32_t)];
+#if 0
+  fprintf(stderr, "version: %s\n", header->tzdata_version);
+  fprintf(stderr, "index_offset = %d\n", index_offset);
+  fprintf(stderr, "data_offset = %d\n", data_offset);
+  fprintf(stderr, "zonetab_offset = %d\n", ntohl(header->zonetab_offset));
+#endif
 
-  size_t id_count = (ntohl(header.data_offset) - ntohl(header.index_offset)) / sizeof(buf);
-  for (size_t i = 0; i < id_count; ++i) {
-    if (TEMP_FAILURE_RETRY(read(fd, buf, sizeof(buf))) != (ssize_t) sizeof(buf)) {
-      break;
-    }
+  file->base = (const char*) base;
+  file->size = sb.st_size;
+  file->dev = sb.st_dev;
+  file->ino = sb.st_ino;
+  file->mtime = sb.st_mtime;
+  return 0;
+}
 
-    char this_id[NAME_LENGTH + 1];
-    memcpy(this_id, buf, NAME_LENGTH);
-    this_id[NAME_LENGTH] = '\0';
+static int __bionic_find_tzdata_in(struct bionic_tzdata_file* file, const char* olson_id,
+                                   const char** data, int* data_size) {
+  int rc = __bionic_map_tzdata(file);
+  if (rc != 0) {
+    return rc;
+  }
 
-    if (strcmp(this_id, olson_id) == 0) {
-      specific_zone_offset = to_int(buf + NAME_LENGTH) + ntohl(header.data_offset);
-      *data_size = to_int(buf + NAME_LENGTH + sizeof(int32_t));
-      break;
+  const struct bionic_tzdata_header* header = (const struct bionic_tzdata_header*) file->base;
+  uint32_t index_offset = ntohl(header->index_offset);
+  uint32_t data_offset = ntohl(header->data_offset);
+  const unsigned char* index = (const unsigned char*) file->base + index_offset;
+  size_t id_count = (data_offset - index_offset) / TZDATA_INDEX_ENTRY_SIZE;
+
+  // Binary search the index in place. A longer id can't be in it.
+  const unsigned char* entry = NULL;
+  if (strlen(olson_id) <= TZDATA_NAME_LENGTH) {
+    size_t lo = 0;
+    size_t hi = id_count;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      const unsigned char* this_entry = index + mid * TZDATA_INDEX_ENTRY_SIZE;
+      int cmp = strncmp(olson_id, (const char*) this_entry, TZDATA_NAME_LENGTH);
+      if (cmp == 0) {
+        entry = this_entry;
+        break;
+      } else if (cmp < 0) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
     }
   }
 
-  if (specific_zone_offset == -1) {
+  if (entry == NULL) {
     XLOG(("%s: couldn't find zone \"%s\"\n", __FUNCTION__, olson_id));
-    close(fd);
     return -1;
   }
 
-  if (TEMP_FAILURE_RETRY(lseek(fd, specific_zone_offset, SEEK_SET)) == -1) {
-    fprintf(stderr, "%s: could not seek to %ld in \"%s\": %s\n",
-            __FUNCTION__, specific_zone_offset, path, strerror(errno));
-    close(fd);
+  uint32_t specific_zone_offset = data_offset + (uint32_t) to_int(entry + TZDATA_NAME_LENGTH);
+  int length = to_int(entry + TZDATA_NAME_LENGTH + sizeof(int32_t));
+  if (specific_zone_offset < data_offset || length <= 0 ||
+      specific_zone_offset > file->size || (size_t) length > file->size - specific_zone_offset) {
+    fprintf(stderr, "%s: bad index entry for \"%s\" in \"%s\"\n",
+            __FUNCTION__, olson_id, file->path);
     return -1;
   }
 
   // TODO: check that there's TZ_MAGIC at this offset, so we can fall back to the other file if not.
 
-  return fd;
+  *data = file->base + specific_zone_offset;
+  *data_size = length;
+  return 0;
 }
 
-static int __bionic_open_tzdata(const char* olson_id, int* data_size) {
-  // TODO: use $ANDROID_DATA and $ANDROID_ROOT like libcore, to support bionic on the host.
-  int fd = __bionic_open_tzdata_path("/data/misc/zoneinfo/tzdata", olson_id, data_size);
-  if (fd < 0) {
-    fd = __bionic_open_tzdata_path("/system/usr/share/zoneinfo/tzdata", olson_id, data_size);
-    if (fd == -2) {
+// Finds the zone data for 'olson_id', which stays valid while _tzLock is held.
+static int __bionic_find_tzdata(const char* olson_id, const char** data, int* data_size) {
+  int rc = __bionic_find_tzdata_in(&gTzdataFiles[0], olson_id, data, data_size);
+  if (rc < 0) {
+    rc = __bionic_find_tzdata_in(&gTzdataFiles[1], olson_id, data, data_size);
+    if (rc == -2) {
       // The first thing that 'recovery' does is try to format the current time. It doesn't have
       // any tzdata available, so we must not abort here --- doing so breaks the recovery image!
       fprintf(stderr, "%s: couldn't find any tzdata when looking for %s!\n", __FUNCTION__, olson_id);
     }
   }
-  return fd;
+  return rc;
 }
 
-// Caches the most recent timezone (http://b/8270865).
-static int __bionic_tzload_cached(const char* name, struct state* const sp, const int doextend) {
+// Returns a reference to the named zone from the cache (http://b/8270865).
+static struct bionic_tz* __bionic_tz_acquire(const char* name) {
   _tzLock();
-
-  // Our single-item cache.
-  static char* gCachedTimeZoneName;
-  static struct state gCachedTimeZone;
-
-  // Do we already have this timezone cached?
-  if (gCachedTimeZoneName != NULL && strcmp(name, gCachedTimeZoneName) == 0) {
-    *sp = gCachedTimeZone;
-    _tzUnlock();
-    return 0;
-  }
-
-  // Can we load it?
-  int rc = tzload(name, sp, doextend);
-  if (rc == 0) {
-    // Update the cache.
-    free(gCachedTimeZoneName);
-    gCachedTimeZoneName = strdup(name);
-    gCachedTimeZone = *sp;
-  }
-
+  struct bionic_tz* tz = __bionic_tz_get_locked(name);
   _tzUnlock();
-  return rc;
+  return tz;
 }
 
 // Non-standard API: mktime(3) but with an explicit timezone parameter.
 time_t mktime_tz(struct tm* const tmp, const char* tz) {
-  struct state st;
-  if (__bionic_tzload_cached(tz, &st, TRUE) != 0) {
-    // TODO: not sure what's best here, but for now, we fall back to gmt.
-    gmtload(&st);
+  // Zones we can't find fall back to gmt.
+  struct bionic_tz* zone = __bionic_tz_acquire(tz);
+  if (zone == NULL) {
+    errno = ENOMEM;
+    return WRONG;
   }
-  return time1(tmp, localsub, 0L, &st);
+  time_t result = time1(tmp, localsub, 0L, &zone->state);
+  __bionic_tz_release(zone);
+  return result;
 }
 
 // Non-standard API: localtime(3) but with an explicit timezone parameter.
 void localtime_tz(const time_t* const timep, struct tm* tmp, const char* tz) {
-  struct state st;
-  if (__bionic_tzload_cached(tz, &st, TRUE) != 0) {
-    // TODO: not sure what's best here, but for now, we fall back to gmt.
-    gmtload(&st);
+  // Zones we can't find fall back to gmt.
+  struct bionic_tz* zone = __bionic_tz_acquire(tz);
+  if (zone == NULL) {
+    return;
   }
-  localsub(timep, 0L, tmp, &st);
+  localsub(timep, 0L, tmp, &zone->state);
+  __bionic_tz_release(zone);
 }
 
 // END android-added
@@ -115,6 +115,8 @@ static char *   _add(const char *, char *, const char *, int);
 static char *   _conv(int, const char *, char *, const char *);
 static char *   _fmt(const char *, const struct tm *, char *, const char *,
             int *, const struct strftime_locale*);
+static char *   _fmt_numeric(const char *, const struct tm *, char *,
+            const char *);
 static char *   _yconv(int, int, int, int, char *, const char *, int);
 static char *   getformat(int, char *, char *, char *, char *);
 
@@ -152,6 +154,19 @@ const struct strftime_locale *locale;
     char *  p;
     int warn;
 
+    /* BEGIN android-added: log timestamps are nearly always all-numeric
+    ** ISO 8601 or RFC 3339, which don't need the locale or tzname.
+    */
+    if (format != NULL) {
+        p = _fmt_numeric(format, t, s, s + maxsize);
+        if (p != NULL) {
+            if (p == s + maxsize)
+                return 0;
+            *p = '\0';
+            return p - s;
+        }
+    }
+    /* END android-added */
     tzset();
     warn = IN_NONE;
     p = _fmt(((format == NULL) ? "%c" : format), t, s, s + maxsize, &warn, locale);
@@ -667,6 +682,117 @@ label:
     return pt;
 }
 
+/*
+** android-added: the fast path for formats made only of literal characters
+** and the conversions %Y %m %d %H %M %S %F %T %z and %%, without modifiers.
+** Writes the same as _fmt would, without going through snprintf, or returns
+** NULL (having maybe written some of 'pt') if 'format' or 't' is anything else.
+*/
+
+#define PUT2(n) do { \
+        if (ptlim - pt < 2) \
+            return (char *) ptlim; \
+        *pt++ = '0' + (n) / 10; \
+        *pt++ = '0' + (n) % 10; \
+    } while (0)
+
+static char *
+_fmt_numeric(const char * format, const struct tm * const t, char * pt,
+             const char * const ptlim)
+{
+    const char *    sub = NULL;  /* the rest of a %F or %T expansion */
+    int             c;
+    int             conv;
+
+    if (t->tm_year < -TM_YEAR_BASE || t->tm_year > 9999 - TM_YEAR_BASE ||
+        t->tm_mon < 0 || t->tm_mon >= MONSPERYEAR ||
+        t->tm_mday < 0 || t->tm_mday > 99 ||
+        t->tm_hour < 0 || t->tm_hour > 99 ||
+        t->tm_min < 0 || t->tm_min > 99 ||
+        t->tm_sec < 0 || t->tm_sec > 99)
+            return NULL;
+    for (;;) {
+        if (sub != NULL && *sub == '\0')
+            sub = NULL;
+        if (sub != NULL) {
+            /* Inside %F and %T, letters are conversions. */
+            c = *sub++;
+            conv = (c != '-' && c != ':');
+        } else if (*format == '\0') {
+            return pt;
+        } else if (*format != '%') {
+            c = *format++;
+            conv = FALSE;
+        } else {
+            c = format[1];
+            if (c == '\0')
+                return NULL;
+            format += 2;
+            if (c == 'F') {
+                sub = "Y-m-d";
+                continue;
+            }
+            if (c == 'T') {
+                sub = "H:M:S";
+                continue;
+            }
+            conv = (c != '%');
+        }
+        if (!conv) {
+            if (pt == ptlim)
+                return pt;
+            *pt++ = c;
+            continue;
+        }
+        switch (c) {
+        case 'Y':
+            PUT2((t->tm_year + TM_YEAR_BASE) / 100);
+            PUT2((t->tm_year + TM_YEAR_BASE) % 100);
+            break;
+        case 'm':
+            PUT2(t->tm_mon + 1);
+            break;
+        case 'd':
+            PUT2(t->tm_mday);
+            break;
+        case 'H':
+            PUT2(t->tm_hour);
+            break;
+        case 'M':
+            PUT2(t->tm_min);
+            break;
+        case 'S':
+            PUT2(t->tm_sec);
+            break;
+#ifdef TM_GMTOFF
+        case 'z':
+            {
+            long    diff = t->TM_GMTOFF;
+
+            if (t->tm_isdst < 0)
+                break;
+            if (pt == ptlim)
+                return pt;
+            if (diff < 0) {
+                *pt++ = '-';
+                diff = -diff;
+            } else  *pt++ = '+';
+            diff /= SECSPERMIN;
+            if (diff / MINSPERHOUR > 99)
+                return NULL;
+            PUT2(diff / MINSPERHOUR);
+            PUT2(diff % MINSPERHOUR);
+            }
+            break;
+#endif /* defined TM_GMTOFF */
+        default:
+            return NULL;
+        }
+    }
+}
+
+#undef PUT2
+
 static char *
 _conv(n, format, pt, ptlim)
 const int       n;
@@ -2619,6 +2619,11 @@ struct malloc_params {
   size_t mmap_threshold;
   size_t trim_threshold;
   flag_t default_mflags;
+  /* BEGIN android-added: dynamic mmap threshold */
+#ifdef DYNAMIC_MMAP_THRESHOLD_MAX
+  int    user_thresholds; /* mallopt set a threshold; leave them alone */
+#endif /* DYNAMIC_MMAP_THRESHOLD_MAX */
+  /* END android-added */
 };
 
 static struct malloc_params mparams;
@@ -3210,6 +3215,11 @@ static int change_mparam(int param_number, int value) {
   switch(param_number) {
   case M_TRIM_THRESHOLD:
     mparams.trim_threshold = val;
+    /* BEGIN android-added: dynamic mmap threshold */
+#ifdef DYNAMIC_MMAP_THRESHOLD_MAX
+    mparams.user_thresholds = 1;
+#endif /* DYNAMIC_MMAP_THRESHOLD_MAX */
+    /* END android-added */
     return 1;
   case M_GRANULARITY:
     if (val >= mparams.page_size && ((val & (val-1)) == 0)) {
@@ -3220,12 +3230,59 @@ static int change_mparam(int param_number, int value) {
       return 0;
   case M_MMAP_THRESHOLD:
     mparams.mmap_threshold = val;
+    /* BEGIN android-added: dynamic mmap threshold */
+#ifdef DYNAMIC_MMAP_THRESHOLD_MAX
+    mparams.user_thresholds = 1;
+#endif /* DYNAMIC_MMAP_THRESHOLD_MAX */
+    /* END android-added */
     return 1;
   default:
     return 0;
   }
 }
 
+/* BEGIN android-added: dynamic mmap threshold */
+#ifdef DYNAMIC_MMAP_THRESHOLD_MAX
+/*
+  When a chunk that was mmapped because of its size is freed, raise the
+  mmap threshold to that size (up to DYNAMIC_MMAP_THRESHOLD_MAX), so that
+  a program repeatedly allocating and freeing blocks of that size gets
+  them from the heap rather than paying for mmap and munmap each time.
+  The trim threshold is raised with it so the heap doesn't immediately
+  give the memory back. As in glibc, once mallopt has set either threshold
+  both are left as the program asked. Called with the malloc lock held.
+*/
+static void adjust_mmap_threshold(size_t freed_size) {
+  if (!mparams.user_thresholds &&
+      freed_size > mparams.mmap_threshold &&
+      freed_size <= DYNAMIC_MMAP_THRESHOLD_MAX) {
+    mparams.mmap_threshold = freed_size;
+    if (mparams.trim_threshold < 2 * freed_size)
+      mparams.trim_threshold = 2 * freed_size;
+  }
+}
+#endif /* DYNAMIC_MMAP_THRESHOLD_MAX */
+/* END android-added */
+
+/* BEGIN android-added: allocation statistics */
+/*
+  ACCOUNT_ALLOC and ACCOUNT_FREE are called with the malloc lock held as
+  in-use chunks are handed out and taken back, so that the includer can
+  keep statistics without any synchronization of its own. ACCOUNT_UNALLOC
+  takes back an ACCOUNT_ALLOC for a chunk that memalign or ialloc is about
+  to carve into the chunks it really hands out, which are counted instead.
+*/
+#ifndef ACCOUNT_ALLOC
+#define ACCOUNT_ALLOC(M, P)
+#endif
+#ifndef ACCOUNT_FREE
+#define ACCOUNT_FREE(M, P)
+#endif
+#ifndef ACCOUNT_UNALLOC
+#define ACCOUNT_UNALLOC(M, P)
+#endif
+/* END android-added */
+
 #if DEBUG
 /* ------------------------- Debugging Support --------------------------- */
 
@@ -4692,6 +4749,10 @@ void* dlmalloc(size_t bytes) {
     mem = sys_alloc(gm, nb);
 
   postaction:
+    /* BEGIN android-added: allocation statistics */
+    if (mem != 0)
+      ACCOUNT_ALLOC(gm, mem2chunk(mem));
+    /* END android-added */
     POSTACTION(gm);
     return mem;
   }
@@ -4724,9 +4785,17 @@ void dlfree(void* mem) {
       if (RTCHECK(ok_address(fm, p) && ok_inuse(p))) {
         size_t psize = chunksize(p);
         mchunkptr next = chunk_plus_offset(p, psize);
+        /* BEGIN android-added: allocation statistics */
+        ACCOUNT_FREE(fm, p);
+        /* END android-added */
         if (!pinuse(p)) {
           size_t prevsize = p->prev_foot;
           if (is_mmapped(p)) {
+            /* BEGIN android-added: dynamic mmap threshold */
+#ifdef DYNAMIC_MMAP_THRESHOLD_MAX
+            adjust_mmap_threshold(psize);
+#endif
+            /* END android-added */
             psize += prevsize + MMAP_FOOT_PAD;
             if (CALL_MUNMAP((char*)p - prevsize, psize) == 0)
               fm->footprint -= psize;
@@ -4837,6 +4906,9 @@ static mchunkptr try_realloc_chunk(mstate m, mchunkptr p, size_t nb,
   mchunkptr next = chunk_plus_offset(p, oldsize);
   if (RTCHECK(ok_address(m, p) && ok_inuse(p) &&
               ok_next(p, next) && ok_pinuse(next))) {
+    /* BEGIN android-added: allocation statistics */
+    ACCOUNT_FREE(m, p);
+    /* END android-added */
     if (is_mmapped(p)) {
       newp = mmap_resize(m, p, nb, can_move);
     }
@@ -4902,6 +4974,9 @@ static mchunkptr try_realloc_chunk(mstate m, mchunkptr p, size_t nb,
         newp = p;
       }
     }
+    /* BEGIN android-added: allocation statistics */
+    ACCOUNT_ALLOC(m, (newp != 0)? newp : p);
+    /* END android-added */
   }
   else {
     USAGE_ERROR_ACTION(m, chunk2mem(p));
@@ -4931,6 +5006,9 @@ static void* internal_memalign(mstate m, size_t alignment, size_t bytes) {
       mchunkptr p = mem2chunk(mem);
       if (PREACTION(m))
         return 0;
+      /* BEGIN android-added: allocation statistics */
+      ACCOUNT_UNALLOC(m, p);
+      /* END android-added */
       if ((((size_t)(mem)) & (alignment - 1)) != 0) { /* misaligned */
         /*
           Find an aligned spot inside chunk.  Since we need to give
@@ -4977,6 +5055,9 @@ static void* internal_memalign(mstate m, size_t alignment, size_t bytes) {
       assert (chunksize(p) >= nb);
       assert(((size_t)mem & (alignment - 1)) == 0);
       check_inuse_chunk(m, p);
+      /* BEGIN android-added: allocation statistics */
+      ACCOUNT_ALLOC(m, p);
+      /* END android-added */
       POSTACTION(m);
     }
   }
@@ -5054,6 +5135,9 @@ static void** ialloc(mstate m,
   if (PREACTION(m)) return 0;
   p = mem2chunk(mem);
   remainder_size = chunksize(p);
+  /* BEGIN android-added: allocation statistics */
+  ACCOUNT_UNALLOC(m, p);
+  /* END android-added */
 
   assert(!is_mmapped(p));
 
@@ -5068,6 +5152,9 @@ static void** ialloc(mstate m,
     array_chunk_size = remainder_size - contents_size;
     marray = (void**) (chunk2mem(array_chunk));
     set_size_and_pinuse_of_inuse_chunk(m, array_chunk, array_chunk_size);
+    /* BEGIN android-added: allocation statistics */
+    ACCOUNT_ALLOC(m, array_chunk);
+    /* END android-added */
     remainder_size = contents_size;
   }
 
@@ -5081,10 +5168,16 @@ static void** ialloc(mstate m,
         size = request2size(sizes[i]);
       remainder_size -= size;
       set_size_and_pinuse_of_inuse_chunk(m, p, size);
+      /* BEGIN android-added: allocation statistics */
+      ACCOUNT_ALLOC(m, p);
+      /* END android-added */
       p = chunk_plus_offset(p, size);
     }
     else { /* the final element absorbs any overallocation slop */
       set_size_and_pinuse_of_inuse_chunk(m, p, remainder_size);
+      /* BEGIN android-added: allocation statistics */
+      ACCOUNT_ALLOC(m, p);
+      /* END android-added */
       break;
     }
   }
@@ -5121,6 +5214,9 @@ static size_t internal_bulk_free(mstate m, void* array[], size_t nelem) {
   if (!PREACTION(m)) {
     void** a;
     void** fence = &(array[nelem]);
+    /* BEGIN android-added: allocation statistics */
+    mchunkptr merged = 0; /* already taken back as its separate pieces */
+    /* END android-added */
     for (a = array; a != fence; ++a) {
       void* mem = *a;
       if (mem != 0) {
@@ -5137,8 +5233,16 @@ static size_t internal_bulk_free(mstate m, void* array[], size_t nelem) {
         if (RTCHECK(ok_address(m, p) && ok_inuse(p))) {
           void ** b = a + 1; /* try to merge with next chunk */
           mchunkptr next = next_chunk(p);
+          /* BEGIN android-added: allocation statistics */
+          if (p != merged)
+            ACCOUNT_FREE(m, p);
+          /* END android-added */
           if (b != fence && *b == chunk2mem(next)) {
             size_t newsize = chunksize(next) + psize;
+            /* BEGIN android-added: allocation statistics */
+            ACCOUNT_FREE(m, next);
+            merged = p;
+            /* END android-added */
             set_inuse(m, p, newsize);
             *b = chunk2mem(p);
           }
@@ -30,10 +30,15 @@ benchmark_c_flags = \
 
 benchmark_src_files = \
     benchmark_main.cpp \
+    file_benchmark.cpp \
+    malloc_benchmark.cpp \
     math_benchmark.cpp \
     property_benchmark.cpp \
+    pthread_benchmark.cpp \
+    socket_benchmark.cpp \
     string_benchmark.cpp \
     time_benchmark.cpp \
+    unistd_benchmark.cpp \
 
 # Build benchmarks for the device (with bionic's .so). Run with:
 #   adb shell bionic-benchmarks
@@ -42,7 +47,7 @@ LOCAL_MODULE := bionic-benchmarks
 LOCAL_ADDITIONAL_DEPENDENCIES := $(LOCAL_PATH)/Android.mk
 LOCAL_CFLAGS += $(benchmark_c_flags)
 LOCAL_C_INCLUDES += external/stlport/stlport bionic/ bionic/libstdc++/include
-LOCAL_SHARED_LIBRARIES += libstlport
+LOCAL_SHARED_LIBRARIES += libstlport libdl
 LOCAL_SRC_FILES := $(benchmark_src_files)
 include $(BUILD_EXECUTABLE)
 
@@ -60,6 +65,7 @@ test_c_flags = \
 test_src_files = \
     dirent_test.cpp \
     eventfd_test.cpp \
+    fcntl_test.cpp \
     fenv_test.cpp \
     getauxval_test.cpp \
     getcwd_test.cpp \
@@ -71,6 +77,7 @@ test_src_files = \
     netdb_test.cpp \
     pthread_test.cpp \
     regex_test.cpp \
+    res_send_test.cpp \
     signal_test.cpp \
     stack_protector_test.cpp \
     stack_unwinding_test.cpp \
@@ -80,7 +87,12 @@ test_src_files = \
     string_test.cpp \
     strings_test.cpp \
     stubs_test.cpp \
+    sys_epoll_test.cpp \
+    sys_sendfile_test.cpp \
+    sys_socket_test.cpp \
     sys_stat_test.cpp \
+    sys_sysinfo_test.cpp \
+    sys_uio_test.cpp \
     system_properties_test.cpp \
     time_test.cpp \
     unistd_test.cpp \
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+TEST(fcntl, splice_file_to_pipe) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int fd = fileno(fp);
+  ASSERT_EQ(10, write(fd, "0123456789", 10));
+
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  // With an explicit offset, the file's own offset isn't used or changed.
+  loff_t offset = 3;
+  ASSERT_EQ(4, splice(fd, &offset, pipe_fds[1], NULL, 4, 0)) << strerror(errno);
+  ASSERT_EQ(7, offset);
+  ASSERT_EQ(10, lseek(fd, 0, SEEK_CUR));
+
+  char buf[16];
+  ASSERT_EQ(4, read(pipe_fds[0], buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "3456", 4));
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  fclose(fp);
+}
+
+TEST(fcntl, vmsplice_tee) {
+  int in_fds[2];
+  ASSERT_EQ(0, pipe(in_fds));
+  int out_fds[2];
+  ASSERT_EQ(0, pipe(out_fds));
+
+  iovec iov[2];
+  iov[0].iov_base = const_cast<char*>("hello, ");
+  iov[0].iov_len = 7;
+  iov[1].iov_base = const_cast<char*>("world");
+  iov[1].iov_len = 5;
+  ASSERT_EQ(12, vmsplice(in_fds[1], iov, 2, 0)) << strerror(errno);
+
+  // tee copies without consuming, so the data is still there to read.
+  ASSERT_EQ(12, tee(in_fds[0], out_fds[1], 12, SPLICE_F_NONBLOCK)) << strerror(errno);
+
+  char buf[16];
+  ASSERT_EQ(12, read(out_fds[0], buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "hello, world", 12));
+  ASSERT_EQ(12, read(in_fds[0], buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "hello, world", 12));
+
+  // Both pipes are now empty.
+  ASSERT_EQ(-1, tee(in_fds[0], out_fds[1], 12, SPLICE_F_NONBLOCK));
+  ASSERT_EQ(EAGAIN, errno);
+
+  close(in_fds[0]);
+  close(in_fds[1]);
+  close(out_fds[0]);
+  close(out_fds[1]);
+}
+
+TEST(fcntl, fallocate) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int fd = fileno(fp);
+
+  // Not every file system supports fallocate.
+  int rc = fallocate(fd, 0, 0, 4096);
+  if (rc == -1 && errno == EOPNOTSUPP) {
+    fclose(fp);
+    return;
+  }
+  ASSERT_EQ(0, rc) << strerror(errno);
+
+  struct stat sb;
+  ASSERT_EQ(0, fstat(fd, &sb));
+  ASSERT_EQ(4096, sb.st_size);
+
+  // With FALLOC_FL_KEEP_SIZE, the space is allocated but the size is unchanged.
+  ASSERT_EQ(0, fallocate64(fd, FALLOC_FL_KEEP_SIZE, 4096, 8192)) << strerror(errno);
+  ASSERT_EQ(0, fstat(fd, &sb));
+  ASSERT_EQ(4096, sb.st_size);
+
+  fclose(fp);
+}
+
+TEST(fcntl, posix_fadvise) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int fd = fileno(fp);
+
+  ASSERT_EQ(0, posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL));
+  ASSERT_EQ(0, posix_fadvise64(fd, 0, 4096, POSIX_FADV_DONTNEED));
+
+  // Errors are returned rather than put in errno.
+  errno = 0;
+  ASSERT_EQ(EINVAL, posix_fadvise(fd, 0, 0, -1));
+  ASSERT_EQ(0, errno);
+  ASSERT_EQ(EBADF, posix_fadvise64(-1, 0, 0, POSIX_FADV_NORMAL));
+  ASSERT_EQ(0, errno);
+
+  fclose(fp);
+}
+
+TEST(fcntl, sync_file_range) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int fd = fileno(fp);
+  ASSERT_EQ(4, write(fd, "data", 4));
+
+  ASSERT_EQ(0, sync_file_range(fd, 0, 0, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER)) << strerror(errno);
+
+  // An unknown flag is rejected.
+  ASSERT_EQ(-1, sync_file_range(fd, 0, 0, ~0U));
+  ASSERT_EQ(EINVAL, errno);
+
+  fclose(fp);
+}
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define KB 1024
+
+#define AT_CHUNK_SIZES Arg(512)->Arg(4*KB)->Arg(64*KB)
+
+// The vectored benchmarks move CHUNK_COUNT chunks per iteration, either with
+// one pread or pwrite per chunk or with one preadv or pwritev for all of them.
+#define CHUNK_COUNT 8
+
+static char gChunks[CHUNK_COUNT][64*KB];
+
+static int MakeTempFile(size_t size) {
+  FILE* fp = tmpfile();
+  int fd = dup(fileno(fp));
+  fclose(fp);
+  for (size_t i = 0; i < size; i += sizeof(gChunks[0])) {
+    write(fd, gChunks[0], sizeof(gChunks[0]));
+  }
+  return fd;
+}
+
+static void MakeIovecs(iovec* ios, int chunk_size) {
+  for (int i = 0; i < CHUNK_COUNT; ++i) {
+    ios[i].iov_base = gChunks[i];
+    ios[i].iov_len = chunk_size;
+  }
+}
+
+static void BM_file_pread_loop(int iters, int chunk_size) {
+  StopBenchmarkTiming();
+  int fd = MakeTempFile(CHUNK_COUNT * chunk_size);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    for (int j = 0; j < CHUNK_COUNT; ++j) {
+      pread(fd, gChunks[j], chunk_size, j * chunk_size);
+    }
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * CHUNK_COUNT * chunk_size);
+  close(fd);
+}
+BENCHMARK(BM_file_pread_loop)->AT_CHUNK_SIZES;
+
+static void BM_file_preadv(int iters, int chunk_size) {
+  StopBenchmarkTiming();
+  int fd = MakeTempFile(CHUNK_COUNT * chunk_size);
+  iovec ios[CHUNK_COUNT];
+  MakeIovecs(ios, chunk_size);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    preadv(fd, ios, CHUNK_COUNT, 0);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * CHUNK_COUNT * chunk_size);
+  close(fd);
+}
+BENCHMARK(BM_file_preadv)->AT_CHUNK_SIZES;
+
+static void BM_file_pwrite_loop(int iters, int chunk_size) {
+  StopBenchmarkTiming();
+  int fd = MakeTempFile(CHUNK_COUNT * chunk_size);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    for (int j = 0; j < CHUNK_COUNT; ++j) {
+      pwrite(fd, gChunks[j], chunk_size, j * chunk_size);
+    }
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * CHUNK_COUNT * chunk_size);
+  close(fd);
+}
+BENCHMARK(BM_file_pwrite_loop)->AT_CHUNK_SIZES;
+
+static void BM_file_pwritev(int iters, int chunk_size) {
+  StopBenchmarkTiming();
+  int fd = MakeTempFile(CHUNK_COUNT * chunk_size);
+  iovec ios[CHUNK_COUNT];
+  MakeIovecs(ios, chunk_size);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    pwritev(fd, ios, CHUNK_COUNT, 0);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * CHUNK_COUNT * chunk_size);
+  close(fd);
+}
+BENCHMARK(BM_file_pwritev)->AT_CHUNK_SIZES;
+
+// The append benchmarks grow a file a chunk at a time, starting again from
+// empty every APPEND_CHUNKS chunks so the file doesn't grow without bound.
+#define APPEND_CHUNKS 256
+
+static void Append(int iters, int chunk_size, bool preallocate) {
+  StopBenchmarkTiming();
+  int fd = MakeTempFile(0);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    if (i % APPEND_CHUNKS == 0) {
+      ftruncate(fd, 0);
+      lseek(fd, 0, SEEK_SET);
+      if (preallocate) {
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, APPEND_CHUNKS * chunk_size);
+      }
+    }
+    write(fd, gChunks[0], chunk_size);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * chunk_size);
+  close(fd);
+}
+
+static void BM_file_append(int iters, int chunk_size) {
+  Append(iters, chunk_size, false);
+}
+BENCHMARK(BM_file_append)->AT_CHUNK_SIZES;
+
+static void BM_file_append_fallocate(int iters, int chunk_size) {
+  Append(iters, chunk_size, true);
+}
+BENCHMARK(BM_file_append_fallocate)->AT_CHUNK_SIZES;
+
+// The writeback benchmarks write a chunk and then push it towards the disk,
+// either waiting for it with fdatasync or just starting it with
+// sync_file_range.
+
+static void BM_file_pwrite_fdatasync(int iters, int chunk_size) {
+  StopBenchmarkTiming();
+  int fd = MakeTempFile(chunk_size);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    pwrite(fd, gChunks[0], chunk_size, 0);
+    fdatasync(fd);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * chunk_size);
+  close(fd);
+}
+BENCHMARK(BM_file_pwrite_fdatasync)->AT_CHUNK_SIZES;
+
+static void BM_file_pwrite_sync_file_range(int iters, int chunk_size) {
+  StopBenchmarkTiming();
+  int fd = MakeTempFile(chunk_size);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    pwrite(fd, gChunks[0], chunk_size, 0);
+    sync_file_range(fd, 0, chunk_size, SYNC_FILE_RANGE_WRITE);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * chunk_size);
+  close(fd);
+}
+BENCHMARK(BM_file_pwrite_sync_file_range)->AT_CHUNK_SIZES;
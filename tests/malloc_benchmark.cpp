@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark.h"
+
+#include <dlfcn.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define KB 1024
+#define MB (1024*KB)
+
+// Grows a buffer from 64KiB to 'nbytes' by doubling, as a streaming buffer would. Large blocks
+// are mmapped, so with mremap each step moves page table entries instead of copying the payload.
+static void BM_malloc_realloc_grow(int iters, int nbytes) {
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    size_t size = 64*KB;
+    char* buf = reinterpret_cast<char*>(malloc(size));
+    buf[size - 1] = 'x';
+    while (size < static_cast<size_t>(nbytes)) {
+      size *= 2;
+      buf = reinterpret_cast<char*>(realloc(buf, size));
+      buf[size - 1] = 'x';
+    }
+    free(buf);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * int64_t(nbytes));
+}
+BENCHMARK(BM_malloc_realloc_grow)->Arg(1*MB)->Arg(16*MB)->Arg(256*MB);
+
+#if defined(__BIONIC__)
+
+// These must match libc/bionic/debug_stacktrace.h.
+#define BACKTRACE_UNWINDER_LIBGCC 0
+#define BACKTRACE_UNWINDER_FAST   1
+
+#define MAX_BACKTRACE_DEPTH 64
+
+#define AT_BACKTRACE_DEPTHS Arg(4)->Arg(8)->Arg(16)->Arg(32)
+
+typedef int (*BacktraceFn)(int, uintptr_t*, size_t);
+
+static BacktraceFn GetBacktraceFn() {
+  static BacktraceFn fn = NULL;
+  if (fn == NULL) {
+    void* handle = dlopen("libc_malloc_debug_leak.so", RTLD_NOW);
+    if (handle == NULL) {
+      fprintf(stderr, "libc_malloc_debug_leak.so not available: %s\n", dlerror());
+      exit(EXIT_FAILURE);
+    }
+    fn = reinterpret_cast<BacktraceFn>(dlsym(handle, "malloc_debug_backtrace"));
+    if (fn == NULL) {
+      fprintf(stderr, "malloc_debug_backtrace not found: %s\n", dlerror());
+      exit(EXIT_FAILURE);
+    }
+  }
+  return fn;
+}
+
+// Recurses 'depth' times and then takes 'iters' backtraces. Returns the total number of frames found.
+static __attribute__((noinline)) int64_t BacktraceAtDepth(int unwinder, int iters, int depth) {
+  if (depth > 0) {
+    // The volatile stops the compiler turning the recursion into a tail call.
+    volatile int64_t frame_count = BacktraceAtDepth(unwinder, iters, depth - 1);
+    return frame_count;
+  }
+
+  BacktraceFn backtrace_fn = GetBacktraceFn();
+  uintptr_t frames[MAX_BACKTRACE_DEPTH];
+  int64_t frame_count = 0;
+  StartBenchmarkTiming();
+  for (int i = 0; i < iters; ++i) {
+    frame_count += backtrace_fn(unwinder, frames, MAX_BACKTRACE_DEPTH);
+  }
+  StopBenchmarkTiming();
+  return frame_count;
+}
+
+// We report each frame as one "byte", so the throughput column is millions of frames per second.
+static void BM_malloc_backtrace_libgcc(int iters, int depth) {
+  StopBenchmarkTiming();
+  int64_t frame_count = BacktraceAtDepth(BACKTRACE_UNWINDER_LIBGCC, iters, depth);
+  SetBenchmarkBytesProcessed(frame_count);
+}
+BENCHMARK(BM_malloc_backtrace_libgcc)->AT_BACKTRACE_DEPTHS;
+
+static void BM_malloc_backtrace_fast(int iters, int depth) {
+  StopBenchmarkTiming();
+  int64_t frame_count = BacktraceAtDepth(BACKTRACE_UNWINDER_FAST, iters, depth);
+  SetBenchmarkBytesProcessed(frame_count);
+}
+BENCHMARK(BM_malloc_backtrace_fast)->AT_BACKTRACE_DEPTHS;
+
+#endif
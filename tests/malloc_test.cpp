@@ -18,6 +18,7 @@
 
 #include <stdlib.h>
 #include <malloc.h>
+#include <stdint.h>
 
 TEST(malloc, malloc_std) {
   // Simple malloc test.
@@ -233,3 +234,158 @@ TEST(malloc, calloc_multiple_realloc) {
 
   free(ptr);
 }
+
+// malloc_iterate, malloc_disable and malloc_enable are bionic extensions.
+#if defined(__BIONIC__)
+struct IterateState {
+  uintptr_t wanted[4];
+  bool found[4];
+};
+
+static void IterateCallback(uintptr_t base, size_t size, void* arg) {
+  IterateState* state = reinterpret_cast<IterateState*>(arg);
+  for (size_t i = 0; i < 4; ++i) {
+    if (state->wanted[i] == base) {
+      state->found[i] = (size >= 100);
+    }
+  }
+}
+
+TEST(malloc, malloc_iterate) {
+  IterateState state;
+  void* ptrs[4];
+  for (size_t i = 0; i < 4; ++i) {
+    ptrs[i] = malloc(100);
+    ASSERT_TRUE(ptrs[i] != NULL);
+    state.wanted[i] = reinterpret_cast<uintptr_t>(ptrs[i]);
+    state.found[i] = false;
+  }
+  free(ptrs[3]);
+
+  malloc_disable();
+  malloc_iterate(0, SIZE_MAX, IterateCallback, &state);
+  malloc_enable();
+
+  ASSERT_TRUE(state.found[0]);
+  ASSERT_TRUE(state.found[1]);
+  ASSERT_TRUE(state.found[2]);
+  ASSERT_FALSE(state.found[3]);
+
+  for (size_t i = 0; i < 3; ++i) {
+    free(ptrs[i]);
+  }
+}
+
+static uint64_t TotalAllocations(const malloc_extended_stats& stats) {
+  uint64_t total = 0;
+  for (size_t i = 0; i < MALLOC_SIZE_CLASS_COUNT; ++i) {
+    total += stats.size_classes[i].total;
+  }
+  return total;
+}
+
+static size_t LiveAllocations(const malloc_extended_stats& stats) {
+  size_t live = 0;
+  for (size_t i = 0; i < MALLOC_SIZE_CLASS_COUNT; ++i) {
+    live += stats.size_classes[i].live;
+  }
+  return live;
+}
+
+TEST(malloc, malloc_get_extended_stats) {
+  malloc_extended_stats before;
+  malloc_get_extended_stats(&before);
+
+  void* small = malloc(100);
+  ASSERT_TRUE(small != NULL);
+  // Bigger than any mmap threshold, so it gets its own mapping.
+  void* large = malloc(4 * 1024 * 1024);
+  ASSERT_TRUE(large != NULL);
+
+  malloc_extended_stats during;
+  malloc_get_extended_stats(&during);
+  ASSERT_GE(TotalAllocations(during), TotalAllocations(before) + 2);
+  ASSERT_EQ(before.mmapped_chunks + 1, during.mmapped_chunks);
+  // 4MiB is in size class 22.
+  ASSERT_EQ(before.size_classes[22].live + 1, during.size_classes[22].live);
+  ASSERT_GE(during.lock_contentions, before.lock_contentions);
+
+  free(large);
+  free(small);
+
+  malloc_extended_stats after;
+  malloc_get_extended_stats(&after);
+  ASSERT_EQ(before.mmapped_chunks, after.mmapped_chunks);
+  ASSERT_EQ(before.size_classes[22].live, after.size_classes[22].live);
+}
+
+// Not in <malloc.h>, but libc exports them.
+extern "C" void** dlindependent_calloc(size_t, size_t, void**);
+extern "C" size_t dlbulk_free(void**, size_t);
+extern "C" int dlmallopt(int, int);
+#define DL_M_MMAP_THRESHOLD (-3)
+
+TEST(malloc, malloc_get_extended_stats_memalign) {
+  malloc_extended_stats before;
+  malloc_get_extended_stats(&before);
+
+  // memalign over-allocates and trims; only the trimmed chunk counts.
+  void* ptr = memalign(256, 100);
+  ASSERT_TRUE(ptr != NULL);
+
+  malloc_extended_stats during;
+  malloc_get_extended_stats(&during);
+  ASSERT_EQ(TotalAllocations(before) + 1, TotalAllocations(during));
+  ASSERT_EQ(LiveAllocations(before) + 1, LiveAllocations(during));
+
+  free(ptr);
+
+  malloc_extended_stats after;
+  malloc_get_extended_stats(&after);
+  ASSERT_EQ(LiveAllocations(before), LiveAllocations(after));
+}
+
+TEST(malloc, mallopt_mmap_threshold_sticks) {
+  // Setting the default explicitly still turns off the dynamic threshold,
+  // so a freed 256KiB mapping doesn't move 256KiB allocations onto the heap.
+  ASSERT_EQ(1, dlmallopt(DL_M_MMAP_THRESHOLD, 64 * 1024));
+  void* small = malloc(16);
+  ASSERT_TRUE(small != NULL);
+  for (size_t i = 0; i < 2; ++i) {
+    malloc_extended_stats before;
+    malloc_get_extended_stats(&before);
+    void* ptr = malloc(256 * 1024);
+    ASSERT_TRUE(ptr != NULL);
+    malloc_extended_stats during;
+    malloc_get_extended_stats(&during);
+    ASSERT_EQ(before.mmapped_chunks + 1, during.mmapped_chunks);
+    free(ptr);
+  }
+  free(small);
+}
+
+TEST(malloc, malloc_get_extended_stats_independent_calloc) {
+  malloc_extended_stats before;
+  malloc_get_extended_stats(&before);
+
+  // Three elements plus the pointer array, all carved from one chunk.
+  void** ptrs = dlindependent_calloc(3, 100, NULL);
+  ASSERT_TRUE(ptrs != NULL);
+
+  malloc_extended_stats during;
+  malloc_get_extended_stats(&during);
+  ASSERT_EQ(TotalAllocations(before) + 4, TotalAllocations(during));
+  ASSERT_EQ(LiveAllocations(before) + 4, LiveAllocations(during));
+
+  // The elements are adjacent, so bulk_free merges them before freeing.
+  ASSERT_EQ(0U, dlbulk_free(ptrs, 3));
+  free(ptrs);
+
+  malloc_extended_stats after;
+  malloc_get_extended_stats(&after);
+  ASSERT_EQ(LiveAllocations(before), LiveAllocations(after));
+  for (size_t i = 0; i < MALLOC_SIZE_CLASS_COUNT; ++i) {
+    ASSERT_EQ(before.size_classes[i].live, after.size_classes[i].live);
+  }
+}
+#endif
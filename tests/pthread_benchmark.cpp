@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark.h"
+
+#include <pthread.h>
+
+#include <vector>
+
+#define THREAD_COUNTS Arg(1)->Arg(2)->Arg(4)->Arg(8)
+#define BARRIER_THREAD_COUNTS Arg(2)->Arg(4)->Arg(8)->Arg(16)->Arg(32)
+
+// Holds worker threads until they've all been created, so that thread
+// creation isn't part of what's being timed.
+static pthread_mutex_t gStartMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gStartCond = PTHREAD_COND_INITIALIZER;
+static bool gStarted;
+
+static void WaitForStart() {
+  pthread_mutex_lock(&gStartMutex);
+  while (!gStarted) {
+    pthread_cond_wait(&gStartCond, &gStartMutex);
+  }
+  pthread_mutex_unlock(&gStartMutex);
+}
+
+// Runs 'fn' on 'thread_count' threads at once, sharing 'iters' iterations
+// between them. Only the time from releasing the threads to joining them
+// is measured.
+static void RunOnThreads(int iters, int thread_count, void* (*fn)(void*)) {
+  StopBenchmarkTiming();
+
+  gStarted = false;
+  int iterations_per_thread = (iters + thread_count - 1) / thread_count;
+  std::vector<pthread_t> threads(thread_count);
+  for (int i = 0; i < thread_count; ++i) {
+    pthread_create(&threads[i], NULL, fn, &iterations_per_thread);
+  }
+
+  StartBenchmarkTiming();
+
+  pthread_mutex_lock(&gStartMutex);
+  gStarted = true;
+  pthread_cond_broadcast(&gStartCond);
+  pthread_mutex_unlock(&gStartMutex);
+
+  for (int i = 0; i < thread_count; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  StopBenchmarkTiming();
+}
+
+static void* IdleThread(void*) {
+  return NULL;
+}
+
+static void BM_pthread_create_join(int iters) {
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    pthread_t thread;
+    pthread_create(&thread, NULL, IdleThread, NULL);
+    pthread_join(thread, NULL);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_pthread_create_join);
+
+static pthread_mutex_t gContendedMutex = PTHREAD_MUTEX_INITIALIZER;
+static volatile int gContendedCounter;
+
+static void* ContendedMutexThread(void* arg) {
+  int iterations = *reinterpret_cast<int*>(arg);
+  WaitForStart();
+  for (int i = 0; i < iterations; ++i) {
+    pthread_mutex_lock(&gContendedMutex);
+    // Keep the critical section short, as it is in most real code.
+    for (int j = 0; j < 16; ++j) {
+      ++gContendedCounter;
+    }
+    pthread_mutex_unlock(&gContendedMutex);
+  }
+  return NULL;
+}
+
+static void BM_pthread_mutex_contended(int iters, int thread_count) {
+  RunOnThreads(iters, thread_count, ContendedMutexThread);
+}
+BENCHMARK(BM_pthread_mutex_contended)->THREAD_COUNTS;
+
+static pthread_spinlock_t gContendedSpinlock;
+
+static void* ContendedSpinlockThread(void* arg) {
+  int iterations = *reinterpret_cast<int*>(arg);
+  WaitForStart();
+  for (int i = 0; i < iterations; ++i) {
+    pthread_spin_lock(&gContendedSpinlock);
+    for (int j = 0; j < 16; ++j) {
+      ++gContendedCounter;
+    }
+    pthread_spin_unlock(&gContendedSpinlock);
+  }
+  return NULL;
+}
+
+static void BM_pthread_spin_contended(int iters, int thread_count) {
+  pthread_spin_init(&gContendedSpinlock, PTHREAD_PROCESS_PRIVATE);
+  RunOnThreads(iters, thread_count, ContendedSpinlockThread);
+  pthread_spin_destroy(&gContendedSpinlock);
+}
+BENCHMARK(BM_pthread_spin_contended)->THREAD_COUNTS;
+
+static pthread_barrier_t gBarrier;
+
+static void* BarrierThread(void* arg) {
+  int phases = *reinterpret_cast<int*>(arg);
+  WaitForStart();
+  for (int i = 0; i < phases; ++i) {
+    pthread_barrier_wait(&gBarrier);
+  }
+  return NULL;
+}
+
+// Each iteration is one phase, which every thread has to get through, so
+// this measures the time from the last thread arriving to everyone leaving.
+static void BM_pthread_barrier_phase(int iters, int thread_count) {
+  pthread_barrier_init(&gBarrier, NULL, thread_count);
+  RunOnThreads(iters * thread_count, thread_count, BarrierThread);
+  pthread_barrier_destroy(&gBarrier);
+}
+BENCHMARK(BM_pthread_barrier_phase)->BARRIER_THREAD_COUNTS;
+
+static pthread_rwlock_t gRwlock = PTHREAD_RWLOCK_INITIALIZER;
+static volatile int gRwlockProtected;
+
+// Mostly readers: one write in every 64 lock acquisitions.
+static void* ReadHeavyRwlockThread(void* arg) {
+  int iterations = *reinterpret_cast<int*>(arg);
+  WaitForStart();
+  for (int i = 0; i < iterations; ++i) {
+    if ((i % 64) == 0) {
+      pthread_rwlock_wrlock(&gRwlock);
+      ++gRwlockProtected;
+    } else {
+      pthread_rwlock_rdlock(&gRwlock);
+      static_cast<void>(gRwlockProtected);
+    }
+    pthread_rwlock_unlock(&gRwlock);
+  }
+  return NULL;
+}
+
+static void BM_pthread_rwlock_read_heavy(int iters, int thread_count) {
+  RunOnThreads(iters, thread_count, ReadHeavyRwlockThread);
+}
+BENCHMARK(BM_pthread_rwlock_read_heavy)->THREAD_COUNTS;
+
+// Mostly writers: one read in every 4 lock acquisitions.
+static void* WriteHeavyRwlockThread(void* arg) {
+  int iterations = *reinterpret_cast<int*>(arg);
+  WaitForStart();
+  for (int i = 0; i < iterations; ++i) {
+    if ((i % 4) == 0) {
+      pthread_rwlock_rdlock(&gRwlock);
+      static_cast<void>(gRwlockProtected);
+    } else {
+      pthread_rwlock_wrlock(&gRwlock);
+      ++gRwlockProtected;
+    }
+    pthread_rwlock_unlock(&gRwlock);
+  }
+  return NULL;
+}
+
+static void BM_pthread_rwlock_write_heavy(int iters, int thread_count) {
+  RunOnThreads(iters, thread_count, WriteHeavyRwlockThread);
+}
+BENCHMARK(BM_pthread_rwlock_write_heavy)->THREAD_COUNTS;
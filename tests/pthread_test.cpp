@@ -19,6 +19,11 @@
 #include <errno.h>
 #include <limits.h>
 #include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 TEST(pthread, pthread_key_create) {
@@ -51,6 +56,83 @@ TEST(pthread, pthread_key_create_lots) {
 }
 #endif
 
+TEST(pthread, pthread_key_delete__stale_values) {
+  pthread_key_t key;
+  ASSERT_EQ(0, pthread_key_create(&key, NULL));
+  int value;
+  ASSERT_EQ(0, pthread_setspecific(key, &value));
+  ASSERT_EQ(&value, pthread_getspecific(key));
+  ASSERT_EQ(0, pthread_key_delete(key));
+  ASSERT_EQ(EINVAL, pthread_setspecific(key, &value));
+
+  // A new key doesn't inherit the old key's values, even if it's the same key.
+  pthread_key_t new_key;
+  ASSERT_EQ(0, pthread_key_create(&new_key, NULL));
+  ASSERT_EQ(NULL, pthread_getspecific(new_key));
+  ASSERT_EQ(0, pthread_key_delete(new_key));
+}
+
+static int gKeyDestructorCalls;
+
+static void CountingKeyDestructor(void* value) {
+  ++gKeyDestructorCalls;
+  *reinterpret_cast<void**>(value) = NULL;
+}
+
+struct ManyKeysState {
+  std::vector<pthread_key_t> keys;
+  std::vector<void*> values;
+  bool ok;
+};
+
+static void* ManyKeysFn(void* arg) {
+  ManyKeysState* state = reinterpret_cast<ManyKeysState*>(arg);
+  for (size_t i = 0; i < state->keys.size(); ++i) {
+    // Nothing carries over from the thread that set these.
+    state->ok = state->ok && (pthread_getspecific(state->keys[i]) == NULL);
+    pthread_setspecific(state->keys[i], &state->values[i]);
+  }
+  for (size_t i = 0; i < state->keys.size(); ++i) {
+    state->ok = state->ok && (pthread_getspecific(state->keys[i]) == &state->values[i]);
+  }
+  return NULL;
+}
+
+TEST(pthread, pthread_key_create__many) {
+  // Use enough keys to get past however many fast slots there are.
+  ManyKeysState state;
+  const size_t kKeyCount = 256;
+  for (size_t i = 0; i < kKeyCount; ++i) {
+    pthread_key_t key;
+    ASSERT_EQ(0, pthread_key_create(&key, CountingKeyDestructor));
+    state.keys.push_back(key);
+    state.values.push_back(&state);
+  }
+  int our_value;
+  for (size_t i = 0; i < kKeyCount; ++i) {
+    ASSERT_EQ(0, pthread_setspecific(state.keys[i], &our_value));
+  }
+
+  state.ok = true;
+  gKeyDestructorCalls = 0;
+  pthread_t t;
+  ASSERT_EQ(0, pthread_create(&t, NULL, ManyKeysFn, &state));
+  ASSERT_EQ(0, pthread_join(t, NULL));
+  ASSERT_TRUE(state.ok);
+
+  // The other thread's values were all destroyed when it exited...
+  ASSERT_EQ(static_cast<int>(kKeyCount), gKeyDestructorCalls);
+  for (size_t i = 0; i < kKeyCount; ++i) {
+    ASSERT_EQ(NULL, state.values[i]);
+  }
+
+  // ...and ours are untouched.
+  for (size_t i = 0; i < kKeyCount; ++i) {
+    ASSERT_EQ(&our_value, pthread_getspecific(state.keys[i]));
+    ASSERT_EQ(0, pthread_key_delete(state.keys[i]));
+  }
+}
+
 static void* IdFn(void* arg) {
   return arg;
 }
@@ -143,6 +225,25 @@ TEST(pthread, pthread_no_op_detach_after_join) {
   ASSERT_EQ(0, reinterpret_cast<int>(join_result));
 }
 
+#if defined(__BIONIC__) // glibc doesn't check for invalid pthread_t in pthread_join.
+TEST(pthread, pthread_detach_after_exit) {
+  pthread_t t;
+  ASSERT_EQ(0, pthread_create(&t, NULL, IdFn, NULL));
+
+  // Wait for the thread to have exited...
+  while (pthread_kill(t, 0) == 0) {
+    usleep(1000);
+  }
+
+  // ...then detaching it should clean it up straight away...
+  ASSERT_EQ(0, pthread_detach(t));
+
+  // ...so it can't be joined any more.
+  void* result;
+  ASSERT_EQ(ESRCH, pthread_join(t, &result));
+}
+#endif
+
 TEST(pthread, pthread_join_self) {
   void* result;
   ASSERT_EQ(EDEADLK, pthread_join(pthread_self(), &result));
@@ -442,3 +543,642 @@ TEST(pthread, pthread_attr_setstacksize) {
   ASSERT_EQ(GetActualStackSize(attributes), 32*1024U);
 #endif
 }
+
+static void* CheckOwnStackFn(void* arg) {
+  bool* ok = reinterpret_cast<bool*>(arg);
+  pthread_attr_t attributes;
+  pthread_getattr_np(pthread_self(), &attributes);
+  void* stack_base;
+  size_t stack_size;
+  pthread_attr_getstack(&attributes, &stack_base, &stack_size);
+  pthread_attr_destroy(&attributes);
+
+  // Our locals should be on the stack pthread_getattr_np reports.
+  char* local = reinterpret_cast<char*>(&attributes);
+  *ok = (local > reinterpret_cast<char*>(stack_base) &&
+         local < reinterpret_cast<char*>(stack_base) + stack_size);
+
+#if defined(__BIONIC__)
+  // Bionic gives every thread an alternate signal stack.
+  stack_t ss;
+  *ok = *ok && (sigaltstack(NULL, &ss) == 0) && (ss.ss_flags & SS_DISABLE) == 0;
+#endif
+  return NULL;
+}
+
+TEST(pthread, pthread_create__recycled_stacks) {
+  pthread_attr_t attributes;
+  ASSERT_EQ(0, pthread_attr_init(&attributes));
+
+  // Exited threads' stacks may be reused, so make sure that switching back
+  // and forth between sizes, and between joined and detached threads, works.
+  for (size_t i = 0; i < 64; ++i) {
+    ASSERT_EQ(0, pthread_attr_setstacksize(&attributes, ((i % 3) + 1) * 32*1024));
+    ASSERT_EQ(0, pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED));
+    pthread_t t;
+    bool ok = false;
+    ASSERT_EQ(0, pthread_create(&t, &attributes, IdFn, NULL));
+
+    ASSERT_EQ(0, pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_JOINABLE));
+    ASSERT_EQ(0, pthread_create(&t, &attributes, CheckOwnStackFn, &ok));
+    ASSERT_EQ(0, pthread_join(t, NULL));
+    ASSERT_TRUE(ok) << i;
+  }
+}
+
+#if defined(__BIONIC__)
+static void* WriteAboveSigaltstackFn(void*) {
+  stack_t ss;
+  sigaltstack(NULL, &ss);
+  reinterpret_cast<volatile char*>(ss.ss_sp)[ss.ss_size] = 0;
+  return NULL;
+}
+
+static void WriteAboveSigaltstack() {
+  pthread_t t;
+  pthread_create(&t, NULL, WriteAboveSigaltstackFn, NULL);
+  pthread_join(t, NULL);
+  exit(0);
+}
+
+// The alternate signal stack sits just below the stack's guard region, so a
+// thread stack that overflows faults rather than running into it.
+TEST(pthread_DeathTest, sigaltstack_below_guard_region) {
+  ASSERT_EXIT(WriteAboveSigaltstack(), testing::KilledBySignal(SIGSEGV), "");
+}
+#endif
+
+struct BroadcastState {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int generation;
+  int rounds_done;
+};
+
+static void* BroadcastWaiterFn(void* arg) {
+  BroadcastState* state = reinterpret_cast<BroadcastState*>(arg);
+  for (size_t round = 0; round < 100; ++round) {
+    pthread_mutex_lock(&state->mutex);
+    int generation = state->generation;
+    while (state->generation == generation) {
+      pthread_cond_wait(&state->cond, &state->mutex);
+    }
+    ++state->rounds_done;
+    pthread_mutex_unlock(&state->mutex);
+  }
+  return NULL;
+}
+
+TEST(pthread, pthread_cond_broadcast__many_waiters) {
+  // Every waiter must get through every round, whether the broadcast wakes
+  // it directly or hands it on through the mutex.
+  BroadcastState state;
+  ASSERT_EQ(0, pthread_mutex_init(&state.mutex, NULL));
+  ASSERT_EQ(0, pthread_cond_init(&state.cond, NULL));
+  state.generation = 0;
+  state.rounds_done = 0;
+
+  const size_t kWaiterCount = 32;
+  pthread_t waiters[kWaiterCount];
+  for (size_t i = 0; i < kWaiterCount; ++i) {
+    ASSERT_EQ(0, pthread_create(&waiters[i], NULL, BroadcastWaiterFn, &state));
+  }
+
+  bool done = false;
+  while (!done) {
+    pthread_mutex_lock(&state.mutex);
+    done = (state.rounds_done == static_cast<int>(kWaiterCount * 100));
+    ++state.generation;
+    ASSERT_EQ(0, pthread_cond_broadcast(&state.cond));
+    pthread_mutex_unlock(&state.mutex);
+    usleep(100);
+  }
+
+  for (size_t i = 0; i < kWaiterCount; ++i) {
+    ASSERT_EQ(0, pthread_join(waiters[i], NULL));
+  }
+  ASSERT_EQ(0, pthread_cond_destroy(&state.cond));
+  ASSERT_EQ(0, pthread_mutex_destroy(&state.mutex));
+}
+
+TEST(pthread, pthread_rwlock_smoke) {
+  pthread_rwlock_t l;
+  ASSERT_EQ(0, pthread_rwlock_init(&l, NULL));
+
+  // Any number of readers.
+  ASSERT_EQ(0, pthread_rwlock_rdlock(&l));
+  ASSERT_EQ(0, pthread_rwlock_rdlock(&l));
+  ASSERT_EQ(0, pthread_rwlock_tryrdlock(&l));
+#if defined(__BIONIC__)
+  ASSERT_EQ(EBUSY, pthread_rwlock_destroy(&l));
+#endif
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+
+#if defined(__BIONIC__)
+  // Nobody holds the lock now.
+  ASSERT_EQ(EPERM, pthread_rwlock_unlock(&l));
+#endif
+
+  // A single writer.
+  ASSERT_EQ(0, pthread_rwlock_wrlock(&l));
+#if defined(__BIONIC__)
+  // Bionic lets the writer take the lock again (POSIX leaves this undefined).
+  ASSERT_EQ(0, pthread_rwlock_trywrlock(&l));
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+#endif
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+
+  ASSERT_EQ(0, pthread_rwlock_destroy(&l));
+}
+
+struct RwlockTryState {
+  pthread_rwlock_t* lock;
+  int tryrdlock_result;
+  int trywrlock_result;
+};
+
+static void* RwlockTryFn(void* arg) {
+  RwlockTryState* state = reinterpret_cast<RwlockTryState*>(arg);
+  state->tryrdlock_result = pthread_rwlock_tryrdlock(state->lock);
+  if (state->tryrdlock_result == 0) {
+    pthread_rwlock_unlock(state->lock);
+  }
+  state->trywrlock_result = pthread_rwlock_trywrlock(state->lock);
+  if (state->trywrlock_result == 0) {
+    pthread_rwlock_unlock(state->lock);
+  }
+  return NULL;
+}
+
+static void TryRwlockFromOtherThread(pthread_rwlock_t* l, int* rd_result, int* wr_result) {
+  RwlockTryState state;
+  state.lock = l;
+  pthread_t t;
+  ASSERT_EQ(0, pthread_create(&t, NULL, RwlockTryFn, &state));
+  ASSERT_EQ(0, pthread_join(t, NULL));
+  *rd_result = state.tryrdlock_result;
+  *wr_result = state.trywrlock_result;
+}
+
+TEST(pthread, pthread_rwlock_exclusion) {
+  pthread_rwlock_t l = PTHREAD_RWLOCK_INITIALIZER;
+  int rd_result;
+  int wr_result;
+
+  // Readers share the lock, but keep writers out.
+  ASSERT_EQ(0, pthread_rwlock_rdlock(&l));
+  TryRwlockFromOtherThread(&l, &rd_result, &wr_result);
+  ASSERT_EQ(0, rd_result);
+  ASSERT_EQ(EBUSY, wr_result);
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+
+  // A writer keeps everybody out.
+  ASSERT_EQ(0, pthread_rwlock_wrlock(&l));
+  TryRwlockFromOtherThread(&l, &rd_result, &wr_result);
+  ASSERT_EQ(EBUSY, rd_result);
+  ASSERT_EQ(EBUSY, wr_result);
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+
+  TryRwlockFromOtherThread(&l, &rd_result, &wr_result);
+  ASSERT_EQ(0, rd_result);
+  ASSERT_EQ(0, wr_result);
+}
+
+struct RwlockWriterState {
+  pthread_rwlock_t* lock;
+  volatile bool acquired;
+};
+
+static void* RwlockWriterFn(void* arg) {
+  RwlockWriterState* state = reinterpret_cast<RwlockWriterState*>(arg);
+  pthread_rwlock_wrlock(state->lock);
+  state->acquired = true;
+  pthread_rwlock_unlock(state->lock);
+  return NULL;
+}
+
+TEST(pthread, pthread_rwlock_writer_wakeup) {
+  pthread_rwlock_t l = PTHREAD_RWLOCK_INITIALIZER;
+  ASSERT_EQ(0, pthread_rwlock_rdlock(&l));
+
+  RwlockWriterState state;
+  state.lock = &l;
+  state.acquired = false;
+  pthread_t t;
+  ASSERT_EQ(0, pthread_create(&t, NULL, RwlockWriterFn, &state));
+
+  // Give the writer a chance to block, then let it in.
+  usleep(100000);
+  ASSERT_FALSE(state.acquired);
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+
+  ASSERT_EQ(0, pthread_join(t, NULL));
+  ASSERT_TRUE(state.acquired);
+}
+
+static void* RwlockTimedWriterFn(void* arg) {
+  timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_nsec += 200000000;
+  if (ts.tv_nsec >= 1000000000) {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+  int result = pthread_rwlock_timedwrlock(reinterpret_cast<pthread_rwlock_t*>(arg), &ts);
+  return reinterpret_cast<void*>(static_cast<intptr_t>(result));
+}
+
+static void* RwlockReaderFn(void* arg) {
+  RwlockWriterState* state = reinterpret_cast<RwlockWriterState*>(arg);
+  pthread_rwlock_rdlock(state->lock);
+  state->acquired = true;
+  pthread_rwlock_unlock(state->lock);
+  return NULL;
+}
+
+TEST(pthread, pthread_rwlock_timedwrlock_timeout_wakes_readers) {
+  pthread_rwlock_t l = PTHREAD_RWLOCK_INITIALIZER;
+  ASSERT_EQ(0, pthread_rwlock_rdlock(&l));
+
+  // A writer waits behind our read lock and gives up...
+  pthread_t writer;
+  ASSERT_EQ(0, pthread_create(&writer, NULL, RwlockTimedWriterFn, &l));
+  usleep(50000);
+
+  // ...while a new reader queues up behind the writer.
+  RwlockWriterState state;
+  state.lock = &l;
+  state.acquired = false;
+  pthread_t reader;
+  ASSERT_EQ(0, pthread_create(&reader, NULL, RwlockReaderFn, &state));
+
+  void* result;
+  ASSERT_EQ(0, pthread_join(writer, &result));
+  ASSERT_EQ(ETIMEDOUT, reinterpret_cast<intptr_t>(result));
+
+  // Once the writer has gone, the reader gets in without us unlocking.
+  for (size_t i = 0; i < 500 && !state.acquired; ++i) {
+    usleep(10000);
+  }
+  ASSERT_TRUE(state.acquired);
+  ASSERT_EQ(0, pthread_join(reader, NULL));
+  ASSERT_EQ(0, pthread_rwlock_unlock(&l));
+}
+
+TEST(pthread, pthread_mutexattr_setprotocol) {
+  pthread_mutexattr_t attr;
+  ASSERT_EQ(0, pthread_mutexattr_init(&attr));
+
+  int protocol;
+  ASSERT_EQ(0, pthread_mutexattr_getprotocol(&attr, &protocol));
+  ASSERT_EQ(PTHREAD_PRIO_NONE, protocol);
+
+  ASSERT_EQ(0, pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT));
+  ASSERT_EQ(0, pthread_mutexattr_getprotocol(&attr, &protocol));
+  ASSERT_EQ(PTHREAD_PRIO_INHERIT, protocol);
+
+  // The protocol doesn't disturb the type.
+  int type;
+  ASSERT_EQ(0, pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE));
+  ASSERT_EQ(0, pthread_mutexattr_gettype(&attr, &type));
+  ASSERT_EQ(PTHREAD_MUTEX_RECURSIVE, type);
+  ASSERT_EQ(0, pthread_mutexattr_getprotocol(&attr, &protocol));
+  ASSERT_EQ(PTHREAD_PRIO_INHERIT, protocol);
+
+  ASSERT_EQ(EINVAL, pthread_mutexattr_setprotocol(&attr, 123));
+  ASSERT_EQ(0, pthread_mutexattr_destroy(&attr));
+}
+
+static void* PiMutexTrylockFn(void* arg) {
+  return reinterpret_cast<void*>(static_cast<intptr_t>(pthread_mutex_trylock(reinterpret_cast<pthread_mutex_t*>(arg))));
+}
+
+static void TestPiMutex(int type) {
+  pthread_mutexattr_t attr;
+  ASSERT_EQ(0, pthread_mutexattr_init(&attr));
+  ASSERT_EQ(0, pthread_mutexattr_settype(&attr, type));
+  ASSERT_EQ(0, pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT));
+  pthread_mutex_t m;
+  ASSERT_EQ(0, pthread_mutex_init(&m, &attr));
+  ASSERT_EQ(0, pthread_mutexattr_destroy(&attr));
+
+  ASSERT_EQ(0, pthread_mutex_lock(&m));
+  if (type == PTHREAD_MUTEX_RECURSIVE) {
+    ASSERT_EQ(0, pthread_mutex_lock(&m));
+    ASSERT_EQ(0, pthread_mutex_trylock(&m));
+    ASSERT_EQ(0, pthread_mutex_unlock(&m));
+    ASSERT_EQ(0, pthread_mutex_unlock(&m));
+  } else if (type == PTHREAD_MUTEX_ERRORCHECK) {
+    ASSERT_EQ(EDEADLK, pthread_mutex_lock(&m));
+  }
+
+  // Another thread can't have it while we do.
+  pthread_t t;
+  void* result;
+  ASSERT_EQ(0, pthread_create(&t, NULL, PiMutexTrylockFn, &m));
+  ASSERT_EQ(0, pthread_join(t, &result));
+  ASSERT_EQ(EBUSY, reinterpret_cast<intptr_t>(result));
+
+  ASSERT_EQ(0, pthread_mutex_unlock(&m));
+  if (type != PTHREAD_MUTEX_NORMAL) {
+    ASSERT_EQ(EPERM, pthread_mutex_unlock(&m));
+  }
+
+  // ...but can once we've let go.
+  ASSERT_EQ(0, pthread_create(&t, NULL, PiMutexTrylockFn, &m));
+  ASSERT_EQ(0, pthread_join(t, &result));
+  ASSERT_EQ(0, reinterpret_cast<intptr_t>(result));
+  ASSERT_EQ(EBUSY, pthread_mutex_destroy(&m));
+}
+
+TEST(pthread, pthread_mutex_pi_smoke) {
+  TestPiMutex(PTHREAD_MUTEX_NORMAL);
+  TestPiMutex(PTHREAD_MUTEX_RECURSIVE);
+  TestPiMutex(PTHREAD_MUTEX_ERRORCHECK);
+}
+
+TEST(pthread, pthread_mutex_pi_init_doesnt_leak) {
+  pthread_mutexattr_t attr;
+  ASSERT_EQ(0, pthread_mutexattr_init(&attr));
+  ASSERT_EQ(0, pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT));
+
+  // Each PI mutex needs one of 65536 slots; make sure they come back.
+  pthread_mutex_t m;
+  for (size_t i = 0; i < 70000; ++i) {
+    ASSERT_EQ(0, pthread_mutex_init(&m, &attr));
+    ASSERT_EQ(0, pthread_mutex_destroy(&m));
+  }
+
+  // Re-initializing without destroying first mustn't leak either...
+  for (size_t i = 0; i < 70000; ++i) {
+    ASSERT_EQ(0, pthread_mutex_init(&m, &attr));
+  }
+  ASSERT_EQ(0, pthread_mutex_lock(&m));
+  ASSERT_EQ(0, pthread_mutex_unlock(&m));
+
+  // ...including re-initializing as an ordinary mutex.
+  for (size_t i = 0; i < 70000; ++i) {
+    ASSERT_EQ(0, pthread_mutex_init(&m, NULL));
+    ASSERT_EQ(0, pthread_mutex_init(&m, &attr));
+  }
+  ASSERT_EQ(0, pthread_mutex_destroy(&m));
+  ASSERT_EQ(0, pthread_mutexattr_destroy(&attr));
+}
+
+struct PriorityInversionState {
+  pthread_mutex_t mutex;
+  int cpu;
+  volatile bool low_has_mutex;
+  volatile bool high_waiting;
+  int64_t high_wait_ns;
+};
+
+static int64_t NanoTime() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static void Spin(int64_t ns) {
+  int64_t end = NanoTime() + ns;
+  while (NanoTime() < end) {
+  }
+}
+
+// Moves the calling thread onto 'cpu', at real-time 'priority'.
+static void RunAsFifo(int cpu, int priority) {
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  sched_setaffinity(0, sizeof(cpus), &cpus);
+  sched_param param;
+  param.sched_priority = priority;
+  pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
+
+static void* PiLowFn(void* arg) {
+  PriorityInversionState* state = reinterpret_cast<PriorityInversionState*>(arg);
+  RunAsFifo(state->cpu, 1);
+  pthread_mutex_lock(&state->mutex);
+  state->low_has_mutex = true;
+  while (!state->high_waiting) {
+  }
+  Spin(100000000LL);
+  pthread_mutex_unlock(&state->mutex);
+  return NULL;
+}
+
+static void* PiMediumFn(void* arg) {
+  PriorityInversionState* state = reinterpret_cast<PriorityInversionState*>(arg);
+  RunAsFifo(state->cpu, 2);
+  Spin(500000000LL);
+  return NULL;
+}
+
+static void* PiHighFn(void* arg) {
+  PriorityInversionState* state = reinterpret_cast<PriorityInversionState*>(arg);
+  RunAsFifo(state->cpu, 3);
+  state->high_waiting = true;
+  int64_t t0 = NanoTime();
+  pthread_mutex_lock(&state->mutex);
+  state->high_wait_ns = NanoTime() - t0;
+  pthread_mutex_unlock(&state->mutex);
+  return NULL;
+}
+
+TEST(pthread, pthread_mutex_pi__priority_inversion) {
+  // Real-time priorities need privileges we might not have.
+  sched_param param;
+  param.sched_priority = 1;
+  if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0) {
+    fprintf(stderr, "skipping test: can't use SCHED_FIFO!\n");
+    return;
+  }
+  param.sched_priority = 0;
+  ASSERT_EQ(0, pthread_setschedparam(pthread_self(), SCHED_OTHER, &param));
+
+  // Put everybody on one of our CPUs so that they really compete.
+  cpu_set_t cpus;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(cpus), &cpus));
+  PriorityInversionState state;
+  state.cpu = 0;
+  while (!CPU_ISSET(state.cpu, &cpus)) {
+    ++state.cpu;
+  }
+  state.low_has_mutex = false;
+  state.high_waiting = false;
+  state.high_wait_ns = -1;
+
+  pthread_mutexattr_t attr;
+  ASSERT_EQ(0, pthread_mutexattr_init(&attr));
+  ASSERT_EQ(0, pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT));
+  ASSERT_EQ(0, pthread_mutex_init(&state.mutex, &attr));
+
+  // A low-priority thread takes the mutex a high-priority thread then wants,
+  // and a medium-priority thread turns up to hog the CPU. Without priority
+  // inheritance the high-priority thread would wait for the hog too (500ms);
+  // with it, the holder runs at high priority and finishes in about 100ms.
+  pthread_t low, medium, high;
+  ASSERT_EQ(0, pthread_create(&low, NULL, PiLowFn, &state));
+  while (!state.low_has_mutex) {
+    usleep(1000);
+  }
+  ASSERT_EQ(0, pthread_create(&high, NULL, PiHighFn, &state));
+  while (!state.high_waiting) {
+    usleep(1000);
+  }
+  ASSERT_EQ(0, pthread_create(&medium, NULL, PiMediumFn, &state));
+
+  ASSERT_EQ(0, pthread_join(high, NULL));
+  ASSERT_EQ(0, pthread_join(medium, NULL));
+  ASSERT_EQ(0, pthread_join(low, NULL));
+  ASSERT_EQ(0, pthread_mutex_destroy(&state.mutex));
+
+  ASSERT_GE(state.high_wait_ns, 0);
+  ASSERT_LT(state.high_wait_ns, 300000000LL);
+}
+
+struct BarrierState {
+  pthread_barrier_t barrier;
+  volatile int arrivals;
+  volatile int serial_count;
+  volatile bool ok;
+};
+
+static const int kBarrierThreadCount = 8;
+static const int kBarrierPhaseCount = 1000;
+
+static void* BarrierFn(void* arg) {
+  BarrierState* state = reinterpret_cast<BarrierState*>(arg);
+  for (int phase = 0; phase < kBarrierPhaseCount; ++phase) {
+    __sync_fetch_and_add(&state->arrivals, 1);
+    int result = pthread_barrier_wait(&state->barrier);
+    if (result == PTHREAD_BARRIER_SERIAL_THREAD) {
+      __sync_fetch_and_add(&state->serial_count, 1);
+    } else if (result != 0) {
+      state->ok = false;
+    }
+    // Nobody gets past the barrier until everyone has arrived.
+    if (state->arrivals < (phase + 1) * kBarrierThreadCount) {
+      state->ok = false;
+    }
+    // ...and nobody gets to the next phase before everyone has checked that.
+    pthread_barrier_wait(&state->barrier);
+  }
+  return NULL;
+}
+
+TEST(pthread, pthread_barrier_wait) {
+  BarrierState state;
+  ASSERT_EQ(0, pthread_barrier_init(&state.barrier, NULL, kBarrierThreadCount));
+  state.arrivals = 0;
+  state.serial_count = 0;
+  state.ok = true;
+
+  pthread_t threads[kBarrierThreadCount];
+  for (int i = 0; i < kBarrierThreadCount; ++i) {
+    ASSERT_EQ(0, pthread_create(&threads[i], NULL, BarrierFn, &state));
+  }
+  for (int i = 0; i < kBarrierThreadCount; ++i) {
+    ASSERT_EQ(0, pthread_join(threads[i], NULL));
+  }
+
+  ASSERT_TRUE(state.ok);
+  ASSERT_EQ(kBarrierThreadCount * kBarrierPhaseCount, state.arrivals);
+  // Exactly one thread per phase is told it's the serial thread.
+  ASSERT_EQ(kBarrierPhaseCount, state.serial_count);
+  ASSERT_EQ(0, pthread_barrier_destroy(&state.barrier));
+}
+
+static void* BarrierWaitFn(void* arg) {
+  pthread_barrier_wait(reinterpret_cast<pthread_barrier_t*>(arg));
+  return NULL;
+}
+
+TEST(pthread, pthread_barrier_wait_then_destroy) {
+  // Destroy and free the barrier as soon as we're through it, while the other
+  // threads may still be on their way out. Reusing the memory straight away
+  // means any late touch of it would corrupt the next barrier.
+  for (int i = 0; i < 1000; ++i) {
+    pthread_barrier_t* barrier = new pthread_barrier_t;
+    ASSERT_EQ(0, pthread_barrier_init(barrier, NULL, 3));
+    pthread_t threads[2];
+    for (size_t j = 0; j < 2; ++j) {
+      ASSERT_EQ(0, pthread_create(&threads[j], NULL, BarrierWaitFn, barrier));
+    }
+    pthread_barrier_wait(barrier);
+    ASSERT_EQ(0, pthread_barrier_destroy(barrier));
+    memset(barrier, 0xff, sizeof(*barrier));
+    delete barrier;
+    for (size_t j = 0; j < 2; ++j) {
+      ASSERT_EQ(0, pthread_join(threads[j], NULL));
+    }
+  }
+}
+
+TEST(pthread, pthread_barrier_init) {
+  pthread_barrier_t barrier;
+  ASSERT_EQ(EINVAL, pthread_barrier_init(&barrier, NULL, 0));
+
+  pthread_barrierattr_t attr;
+  ASSERT_EQ(0, pthread_barrierattr_init(&attr));
+  int pshared;
+  ASSERT_EQ(0, pthread_barrierattr_getpshared(&attr, &pshared));
+  ASSERT_EQ(PTHREAD_PROCESS_PRIVATE, pshared);
+  ASSERT_EQ(0, pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED));
+  ASSERT_EQ(0, pthread_barrierattr_getpshared(&attr, &pshared));
+  ASSERT_EQ(PTHREAD_PROCESS_SHARED, pshared);
+  ASSERT_EQ(EINVAL, pthread_barrierattr_setpshared(&attr, 123));
+
+  // A barrier for one thread never blocks.
+  ASSERT_EQ(0, pthread_barrier_init(&barrier, &attr, 1));
+  ASSERT_EQ(PTHREAD_BARRIER_SERIAL_THREAD, pthread_barrier_wait(&barrier));
+  ASSERT_EQ(PTHREAD_BARRIER_SERIAL_THREAD, pthread_barrier_wait(&barrier));
+  ASSERT_EQ(0, pthread_barrier_destroy(&barrier));
+  ASSERT_EQ(0, pthread_barrierattr_destroy(&attr));
+}
+
+TEST(pthread, pthread_spin_smoke) {
+  pthread_spinlock_t lock;
+  ASSERT_EQ(0, pthread_spin_init(&lock, PTHREAD_PROCESS_PRIVATE));
+  ASSERT_EQ(0, pthread_spin_lock(&lock));
+  ASSERT_EQ(EBUSY, pthread_spin_trylock(&lock));
+  ASSERT_EQ(0, pthread_spin_unlock(&lock));
+  ASSERT_EQ(0, pthread_spin_trylock(&lock));
+  ASSERT_EQ(0, pthread_spin_unlock(&lock));
+  ASSERT_EQ(0, pthread_spin_destroy(&lock));
+}
+
+struct SpinState {
+  pthread_spinlock_t lock;
+  int counter;
+};
+
+static void* SpinIncrementFn(void* arg) {
+  SpinState* state = reinterpret_cast<SpinState*>(arg);
+  for (int i = 0; i < 100000; ++i) {
+    pthread_spin_lock(&state->lock);
+    ++state->counter;
+    pthread_spin_unlock(&state->lock);
+  }
+  return NULL;
+}
+
+TEST(pthread, pthread_spin_lock__contended) {
+  SpinState state;
+  ASSERT_EQ(0, pthread_spin_init(&state.lock, PTHREAD_PROCESS_PRIVATE));
+  state.counter = 0;
+
+  const size_t kThreadCount = 4;
+  pthread_t threads[kThreadCount];
+  for (size_t i = 0; i < kThreadCount; ++i) {
+    ASSERT_EQ(0, pthread_create(&threads[i], NULL, SpinIncrementFn, &state));
+  }
+  for (size_t i = 0; i < kThreadCount; ++i) {
+    ASSERT_EQ(0, pthread_join(threads[i], NULL));
+  }
+  ASSERT_EQ(static_cast<int>(kThreadCount * 100000), state.counter);
+  ASSERT_EQ(0, pthread_spin_destroy(&state.lock));
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <arpa/nameser.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// bionic's public <arpa/nameser.h> doesn't have the BIND 4 names.
+#if !defined(PACKETSZ)
+#define PACKETSZ 512
+#endif
+
+#include "../libc/netbsd/resolv/res_dg_batch.h"
+
+static void MakeUdpPair(int* tx, int* rx) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  *rx = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_NE(-1, *rx);
+  ASSERT_EQ(0, bind(*rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(0, getsockname(*rx, reinterpret_cast<sockaddr*>(&addr), &len));
+
+  *tx = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_NE(-1, *tx);
+  ASSERT_EQ(0, connect(*tx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+}
+
+static const char* kPackets[] = { "one", "three", "four" };
+
+static void SendPackets(int tx) {
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(static_cast<ssize_t>(strlen(kPackets[i])), send(tx, kPackets[i], strlen(kPackets[i]), 0));
+  }
+}
+
+static void CheckNext(dg_batch* batch, u_char* ans, size_t i) {
+  sockaddr* from;
+  ASSERT_EQ(static_cast<int>(strlen(kPackets[i])), dg_batch_next(batch, ans, &from));
+  ASSERT_EQ(0, memcmp(kPackets[i], ans, strlen(kPackets[i])));
+  ASSERT_EQ(AF_INET, from->sa_family);
+  ASSERT_EQ(htonl(INADDR_LOOPBACK), reinterpret_cast<sockaddr_in*>(from)->sin_addr.s_addr);
+}
+
+TEST(res_send, dg_batch_recvmmsg) {
+  ASSERT_EQ(0, dg_batch_no_recvmmsg);
+  int tx, rx;
+  MakeUdpPair(&tx, &rx);
+  SendPackets(tx);
+
+  // Everything already queued comes back from one call.
+  dg_batch batch;
+  u_char ans[PACKETSZ];
+  ASSERT_EQ(3, dg_batch_recv(rx, &batch, ans, sizeof(ans), DG_BATCH));
+  for (size_t i = 0; i < 3; ++i) {
+    CheckNext(&batch, ans, i);
+  }
+  ASSERT_EQ(0, dg_batch_no_recvmmsg);
+
+  close(tx);
+  close(rx);
+}
+
+TEST(res_send, dg_batch_recvfrom_fallback) {
+  // Behave as if recvmmsg had already failed with ENOSYS.
+  dg_batch_no_recvmmsg = 1;
+  int tx, rx;
+  MakeUdpPair(&tx, &rx);
+  SendPackets(tx);
+
+  // One datagram per call, straight into 'ans'.
+  dg_batch batch;
+  u_char ans[PACKETSZ];
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(1, dg_batch_recv(rx, &batch, ans, sizeof(ans), DG_BATCH));
+    CheckNext(&batch, ans, i);
+    ASSERT_EQ(batch.count, batch.next);
+  }
+
+  // Errors still come back as 0 with errno set.
+  errno = 0;
+  ASSERT_EQ(0, dg_batch_recv(-1, &batch, ans, sizeof(ans), DG_BATCH));
+  ASSERT_EQ(EBADF, errno);
+
+  dg_batch_no_recvmmsg = 0;
+  close(tx);
+  close(rx);
+}
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define KB 1024
+
+#define AT_FORWARDING_SIZES Arg(4*KB)->Arg(16*KB)->Arg(64*KB)
+
+// Small enough that a whole batch always fits in the socket buffers.
+#define PACKET_SIZE 64
+#define BATCH_SIZE 16
+
+// Makes a pair of UDP sockets on the loopback interface, each connected to
+// the other, so that every packet sent on one can be read from the other.
+static void MakeUdpPair(int* tx, int* rx) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  *rx = socket(AF_INET, SOCK_DGRAM, 0);
+  bind(*rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  socklen_t len = sizeof(addr);
+  getsockname(*rx, reinterpret_cast<sockaddr*>(&addr), &len);
+
+  *tx = socket(AF_INET, SOCK_DGRAM, 0);
+  connect(*tx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+}
+
+static void BM_socket_sendto_recvfrom(int iters) {
+  StopBenchmarkTiming();
+  int tx, rx;
+  MakeUdpPair(&tx, &rx);
+  char buf[PACKET_SIZE];
+  memset(buf, 'x', sizeof(buf));
+  sockaddr_in from;
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    sendto(tx, buf, sizeof(buf), 0, NULL, 0);
+    socklen_t from_len = sizeof(from);
+    recvfrom(rx, buf, sizeof(buf), 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * PACKET_SIZE);
+  close(tx);
+  close(rx);
+}
+BENCHMARK(BM_socket_sendto_recvfrom);
+
+// Moves the same packets as BM_socket_sendto_recvfrom, BATCH_SIZE at a time,
+// so the two are directly comparable per packet.
+static void BM_socket_sendmmsg_recvmmsg(int iters) {
+  StopBenchmarkTiming();
+  int tx, rx;
+  MakeUdpPair(&tx, &rx);
+  char bufs[BATCH_SIZE][PACKET_SIZE];
+  memset(bufs, 'x', sizeof(bufs));
+  iovec iovs[BATCH_SIZE];
+  sockaddr_in froms[BATCH_SIZE];
+  mmsghdr msgs[BATCH_SIZE];
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < BATCH_SIZE; ++i) {
+    iovs[i].iov_base = bufs[i];
+    iovs[i].iov_len = PACKET_SIZE;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; i += BATCH_SIZE) {
+    unsigned int count = (iters - i < BATCH_SIZE) ? iters - i : BATCH_SIZE;
+    for (unsigned int j = 0; j < count; ++j) {
+      msgs[j].msg_hdr.msg_name = NULL;
+      msgs[j].msg_hdr.msg_namelen = 0;
+    }
+    sendmmsg(tx, msgs, count, 0);
+    for (unsigned int j = 0; j < count; ++j) {
+      msgs[j].msg_hdr.msg_name = &froms[j];
+      msgs[j].msg_hdr.msg_namelen = sizeof(froms[j]);
+    }
+    recvmmsg(rx, msgs, count, 0, NULL);
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * PACKET_SIZE);
+  close(tx);
+  close(rx);
+}
+BENCHMARK(BM_socket_sendmmsg_recvmmsg);
+
+// The forwarding benchmarks move 'nbytes' per iteration into one end of a
+// stream socket pair, either through a user-space buffer or with splice or
+// sendfile, and read it back out of the other end. The reading is the same
+// for both, so the difference between them is the cost of the copy.
+
+static char gForwardBuffer[64*KB];
+static char gDrainBuffer[64*KB];
+
+static void Drain(int fd, size_t nbytes) {
+  while (nbytes > 0) {
+    ssize_t n = read(fd, gDrainBuffer, (nbytes < sizeof(gDrainBuffer)) ? nbytes : sizeof(gDrainBuffer));
+    if (n <= 0) {
+      return;
+    }
+    nbytes -= n;
+  }
+}
+
+static void FillPipe(int fd, size_t nbytes) {
+  // The pipe's default capacity is 64KiB, so this never blocks.
+  write(fd, gForwardBuffer, nbytes);
+}
+
+static void BM_socket_forward_pipe_read_write(int iters, int nbytes) {
+  StopBenchmarkTiming();
+  int pipe_fds[2];
+  pipe(pipe_fds);
+  int socket_fds[2];
+  socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    FillPipe(pipe_fds[1], nbytes);
+    size_t left = nbytes;
+    while (left > 0) {
+      ssize_t n = read(pipe_fds[0], gForwardBuffer, left);
+      if (n <= 0 || write(socket_fds[0], gForwardBuffer, n) != n) {
+        break;
+      }
+      Drain(socket_fds[1], n);
+      left -= n;
+    }
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * int64_t(nbytes));
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  close(socket_fds[0]);
+  close(socket_fds[1]);
+}
+BENCHMARK(BM_socket_forward_pipe_read_write)->AT_FORWARDING_SIZES;
+
+static void BM_socket_forward_pipe_splice(int iters, int nbytes) {
+  StopBenchmarkTiming();
+  int pipe_fds[2];
+  pipe(pipe_fds);
+  int socket_fds[2];
+  socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    FillPipe(pipe_fds[1], nbytes);
+    size_t left = nbytes;
+    while (left > 0) {
+      ssize_t n = splice(pipe_fds[0], NULL, socket_fds[0], NULL, left, SPLICE_F_MOVE);
+      if (n <= 0) {
+        break;
+      }
+      Drain(socket_fds[1], n);
+      left -= n;
+    }
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * int64_t(nbytes));
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  close(socket_fds[0]);
+  close(socket_fds[1]);
+}
+BENCHMARK(BM_socket_forward_pipe_splice)->AT_FORWARDING_SIZES;
+
+static void BM_socket_forward_file_read_write(int iters, int nbytes) {
+  StopBenchmarkTiming();
+  FILE* fp = tmpfile();
+  int file_fd = fileno(fp);
+  write(file_fd, gForwardBuffer, nbytes);
+  int socket_fds[2];
+  socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    off_t offset = 0;
+    while (offset < nbytes) {
+      ssize_t n = pread(file_fd, gForwardBuffer, nbytes - offset, offset);
+      if (n <= 0 || write(socket_fds[0], gForwardBuffer, n) != n) {
+        break;
+      }
+      Drain(socket_fds[1], n);
+      offset += n;
+    }
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * int64_t(nbytes));
+  fclose(fp);
+  close(socket_fds[0]);
+  close(socket_fds[1]);
+}
+BENCHMARK(BM_socket_forward_file_read_write)->AT_FORWARDING_SIZES;
+
+static void BM_socket_forward_file_sendfile(int iters, int nbytes) {
+  StopBenchmarkTiming();
+  FILE* fp = tmpfile();
+  int file_fd = fileno(fp);
+  write(file_fd, gForwardBuffer, nbytes);
+  int socket_fds[2];
+  socketpair(AF_UNIX, SOCK_STREAM, 0, socket_fds);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    off64_t offset = 0;
+    while (offset < nbytes) {
+      off64_t start = offset;
+      if (sendfile64(socket_fds[0], file_fd, &offset, nbytes - offset) <= 0) {
+        break;
+      }
+      Drain(socket_fds[1], offset - start);
+    }
+  }
+
+  StopBenchmarkTiming();
+  SetBenchmarkBytesProcessed(int64_t(iters) * int64_t(nbytes));
+  fclose(fp);
+  close(socket_fds[0]);
+  close(socket_fds[1]);
+}
+BENCHMARK(BM_socket_forward_file_sendfile)->AT_FORWARDING_SIZES;
+
+// The accept benchmarks connect a client to a listening socket and accept
+// the connection as non-blocking and close-on-exec, either with accept and
+// two fcntl calls or with a single accept4. The client side is the same for
+// both. They use an autobound abstract AF_UNIX address rather than TCP so
+// that connections don't use up loopback ports in TIME_WAIT.
+
+static int MakeListener(sockaddr_un* addr, socklen_t* addr_len) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  addr->sun_family = AF_UNIX;
+  bind(fd, reinterpret_cast<sockaddr*>(addr), sizeof(sa_family_t));
+  *addr_len = sizeof(*addr);
+  getsockname(fd, reinterpret_cast<sockaddr*>(addr), addr_len);
+  listen(fd, 1);
+  return fd;
+}
+
+static void BM_socket_accept_fcntl(int iters) {
+  StopBenchmarkTiming();
+  sockaddr_un addr;
+  socklen_t addr_len;
+  int listener = MakeListener(&addr, &addr_len);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    connect(client, reinterpret_cast<sockaddr*>(&addr), addr_len);
+    int fd = accept(listener, NULL, NULL);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    close(fd);
+    close(client);
+  }
+
+  StopBenchmarkTiming();
+  close(listener);
+}
+BENCHMARK(BM_socket_accept_fcntl);
+
+static void BM_socket_accept4(int iters) {
+  StopBenchmarkTiming();
+  sockaddr_un addr;
+  socklen_t addr_len;
+  int listener = MakeListener(&addr, &addr_len);
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    int client = socket(AF_UNIX, SOCK_STREAM, 0);
+    connect(client, reinterpret_cast<sockaddr*>(&addr), addr_len);
+    int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    close(fd);
+    close(client);
+  }
+
+  StopBenchmarkTiming();
+  close(listener);
+}
+BENCHMARK(BM_socket_accept4);
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+TEST(sys_epoll, epoll_create1) {
+  int fd = epoll_create1(0);
+  ASSERT_NE(-1, fd) << strerror(errno);
+  ASSERT_TRUE((fcntl(fd, F_GETFD) & FD_CLOEXEC) == 0);
+  close(fd);
+
+  fd = epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_NE(-1, fd) << strerror(errno);
+  ASSERT_TRUE((fcntl(fd, F_GETFD) & FD_CLOEXEC) != 0);
+  close(fd);
+
+  ASSERT_EQ(-1, epoll_create1(-1));
+  ASSERT_EQ(EINVAL, errno);
+}
+
+TEST(sys_epoll, epoll_pwait) {
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  ASSERT_NE(-1, epoll_fd);
+
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.fd = pipe_fds[0];
+  ASSERT_EQ(0, epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pipe_fds[0], &event));
+
+  epoll_event events[1];
+
+  // Nothing to read yet, with and without a signal mask.
+  ASSERT_EQ(0, epoll_pwait(epoll_fd, events, 1, 0, NULL));
+  sigset_t ss;
+  sigemptyset(&ss);
+  sigaddset(&ss, SIGUSR1);
+  ASSERT_EQ(0, epoll_pwait(epoll_fd, events, 1, 0, &ss)) << strerror(errno);
+
+  ASSERT_EQ(1, write(pipe_fds[1], "x", 1));
+  ASSERT_EQ(1, epoll_pwait(epoll_fd, events, 1, 0, &ss));
+  ASSERT_TRUE((events[0].events & EPOLLIN) != 0);
+  ASSERT_EQ(pipe_fds[0], events[0].data.fd);
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  close(epoll_fd);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+
+TEST(sys_sendfile, sendfile) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int src_fd = fileno(fp);
+  ASSERT_EQ(10, write(src_fd, "0123456789", 10));
+
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  off_t offset = 2;
+  ASSERT_EQ(5, sendfile(pipe_fds[1], src_fd, &offset, 5)) << strerror(errno);
+  ASSERT_EQ(7, offset);
+
+  char buf[16];
+  ASSERT_EQ(5, read(pipe_fds[0], buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "23456", 5));
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  fclose(fp);
+}
+
+TEST(sys_sendfile, sendfile64) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int src_fd = fileno(fp);
+
+  // Put some data past the 2GiB that an off_t can reach. The file is
+  // sparse, so this doesn't actually need the disk space.
+  const off64_t kBig = 3LL * 1024 * 1024 * 1024;
+  ASSERT_EQ(10, pwrite64(src_fd, "0123456789", 10, kBig)) << strerror(errno);
+
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+
+  off64_t offset = kBig + 2;
+  ASSERT_EQ(5, sendfile64(pipe_fds[1], src_fd, &offset, 5)) << strerror(errno);
+  ASSERT_EQ(kBig + 7, offset);
+
+  char buf[16];
+  ASSERT_EQ(5, read(pipe_fds[0], buf, sizeof(buf)));
+  ASSERT_EQ(0, memcmp(buf, "23456", 5));
+
+  close(pipe_fds[0]);
+  close(pipe_fds[1]);
+  fclose(fp);
+}
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static void MakeUdpPair(int* tx, int* rx) {
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  *rx = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_NE(-1, *rx);
+  ASSERT_EQ(0, bind(*rx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+  socklen_t len = sizeof(addr);
+  ASSERT_EQ(0, getsockname(*rx, reinterpret_cast<sockaddr*>(&addr), &len));
+
+  *tx = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_NE(-1, *tx);
+  ASSERT_EQ(0, connect(*tx, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)));
+}
+
+TEST(sys_socket, sendmmsg_recvmmsg) {
+  int tx, rx;
+  MakeUdpPair(&tx, &rx);
+
+  const char* packets[] = { "one", "three", "four" };
+  iovec iovs[3];
+  mmsghdr msgs[3];
+  memset(msgs, 0, sizeof(msgs));
+  for (size_t i = 0; i < 3; ++i) {
+    iovs[i].iov_base = const_cast<char*>(packets[i]);
+    iovs[i].iov_len = strlen(packets[i]);
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  ASSERT_EQ(3, sendmmsg(tx, msgs, 3, 0));
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(strlen(packets[i]), msgs[i].msg_len);
+  }
+
+  // Ask for more than were sent: MSG_WAITFORONE returns what's queued
+  // rather than waiting for the rest.
+  char bufs[4][16];
+  sockaddr_in froms[4];
+  mmsghdr in[4];
+  iovec in_iovs[4];
+  memset(in, 0, sizeof(in));
+  for (size_t i = 0; i < 4; ++i) {
+    in_iovs[i].iov_base = bufs[i];
+    in_iovs[i].iov_len = sizeof(bufs[i]);
+    in[i].msg_hdr.msg_iov = &in_iovs[i];
+    in[i].msg_hdr.msg_iovlen = 1;
+    in[i].msg_hdr.msg_name = &froms[i];
+    in[i].msg_hdr.msg_namelen = sizeof(froms[i]);
+  }
+  ASSERT_EQ(3, recvmmsg(rx, in, 4, MSG_WAITFORONE, NULL));
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(strlen(packets[i]), in[i].msg_len);
+    ASSERT_EQ(0, memcmp(packets[i], bufs[i], in[i].msg_len));
+    ASSERT_EQ(sizeof(sockaddr_in), in[i].msg_hdr.msg_namelen);
+    ASSERT_EQ(htonl(INADDR_LOOPBACK), froms[i].sin_addr.s_addr);
+  }
+
+  close(tx);
+  close(rx);
+}
+
+TEST(sys_socket, recvmmsg_nothing_queued) {
+  int tx, rx;
+  MakeUdpPair(&tx, &rx);
+
+  char buf[16];
+  iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = sizeof(buf);
+  mmsghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_hdr.msg_iov = &iov;
+  msg.msg_hdr.msg_iovlen = 1;
+
+  // Nothing was sent, so a non-blocking call has nothing to return.
+  ASSERT_EQ(-1, recvmmsg(rx, &msg, 1, MSG_DONTWAIT, NULL));
+  ASSERT_EQ(EAGAIN, errno);
+
+  close(tx);
+  close(rx);
+}
+
+TEST(sys_socket, socket_SOCK_NONBLOCK_SOCK_CLOEXEC) {
+  int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  ASSERT_NE(-1, fd) << strerror(errno);
+  ASSERT_TRUE((fcntl(fd, F_GETFL) & O_NONBLOCK) != 0);
+  ASSERT_TRUE((fcntl(fd, F_GETFD) & FD_CLOEXEC) != 0);
+  close(fd);
+
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds));
+  for (size_t i = 0; i < 2; ++i) {
+    ASSERT_TRUE((fcntl(fds[i], F_GETFL) & O_NONBLOCK) == 0);
+    ASSERT_TRUE((fcntl(fds[i], F_GETFD) & FD_CLOEXEC) != 0);
+    close(fds[i]);
+  }
+}
+
+TEST(sys_socket, accept4) {
+  // Bind to an address the kernel picks for us in the abstract namespace.
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_NE(-1, listener);
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  ASSERT_EQ(0, bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(sa_family_t)));
+  socklen_t addr_len = sizeof(addr);
+  ASSERT_EQ(0, getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &addr_len));
+  ASSERT_EQ(0, listen(listener, 1));
+
+  // Nothing is waiting yet.
+  ASSERT_EQ(0, fcntl(listener, F_SETFL, O_NONBLOCK));
+  ASSERT_EQ(-1, accept4(listener, NULL, NULL, SOCK_CLOEXEC));
+  ASSERT_EQ(EAGAIN, errno);
+
+  int client = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_NE(-1, client);
+  ASSERT_EQ(0, connect(client, reinterpret_cast<sockaddr*>(&addr), addr_len));
+
+  int fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  ASSERT_NE(-1, fd) << strerror(errno);
+  ASSERT_TRUE((fcntl(fd, F_GETFL) & O_NONBLOCK) != 0);
+  ASSERT_TRUE((fcntl(fd, F_GETFD) & FD_CLOEXEC) != 0);
+
+  // Unknown flags are rejected.
+  ASSERT_EQ(-1, accept4(listener, NULL, NULL, ~(SOCK_NONBLOCK | SOCK_CLOEXEC)));
+  ASSERT_EQ(EINVAL, errno);
+
+  close(fd);
+  close(client);
+  close(listener);
+}
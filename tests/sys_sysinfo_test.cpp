@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <sched.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+
+TEST(sys_sysinfo, get_nprocs) {
+  int conf = get_nprocs_conf();
+  int onln = sysconf(_SC_NPROCESSORS_ONLN);
+  ASSERT_EQ(conf, sysconf(_SC_NPROCESSORS_CONF));
+  ASSERT_GE(onln, 1);
+  ASSERT_LE(onln, conf);
+  ASSERT_EQ(onln, get_nprocs());
+}
+
+#if defined(__BIONIC__)
+TEST(sys_sysinfo, get_nprocs_affinity) {
+  cpu_set_t old_set;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(old_set), &old_set));
+
+  // Only use the first CPU we're allowed.
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &old_set)) {
+    ++cpu;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  ASSERT_EQ(0, sched_setaffinity(0, sizeof(set), &set));
+  ASSERT_EQ(1, get_nprocs_affinity());
+
+  // The system-wide counts don't change.
+  ASSERT_EQ(sysconf(_SC_NPROCESSORS_ONLN), get_nprocs());
+  ASSERT_EQ(0, sched_setaffinity(0, sizeof(old_set), &old_set));
+  ASSERT_EQ(CPU_COUNT(&old_set), get_nprocs_affinity());
+  ASSERT_LE(get_nprocs_affinity(), get_nprocs());
+}
+#endif
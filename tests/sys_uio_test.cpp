@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2013 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+TEST(sys_uio, preadv_pwritev) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int fd = fileno(fp);
+
+  iovec ios[2];
+  ios[0].iov_base = const_cast<char*>("hello");
+  ios[0].iov_len = 5;
+  ios[1].iov_base = const_cast<char*>("world");
+  ios[1].iov_len = 5;
+  ASSERT_EQ(10, pwritev(fd, ios, 2, 3)) << strerror(errno);
+  // Positional I/O doesn't move the file offset.
+  ASSERT_EQ(0, lseek(fd, 0, SEEK_CUR));
+
+  char buf1[3];
+  char buf2[4];
+  ios[0].iov_base = buf1;
+  ios[0].iov_len = sizeof(buf1);
+  ios[1].iov_base = buf2;
+  ios[1].iov_len = sizeof(buf2);
+  ASSERT_EQ(7, preadv(fd, ios, 2, 5)) << strerror(errno);
+  ASSERT_EQ(0, memcmp(buf1, "llo", 3));
+  ASSERT_EQ(0, memcmp(buf2, "worl", 4));
+  ASSERT_EQ(0, lseek(fd, 0, SEEK_CUR));
+
+  fclose(fp);
+}
+
+TEST(sys_uio, preadv64_pwritev64) {
+  FILE* fp = tmpfile();
+  ASSERT_TRUE(fp != NULL);
+  int fd = fileno(fp);
+
+  // An offset past 2GiB needs both halves passed correctly. The file is
+  // sparse, so this doesn't actually need the disk space.
+  const off64_t kBig = 3LL * 1024 * 1024 * 1024 + 7;
+  iovec io;
+  io.iov_base = const_cast<char*>("hello");
+  io.iov_len = 5;
+  ASSERT_EQ(5, pwritev64(fd, &io, 1, kBig)) << strerror(errno);
+
+  char buf[8];
+  ASSERT_EQ(5, pread64(fd, buf, sizeof(buf), kBig));
+  ASSERT_EQ(0, memcmp(buf, "hello", 5));
+
+  memset(buf, 0, sizeof(buf));
+  io.iov_base = buf;
+  io.iov_len = sizeof(buf);
+  ASSERT_EQ(4, preadv64(fd, &io, 1, kBig + 1)) << strerror(errno);
+  ASSERT_EQ(0, memcmp(buf, "ello", 4));
+
+  fclose(fp);
+}
@@ -16,7 +16,10 @@
 
 #include "benchmark.h"
 
+#include <sys/syscall.h>
+#include <sys/time.h>
 #include <time.h>
+#include <unistd.h>
 
 #if defined(__BIONIC__)
 
@@ -35,4 +38,146 @@ static void BM_time_localtime_tz(int iters) {
   StopBenchmarkTiming();
 }
 BENCHMARK(BM_time_localtime_tz);
+
+// Switching between zones, as a server formatting times for many users does.
+static void BM_time_localtime_tz_many(int iters) {
+  static const char* kZones[] = {
+    "Africa/Abidjan", "America/Los_Angeles", "America/New_York", "America/Sao_Paulo",
+    "Asia/Kolkata", "Asia/Shanghai", "Asia/Tokyo", "Australia/Sydney",
+    "Europe/Berlin", "Europe/London", "Europe/Moscow", "Pacific/Auckland",
+  };
+  static const size_t kZoneCount = sizeof(kZones) / sizeof(kZones[0]);
+
+  StartBenchmarkTiming();
+
+  time_t now(time(NULL));
+  tm broken_down_time;
+  for (int i = 0; i < iters; ++i) {
+    localtime_tz(&now, &broken_down_time, kZones[i % kZoneCount]);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_localtime_tz_many);
 #endif
+
+static void BM_time_clock_gettime(int iters) {
+  StartBenchmarkTiming();
+
+  timespec t;
+  for (int i = 0; i < iters; ++i) {
+    clock_gettime(CLOCK_MONOTONIC, &t);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_clock_gettime);
+
+static void BM_time_clock_gettime_REALTIME(int iters) {
+  StartBenchmarkTiming();
+
+  timespec t;
+  for (int i = 0; i < iters; ++i) {
+    clock_gettime(CLOCK_REALTIME, &t);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_clock_gettime_REALTIME);
+
+// The cost of going to the kernel, for comparison.
+static void BM_time_clock_gettime_syscall(int iters) {
+  StartBenchmarkTiming();
+
+  timespec t;
+  for (int i = 0; i < iters; ++i) {
+    syscall(__NR_clock_gettime, CLOCK_MONOTONIC, &t);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_clock_gettime_syscall);
+
+static void BM_time_gettimeofday(int iters) {
+  StartBenchmarkTiming();
+
+  timeval tv;
+  for (int i = 0; i < iters; ++i) {
+    gettimeofday(&tv, NULL);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_gettimeofday);
+
+static void BM_time_time(int iters) {
+  StartBenchmarkTiming();
+
+  for (int i = 0; i < iters; ++i) {
+    time(NULL);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_time);
+
+// Log timestamps: a few calls a second, each a little later than the last.
+static void BM_time_localtime_r(int iters) {
+  StartBenchmarkTiming();
+
+  time_t now(time(NULL));
+  tm broken_down_time;
+  for (int i = 0; i < iters; ++i) {
+    time_t t = now + i / 4;
+    localtime_r(&t, &broken_down_time);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_localtime_r);
+
+// Times far apart, so each one is worked out from scratch.
+static void BM_time_localtime_r_scattered(int iters) {
+  StartBenchmarkTiming();
+
+  time_t now(time(NULL));
+  tm broken_down_time;
+  for (int i = 0; i < iters; ++i) {
+    time_t t = now - (i % 1000) * 86400 * 3;
+    localtime_r(&t, &broken_down_time);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_localtime_r_scattered);
+
+static void BM_time_strftime_iso8601(int iters) {
+  StartBenchmarkTiming();
+
+  time_t now(time(NULL));
+  tm broken_down_time;
+  localtime_r(&now, &broken_down_time);
+  char buf[64];
+  for (int i = 0; i < iters; ++i) {
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S%z", &broken_down_time);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_strftime_iso8601);
+
+// A format that needs the locale, for comparison.
+static void BM_time_strftime_c(int iters) {
+  StartBenchmarkTiming();
+
+  time_t now(time(NULL));
+  tm broken_down_time;
+  localtime_r(&now, &broken_down_time);
+  char buf[64];
+  for (int i = 0; i < iters; ++i) {
+    strftime(buf, sizeof(buf), "%a %b %e %H:%M:%S %Z %Y", &broken_down_time);
+  }
+
+  StopBenchmarkTiming();
+}
+BENCHMARK(BM_time_strftime_c);
@@ -18,7 +18,19 @@
 #include <features.h>
 #include <gtest/gtest.h>
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
 #include <time.h>
+#include <unistd.h>
+
+#include <string>
 
 #ifdef __BIONIC__ // mktime_tz is a bionic extension.
 #include <libc/private/bionic_time.h>
@@ -55,6 +67,254 @@ TEST(time, gmtime) {
   ASSERT_EQ(1970, broken_down->tm_year + 1900);
 }
 
+static void SetTz(const char* tz) {
+  setenv("TZ", tz, 1);
+#if !defined(__BIONIC__)
+  // glibc's localtime_r doesn't look at TZ again; bionic notices changes itself.
+  tzset();
+#endif
+}
+
+TEST(time, localtime_r__TZ_changes) {
+  char* old_tz = getenv("TZ") ? strdup(getenv("TZ")) : NULL;
+  time_t t = 1371000000; // 2013-06-12 01:20:00 UTC.
+  tm broken_down;
+
+  SetTz("America/Los_Angeles");
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(18, broken_down.tm_hour);
+  ASSERT_EQ(1, broken_down.tm_isdst);
+
+  SetTz("Asia/Tokyo");
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(10, broken_down.tm_hour);
+  ASSERT_EQ(0, broken_down.tm_isdst);
+  ASSERT_EQ(t, mktime(&broken_down));
+
+  // Back to a zone we've already used.
+  SetTz("America/Los_Angeles");
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(18, broken_down.tm_hour);
+  ASSERT_EQ(t, mktime(&broken_down));
+
+  if (old_tz != NULL) {
+    setenv("TZ", old_tz, 1);
+    free(old_tz);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+}
+
+#if defined(__BIONIC__)
+#define _REALLY_INCLUDE_SYS__SYSTEM_PROPERTIES_H_
+#include <sys/_system_properties.h>
+
+extern void* __system_property_area__;
+
+// The layout of a pre-KitKat property area, as read by system_properties_compat.c.
+struct CompatPropInfo {
+  char name[PROP_NAME_MAX];
+  unsigned serial;
+  char value[PROP_VALUE_MAX];
+};
+
+struct CompatPropArea {
+  unsigned count;
+  unsigned serial;
+  unsigned magic;
+  unsigned version;
+  unsigned toc[1];
+  CompatPropInfo info;
+};
+
+static const char kTzProperty[] = "persist.sys.timezone";
+
+// Swaps in a private property area holding just the time zone property, in
+// either the current layout or the compat one, with TZ unset.
+class TzPropertyArea {
+ public:
+  explicit TzPropertyArea(bool compat) : compat_(compat), fd_(-1), pi_(NULL) {
+    char dir_template[] = "/data/local/tmp/prop-XXXXXX";
+    dirname_ = mkdtemp(dir_template);
+    filename_ = dirname_ + "/__properties__";
+    old_pa_ = __system_property_area__;
+    old_tz_ = getenv("TZ") ? strdup(getenv("TZ")) : NULL;
+  }
+
+  ~TzPropertyArea() {
+    // Re-reading the real area also leaves compat mode if need be.
+    __system_property_set_filename(PROP_FILENAME);
+    __system_properties_init();
+    __system_property_area__ = old_pa_;
+    if (fd_ != -1) {
+      close(fd_);
+    }
+    unlink(filename_.c_str());
+    rmdir(dirname_.c_str());
+    if (old_tz_ != NULL) {
+      setenv("TZ", old_tz_, 1);
+      free(old_tz_);
+    } else {
+      unsetenv("TZ");
+    }
+    tzset();
+  }
+
+  bool Init(const char* zone) {
+    __system_property_area__ = NULL;
+    __system_property_set_filename(filename_.c_str());
+    if (compat_) {
+      // Only a root-owned file is trusted, so init must have written it.
+      fd_ = open(filename_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+      CompatPropArea pa;
+      memset(&pa, 0, sizeof(pa));
+      pa.count = 1;
+      pa.magic = PROP_AREA_MAGIC;
+      pa.version = PROP_AREA_VERSION_COMPAT;
+      pa.toc[0] = ((sizeof(kTzProperty) - 1) << 24) | offsetof(CompatPropArea, info);
+      strcpy(pa.info.name, kTzProperty);
+      if (fd_ == -1 || ftruncate(fd_, PA_SIZE) == -1 ||
+          pwrite(fd_, &pa, sizeof(pa), 0) != sizeof(pa) ||
+          __system_properties_init() != 0) {
+        return false;
+      }
+      Set(zone);
+      pi_ = __system_property_find(kTzProperty);
+    } else {
+      if (__system_property_area_init() != 0 ||
+          __system_property_add(kTzProperty, strlen(kTzProperty), zone, strlen(zone)) != 0) {
+        return false;
+      }
+      pi_ = __system_property_find(kTzProperty);
+    }
+    unsetenv("TZ");
+    return (pi_ != NULL);
+  }
+
+  void Set(const char* zone) {
+    if (!compat_) {
+      __system_property_update(const_cast<prop_info*>(pi_), zone, strlen(zone));
+      return;
+    }
+    // Rewrite the value the way the old init did, through the file that
+    // we've mapped read-only.
+    CompatPropInfo info;
+    off_t offset = offsetof(CompatPropArea, info);
+    pread(fd_, &info, sizeof(info), offset);
+    strcpy(info.value, zone);
+    info.serial = (strlen(zone) << 24) | ((info.serial + 2) & 0xffffff);
+    pwrite(fd_, &info, sizeof(info), offset);
+  }
+
+ private:
+  bool compat_;
+  int fd_;
+  const prop_info* pi_;
+  std::string dirname_;
+  std::string filename_;
+  void* old_pa_;
+  char* old_tz_;
+};
+
+static void CheckPropertyZoneChanges(bool compat) {
+  TzPropertyArea area(compat);
+  ASSERT_TRUE(area.Init("America/Los_Angeles"));
+
+  time_t t = 1371000000; // 2013-06-12 01:20:00 UTC.
+  tm broken_down;
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(18, broken_down.tm_hour);
+
+  // Changing the property is noticed without a tzset.
+  area.Set("Asia/Tokyo");
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(10, broken_down.tm_hour);
+  ASSERT_EQ(t, mktime(&broken_down));
+}
+
+TEST(time, localtime_r__property_changes) {
+  CheckPropertyZoneChanges(false);
+}
+
+TEST(time, localtime_r__compat_property_changes) {
+  if (getuid() != 0) {
+    // The old layout is only accepted from a root-owned file.
+    return;
+  }
+  CheckPropertyZoneChanges(true);
+}
+#endif
+
+TEST(time, localtime_r__consecutive) {
+  char* old_tz = getenv("TZ") ? strdup(getenv("TZ")) : NULL;
+  time_t midnight = 1362902400; // 2013-03-10 00:00:00 PST, the day DST started.
+  time_t dst = midnight + 2 * 60 * 60;
+  tm broken_down;
+
+  SetTz("America/Los_Angeles");
+  time_t t = midnight - 1;
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(9, broken_down.tm_mday);
+  ASSERT_EQ(23, broken_down.tm_hour);
+  ASSERT_EQ(59, broken_down.tm_sec);
+  for (t = midnight; t < dst; t += 61) {
+    ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+    ASSERT_EQ(10, broken_down.tm_mday);
+    ASSERT_EQ((t - midnight) / 3600, broken_down.tm_hour);
+    ASSERT_EQ((t - midnight) / 60 % 60, broken_down.tm_min);
+    ASSERT_EQ((t - midnight) % 60, broken_down.tm_sec);
+    ASSERT_EQ(0, broken_down.tm_isdst);
+  }
+  t = dst - 1;
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(1, broken_down.tm_hour);
+  ASSERT_EQ(59, broken_down.tm_sec);
+  ASSERT_EQ(0, broken_down.tm_isdst);
+  t = dst;
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(3, broken_down.tm_hour);
+  ASSERT_EQ(0, broken_down.tm_sec);
+  ASSERT_EQ(1, broken_down.tm_isdst);
+  ASSERT_EQ(-7 * 60 * 60, broken_down.tm_gmtoff);
+  // Going back again.
+  t = midnight + 30;
+  ASSERT_TRUE(localtime_r(&t, &broken_down) != NULL);
+  ASSERT_EQ(0, broken_down.tm_hour);
+  ASSERT_EQ(30, broken_down.tm_sec);
+  ASSERT_EQ(0, broken_down.tm_isdst);
+
+  if (old_tz != NULL) {
+    setenv("TZ", old_tz, 1);
+    free(old_tz);
+  } else {
+    unsetenv("TZ");
+  }
+  tzset();
+}
+
+TEST(time, strftime__iso8601) {
+  time_t t = 1371000000; // 2013-06-12 01:20:00 UTC.
+  tm broken_down;
+  ASSERT_TRUE(gmtime_r(&t, &broken_down) != NULL);
+  char buf[64];
+
+  ASSERT_EQ(19U, strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &broken_down));
+  ASSERT_STREQ("2013-06-12T01:20:00", buf);
+  ASSERT_EQ(20U, strftime(buf, sizeof(buf), "%F %T%%", &broken_down));
+  ASSERT_STREQ("2013-06-12 01:20:00%", buf);
+
+  broken_down.tm_hour = 18;
+  broken_down.tm_mday = 11;
+  broken_down.tm_isdst = 1;
+  broken_down.tm_gmtoff = -7 * 60 * 60;
+  ASSERT_EQ(24U, strftime(buf, sizeof(buf), "%FT%T%z", &broken_down));
+  ASSERT_STREQ("2013-06-11T18:20:00-0700", buf);
+
+  // Too small for the result.
+  ASSERT_EQ(0U, strftime(buf, 24, "%FT%T%z", &broken_down));
+}
+
 #ifdef __BIONIC__
 TEST(time, mktime_10310929) {
   struct tm t;
@@ -67,3 +327,257 @@ TEST(time, mktime_10310929) {
   ASSERT_EQ(-1, mktime_tz(&t, "UTC"));
 }
 #endif
+
+static void SetTime(timer_t t, time_t value_s, time_t value_ns, time_t interval_s, time_t interval_ns) {
+  itimerspec ts;
+  ts.it_value.tv_sec = value_s;
+  ts.it_value.tv_nsec = value_ns;
+  ts.it_interval.tv_sec = interval_s;
+  ts.it_interval.tv_nsec = interval_ns;
+  ASSERT_EQ(0, timer_settime(t, 0, &ts, NULL));
+}
+
+#if defined(__BIONIC__)
+static int CountThreads() {
+  DIR* d = opendir("/proc/self/task");
+  if (d == NULL) {
+    return -1;
+  }
+  int count = 0;
+  dirent* e;
+  while ((e = readdir(d)) != NULL) {
+    if (e->d_name[0] != '.') {
+      ++count;
+    }
+  }
+  closedir(d);
+  return count;
+}
+#endif
+
+static void WaitForCount(volatile int* counter, int expected) {
+  for (int i = 0; i < 500 && *counter < expected; ++i) {
+    usleep(10000);
+  }
+}
+
+static void CountNotifyFunction(sigval_t value) {
+  __sync_fetch_and_add(reinterpret_cast<int*>(value.sival_ptr), 1);
+}
+
+TEST(time, timer_create_SIGEV_THREAD) {
+  volatile int count = 0;
+
+  sigevent se;
+  memset(&se, 0, sizeof(se));
+  se.sigev_notify = SIGEV_THREAD;
+  se.sigev_notify_function = CountNotifyFunction;
+  se.sigev_value.sival_ptr = const_cast<int*>(&count);
+
+  timer_t timer_id;
+  ASSERT_EQ(0, timer_create(CLOCK_MONOTONIC, &se, &timer_id));
+
+  // A one-shot timer fires once.
+  SetTime(timer_id, 0, 1000000, 0, 0);
+  WaitForCount(&count, 1);
+  ASSERT_EQ(1, count);
+  usleep(20000);
+  ASSERT_EQ(1, count);
+
+  itimerspec ts;
+  ASSERT_EQ(0, timer_gettime(timer_id, &ts));
+  ASSERT_EQ(0, ts.it_value.tv_sec);
+  ASSERT_EQ(0, ts.it_value.tv_nsec);
+
+  ASSERT_EQ(0, timer_delete(timer_id));
+}
+
+TEST(time, timer_settime__disarm) {
+  volatile int count = 0;
+
+  sigevent se;
+  memset(&se, 0, sizeof(se));
+  se.sigev_notify = SIGEV_THREAD;
+  se.sigev_notify_function = CountNotifyFunction;
+  se.sigev_value.sival_ptr = const_cast<int*>(&count);
+
+  timer_t timer_id;
+  ASSERT_EQ(0, timer_create(CLOCK_MONOTONIC, &se, &timer_id));
+
+  // A periodic timer keeps firing until it's disarmed...
+  SetTime(timer_id, 0, 1000000, 0, 1000000);
+  WaitForCount(&count, 5);
+  ASSERT_GE(count, 5);
+  SetTime(timer_id, 0, 0, 0, 0);
+
+  // ...and then stops (give any notification already on its way time to land).
+  usleep(20000);
+  int disarmed_count = count;
+  usleep(50000);
+  ASSERT_EQ(disarmed_count, count);
+
+  // Re-arming a disarmed timer works.
+  SetTime(timer_id, 0, 1000000, 0, 0);
+  WaitForCount(&count, disarmed_count + 1);
+  ASSERT_EQ(disarmed_count + 1, count);
+
+  // A deleted timer's id is no longer valid.
+  ASSERT_EQ(0, timer_delete(timer_id));
+  errno = 0;
+  ASSERT_EQ(-1, timer_delete(timer_id));
+  ASSERT_EQ(EINVAL, errno);
+}
+
+TEST(time, timer_create_SIGEV_THREAD__many) {
+  static const int kTimerCount = 500;
+  volatile int count = 0;
+
+  sigevent se;
+  memset(&se, 0, sizeof(se));
+  se.sigev_notify = SIGEV_THREAD;
+  se.sigev_notify_function = CountNotifyFunction;
+  se.sigev_value.sival_ptr = const_cast<int*>(&count);
+
+  timer_t timers[kTimerCount];
+  for (int i = 0; i < kTimerCount; ++i) {
+    ASSERT_EQ(0, timer_create(CLOCK_MONOTONIC, &se, &timers[i]));
+  }
+  for (int i = 0; i < kTimerCount; ++i) {
+    SetTime(timers[i], 0, 10000000 + (i % 10) * 1000000, 0, 0);
+  }
+#if defined(__BIONIC__)
+  // The timers share a service thread and a small pool of workers,
+  // rather than having a thread each.
+  ASSERT_LT(CountThreads(), 16);
+#endif
+
+  WaitForCount(&count, kTimerCount);
+  ASSERT_EQ(kTimerCount, count);
+#if defined(__BIONIC__)
+  ASSERT_LT(CountThreads(), 16);
+#endif
+
+  for (int i = 0; i < kTimerCount; ++i) {
+    ASSERT_EQ(0, timer_delete(timers[i]));
+  }
+}
+
+#if defined(__BIONIC__)
+static int64_t NowNs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static const int64_t kOverrunPeriodNs = 100000;
+
+struct OverrunState {
+  timer_t timer_id;
+  volatile int count;
+  volatile int overruns;
+  int64_t busy_start_ns;
+  int64_t busy_end_ns;
+  int64_t second_start_ns;
+};
+
+static void SlowNotifyFunction(sigval_t value) {
+  OverrunState* state = reinterpret_cast<OverrunState*>(value.sival_ptr);
+  if (state->count == 0) {
+    // Stay busy for many periods; the expirations we miss are overruns.
+    state->busy_start_ns = NowNs();
+    usleep(50000);
+    state->busy_end_ns = NowNs();
+  } else if (state->count == 1) {
+    state->second_start_ns = NowNs();
+    state->overruns = timer_getoverrun(state->timer_id);
+  }
+  __sync_fetch_and_add(&state->count, 1);
+}
+
+TEST(time, timer_getoverrun__SIGEV_THREAD) {
+  OverrunState state;
+  state.count = 0;
+  state.overruns = -1;
+
+  sigevent se;
+  memset(&se, 0, sizeof(se));
+  se.sigev_notify = SIGEV_THREAD;
+  se.sigev_notify_function = SlowNotifyFunction;
+  se.sigev_value.sival_ptr = &state;
+  // With attributes, each notification gets its own thread and the next one
+  // isn't started until the last has returned, so they can't overlap.
+  pthread_attr_t attr;
+  ASSERT_EQ(0, pthread_attr_init(&attr));
+  se.sigev_notify_attributes = &attr;
+
+  ASSERT_EQ(0, timer_create(CLOCK_MONOTONIC, &se, &state.timer_id));
+  SetTime(state.timer_id, 0, kOverrunPeriodNs, 0, kOverrunPeriodNs);
+  WaitForCount(&state.count, 2);
+  SetTime(state.timer_id, 0, 0, 0, 0);
+  usleep(20000);
+  ASSERT_GE(state.count, 2);
+
+  // However long the callback actually took, every period that passed while
+  // it was busy is an overrun, and there can't be more than one per period
+  // between the two callbacks starting.
+  int64_t busy_periods = (state.busy_end_ns - state.busy_start_ns) / kOverrunPeriodNs;
+  int64_t max_periods = (state.second_start_ns - state.busy_start_ns) / kOverrunPeriodNs;
+  ASSERT_GE(state.overruns, busy_periods - 2);
+  ASSERT_LE(state.overruns, max_periods + 1);
+
+  ASSERT_EQ(0, timer_delete(state.timer_id));
+  ASSERT_EQ(0, pthread_attr_destroy(&attr));
+}
+#endif
+
+static int64_t ToNs(const timespec& ts) {
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t ToNs(const timeval& tv) {
+  return static_cast<int64_t>(tv.tv_sec) * 1000000000LL + tv.tv_usec * 1000LL;
+}
+
+// clock_gettime and gettimeofday may never enter the kernel (they use the
+// vDSO where there is one), so check them against the system calls.
+
+TEST(time, clock_gettime_monotonic) {
+  timespec last;
+  ASSERT_EQ(0, clock_gettime(CLOCK_MONOTONIC, &last));
+  for (int i = 0; i < 100000; ++i) {
+    timespec now;
+    ASSERT_EQ(0, clock_gettime(CLOCK_MONOTONIC, &now));
+    ASSERT_LE(ToNs(last), ToNs(now));
+    last = now;
+  }
+}
+
+TEST(time, clock_gettime_matches_syscall) {
+  // A syscall sandwiched between two library calls sees a time between them.
+  timespec before, kernel, after;
+  ASSERT_EQ(0, clock_gettime(CLOCK_MONOTONIC, &before));
+  ASSERT_EQ(0, syscall(__NR_clock_gettime, CLOCK_MONOTONIC, &kernel));
+  ASSERT_EQ(0, clock_gettime(CLOCK_MONOTONIC, &after));
+  ASSERT_LE(ToNs(before), ToNs(kernel));
+  ASSERT_LE(ToNs(kernel), ToNs(after));
+
+  // The wall clock can be stepped under us, so just check it's close.
+  ASSERT_EQ(0, clock_gettime(CLOCK_REALTIME, &before));
+  ASSERT_EQ(0, syscall(__NR_clock_gettime, CLOCK_REALTIME, &kernel));
+  ASSERT_LT(llabs(ToNs(kernel) - ToNs(before)), 100000000LL);
+}
+
+TEST(time, gettimeofday_matches_syscall) {
+  timeval tv, kernel;
+  ASSERT_EQ(0, gettimeofday(&tv, NULL));
+  ASSERT_EQ(0, syscall(__NR_gettimeofday, &kernel, NULL));
+  ASSERT_LT(llabs(ToNs(kernel) - ToNs(tv)), 100000000LL);
+}
+
+TEST(time, clock_gettime_EINVAL) {
+  // The vDSO hands clocks it doesn't know to the kernel, which rejects this.
+  timespec ts;
+  errno = 0;
+  ASSERT_EQ(-1, clock_gettime(static_cast<clockid_t>(0x7fffffff), &ts));
+  ASSERT_EQ(EINVAL, errno);
+}
@@ -16,7 +16,12 @@
 
 #include <gtest/gtest.h>
 
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
 #include <stdint.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 TEST(unistd, sysconf_SC_MONOTONIC_CLOCK) {
@@ -32,3 +37,74 @@ TEST(unistd, sbrk) {
   void* final_break = sbrk(0);
   ASSERT_EQ(final_break, new_break);
 }
+
+static void AssertChildExitedCleanly(pid_t pid) {
+  ASSERT_NE(-1, pid);
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+}
+
+// A child's getpid and gettid mustn't return its parent's cached values.
+static int ChildIdsAreRight(pid_t parent_pid) {
+  pid_t pid = syscall(__NR_getpid);
+  if (pid == parent_pid || getpid() != pid || getpid() != pid) {
+    return 1;
+  }
+  return (gettid() == syscall(__NR_gettid)) ? 0 : 2;
+}
+
+static void AssertParentIdsAreRight(pid_t parent_pid) {
+  ASSERT_EQ(parent_pid, getpid());
+  ASSERT_EQ(syscall(__NR_getpid), getpid());
+  ASSERT_EQ(syscall(__NR_gettid), gettid());
+}
+
+TEST(unistd, getpid_gettid) {
+  ASSERT_EQ(syscall(__NR_getpid), getpid());
+  ASSERT_EQ(getpid(), getpid());
+  ASSERT_EQ(syscall(__NR_gettid), gettid());
+}
+
+TEST(unistd, getpid_gettid__fork) {
+  pid_t parent_pid = getpid();
+  pid_t pid = fork();
+  if (pid == 0) {
+    _exit(ChildIdsAreRight(parent_pid));
+  }
+  AssertChildExitedCleanly(pid);
+  AssertParentIdsAreRight(parent_pid);
+}
+
+TEST(unistd, getpid_gettid__vfork) {
+  pid_t parent_pid = getpid();
+  pid_t pid = vfork();
+  if (pid == 0) {
+    _exit(ChildIdsAreRight(parent_pid));
+  }
+  AssertChildExitedCleanly(pid);
+  AssertParentIdsAreRight(parent_pid);
+}
+
+static int CloneChild(void* arg) {
+  _exit(ChildIdsAreRight(*reinterpret_cast<pid_t*>(arg)));
+}
+
+TEST(unistd, getpid_gettid__clone) {
+  pid_t parent_pid = getpid();
+  static char child_stack[16 * 1024];
+  pid_t pid = clone(CloneChild, child_stack + sizeof(child_stack), SIGCHLD, &parent_pid);
+  AssertChildExitedCleanly(pid);
+  AssertParentIdsAreRight(parent_pid);
+}
+
+TEST(unistd, pipe2) {
+  int fds[2];
+  ASSERT_EQ(0, pipe2(fds, O_NONBLOCK | O_CLOEXEC));
+  for (size_t i = 0; i < 2; ++i) {
+    ASSERT_TRUE((fcntl(fds[i], F_GETFL) & O_NONBLOCK) != 0);
+    ASSERT_TRUE((fcntl(fds[i], F_GETFD) & FD_CLOEXEC) != 0);
+    close(fds[i]);
+  }
+}